@@ -0,0 +1,122 @@
+// autotune.cpp
+
+#include "autotune.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace spring {
+
+namespace {
+
+void fnv1a(std::uint64_t& h, std::uint64_t value) {
+    for (int byte = 0; byte < 8; ++byte) {
+        h ^= (value >> (8 * byte)) & 0xff;
+        h *= 1099511628211ull;
+    }
+}
+
+}  // namespace
+
+TuningKey tuning_key(const Network& net, int L_matrix) {
+    TuningKey key;
+    key.atoms = net.num_atoms;
+    key.bonds = net.num_physical_bonds;
+    key.L_matrix = L_matrix;
+    std::uint64_t h = 14695981039346656037ull;
+    for (std::uint32_t i = 0; i < net.num_atoms; ++i) fnv1a(h, net.atom_type[i]);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1 = 0, a2 = 0;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        fnv1a(h, (std::uint64_t(a1) << 32) | a2);
+        fnv1a(h, net.breakable(b) ? 1 : 0);
+    }
+    key.hash = h;
+    return key;
+}
+
+std::string TuningChoice::label() const {
+    std::ostringstream out;
+    out << backend;
+    if (subdomains > 0) out << ":S=" << subdomains;
+    if (dmax > 0.0) out << ":dmax=" << dmax;
+    return out.str();
+}
+
+RelaxSettings TuningChoice::apply(const RelaxSettings& base) const {
+    RelaxSettings settings = base;
+    if (subdomains > 0) settings.subdomains = subdomains;
+    if (dmax > 0.0) settings.dmax = dmax;
+    return settings;
+}
+
+std::vector<TuningChoice> auto_candidates(const Network& net) {
+    // CG primeiro: o |f| final dele é a tolerância de referência
+    std::vector<TuningChoice> choices = {{"cg"}};
+    for (double dmax : {0.05, 0.1, 0.2}) choices.push_back({"fire", 0, dmax});
+    for (const char* name : {"newton", "recycle", "ic"}) choices.push_back({name});
+    for (int subdomains : {2, 4, 8}) choices.push_back({"schwarz", subdomains, 0.0});
+    // Schur precisa de um esqueleto: ligação inquebrável com um átomo móvel
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1 = 0, a2 = 0;
+        if (!net.alive.test(b) || net.breakable(b) || !net.endpoints(b, a1, a2)) continue;
+        if (net.atom_type[a1] == atom_mobile || net.atom_type[a2] == atom_mobile) {
+            choices.push_back({"schur"});
+            break;
+        }
+    }
+    return choices;
+}
+
+void TuningCache::load() {
+    std::ifstream file(filename_);
+    if (!file.is_open()) return;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        Entry e;
+        std::string extra;
+        if (in >> e.key.atoms >> e.key.bonds >> e.key.L_matrix >> e.key.hash >> e.choice.backend >> e.choice.subdomains >>
+                e.choice.dmax >> e.ms &&
+            !(in >> extra)) {
+            entries_.push_back(e);
+        }
+    }
+}
+
+bool TuningCache::find(const TuningKey& key, TuningChoice& choice) const {
+    for (const Entry& e : entries_) {
+        if (e.key == key) {
+            choice = e.choice;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TuningCache::store(const TuningKey& key, const TuningChoice& choice, double ms_per_relax) {
+    for (Entry& e : entries_) {
+        if (e.key == key) {
+            e.choice = choice;
+            e.ms = ms_per_relax;
+            return;
+        }
+    }
+    entries_.push_back({key, choice, ms_per_relax});
+}
+
+void TuningCache::save() const {
+    std::ofstream file(filename_);
+    if (!file.is_open()) {
+        std::cerr << "Aviso: não foi possível escrever " << filename_ << std::endl;
+        return;
+    }
+    file << "# atoms bonds L_matrix hash backend subdomains dmax ms_per_relax\n";
+    for (const Entry& e : entries_) {
+        file << e.key.atoms << ' ' << e.key.bonds << ' ' << e.key.L_matrix << ' ' << e.key.hash << ' ' << e.choice.backend
+             << ' ' << e.choice.subdomains << ' ' << e.choice.dmax << ' ' << e.ms << '\n';
+    }
+}
+
+}  // namespace spring
@@ -0,0 +1,225 @@
+// autotune.h
+//
+// Escolha automática do backend de relaxação e dos seus parâmetros.
+//
+// `AutoTuneRelax` é um RelaxBackend que delega a um dos candidatos
+// (`auto_candidates`): cada candidato é um backend com os parâmetros que ele
+// calibra, o número de subdomínios por lado do Schwarz (2, 4, 8) e o dmax do
+// FIRE (0.05, 0.1, 0.2); Schur entra só com ligações inquebráveis.
+// Na primeira relaxação, e sempre que uma recalibração é pedida, todos os
+// candidatos relaxam a partir do mesmo estado e fica o mais rápido; o estado
+// final é o dele. Só competem os que convergiram com |f| final até
+// `fnorm_slack` (10: o |f| do próprio CG varia assim entre relaxações) vezes
+// o do primeiro candidato convergido (CG, o backend padrão): um critério de
+// energia satisfeito com |f| maior (FIRE) deixa um estado menos relaxado e
+// quebras diferentes. Depois, o tempo por relaxação é monitorado: numa
+// fronteira de fase (fim de um passo de deformação, quando a avalanche
+// terminou) o tuner compara a média do passo com a da calibração e, se o
+// custo mudou mais que `drift` vezes (a rede saiu da fase elástica, por
+// exemplo), recalibra na próxima relaxação.
+//
+// O raio dos patches (patches.h) não é calibrado: os patches não são um
+// backend, e sim o ponto de partida da relaxação seguinte a uma iteração com
+// quebras. Compará-los exigiria repetir iterações inteiras da avalanche, não
+// uma relaxação a partir do mesmo estado.
+//
+// A decisão é guardada por rede num arquivo texto, uma linha
+// `átomos ligações L_matrix hash backend subdomínios dmax ms_por_relaxação`
+// (0: o parâmetro não se aplica ao backend), em que o hash (FNV-1a) cobre a
+// conectividade, as ligações vivas e inquebráveis e os tipos dos átomos
+// (`tuning_key`); execuções seguintes na mesma rede começam com o candidato
+// salvo e só recalibram se o monitoramento pedir. Linhas no formato antigo,
+// só com o backend, são ignoradas.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ichol.h"
+#include "recycle.h"
+#include "relax.h"
+#include "schur.h"
+#include "schwarz.h"
+
+namespace spring {
+
+struct TuningKey {
+    std::uint32_t atoms = 0;
+    std::uint32_t bonds = 0;
+    int L_matrix = 0;
+    std::uint64_t hash = 0;
+
+    bool operator==(const TuningKey& o) const {
+        return atoms == o.atoms && bonds == o.bonds && L_matrix == o.L_matrix && hash == o.hash;
+    }
+};
+
+// Identifica a rede (a chave do cache), no estado atual
+TuningKey tuning_key(const Network& net, int L_matrix);
+
+// Um candidato do auto: backend e os parâmetros calibrados (0: o das
+// configurações da execução)
+struct TuningChoice {
+    std::string backend;
+    int subdomains = 0;  // schwarz
+    double dmax = 0.0;   // fire
+
+    // "cg", "schwarz:S=4", "fire:dmax=0.2"
+    std::string label() const;
+    RelaxSettings apply(const RelaxSettings& base) const;
+    bool operator==(const TuningChoice& o) const {
+        return backend == o.backend && subdomains == o.subdomains && dmax == o.dmax;
+    }
+};
+
+// Candidatos que o auto calibra nesta rede
+std::vector<TuningChoice> auto_candidates(const Network& net);
+
+class TuningCache {
+public:
+    explicit TuningCache(std::string filename) : filename_(std::move(filename)) { load(); }
+
+    bool find(const TuningKey& key, TuningChoice& choice) const;
+    void store(const TuningKey& key, const TuningChoice& choice, double ms_per_relax);
+    void save() const;
+
+private:
+    struct Entry {
+        TuningKey key;
+        TuningChoice choice;
+        double ms = 0.0;
+    };
+    void load();
+
+    std::string filename_;
+    std::vector<Entry> entries_;
+};
+
+template <class K>
+std::unique_ptr<RelaxBackend<K>> make_relax_backend(const std::string& name) {
+    if (name == "cg") return std::make_unique<CgRelax<K>>();
+    if (name == "fire") return std::make_unique<FireRelax<K>>();
+    if (name == "newton") return std::make_unique<NewtonRelax<K>>();
+    if (name == "schur") return std::make_unique<SchurRelax<K>>();
+    if (name == "recycle") return std::make_unique<RecycleRelax<K>>();
+    if (name == "ic") return std::make_unique<IcRelax<K>>();
+    if (name == "schwarz") return std::make_unique<SchwarzRelax<K>>();
+    throw std::runtime_error("Erro: backend de relaxação desconhecido: " + name);
+}
+
+template <class K>
+class AutoTuneRelax : public RelaxBackend<K> {
+public:
+    AutoTuneRelax(const std::vector<TuningChoice>& candidates, TuningCache* cache, TuningKey key)
+        : choices_(candidates), cache_(cache), key_(key) {
+        for (const TuningChoice& choice : choices_) backends_.push_back(make_relax_backend<K>(choice.backend));
+        TuningChoice cached;
+        if (cache_ && cache_->find(key_, cached)) {
+            for (std::size_t b = 0; b < choices_.size(); ++b) {
+                if (cached == choices_[b]) {
+                    current_ = b;
+                    calibrate_ = false;
+                    std::cout << "Info: autotune: " << cached.label() << " do arquivo de tuning" << std::endl;
+                }
+            }
+        }
+    }
+
+    const char* name() const override { return backends_[current_]->name(); }
+
+    RelaxResult relax(Network& net, const RelaxSettings& settings) override {
+        if (calibrate_) return calibrate(net, settings);
+        auto start = std::chrono::high_resolution_clock::now();
+        RelaxResult result = backends_[current_]->relax(net, choices_[current_].apply(settings));
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        if (step_calls_++ == 0) first_seconds_ = elapsed.count();
+        return result;
+    }
+
+    // Fim de um passo de deformação: compara a primeira relaxação do passo
+    // (logo após o deslocamento; as da avalanche variam com o seu tamanho)
+    // com a referência.
+    void phase_boundary() {
+        if (step_calls_ > 0) {
+            if (reference_ <= 0.0) {
+                reference_ = first_seconds_;
+            } else if (first_seconds_ > drift * reference_ || first_seconds_ * drift < reference_) {
+                std::cout << "Info: autotune: relaxação do passo em " << 1.0e3 * first_seconds_ << " ms (referência "
+                          << 1.0e3 * reference_ << " ms); recalibrando" << std::endl;
+                calibrate_ = true;
+            }
+        }
+        step_calls_ = 0;
+    }
+
+    std::size_t workspace_bytes() const override {
+        std::size_t total = x0_.capacity() * sizeof(double) + best_x_.capacity() * sizeof(double);
+        for (const auto& b : backends_) total += b->workspace_bytes();
+        return total;
+    }
+
+    double drift = 3.0;
+    double fnorm_slack = 10.0;
+
+private:
+    RelaxResult calibrate(Network& net, const RelaxSettings& settings) {
+        x0_ = net.x;
+        RelaxResult best;
+        double best_time = -1.0;
+        double reference_fnorm = -1.0;
+        for (std::size_t b = 0; b < backends_.size(); ++b) {
+            net.x = x0_;
+            auto start = std::chrono::high_resolution_clock::now();
+            RelaxResult r = backends_[b]->relax(net, choices_[b].apply(settings));
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            // Só competem os que convergiram até a tolerância de referência
+            // (ou todos, se nenhum chegou a ela)
+            const bool converged = r.converged();
+            if (converged && reference_fnorm < 0.0) reference_fnorm = std::max(r.fnorm, settings.ftol);
+            const bool qualified = converged && r.fnorm <= fnorm_slack * reference_fnorm;
+            const double t = qualified ? elapsed.count() : 1.0e30 + elapsed.count();
+            std::cout << "Info: autotune: " << choices_[b].label() << " " << 1.0e3 * elapsed.count() << " ms, "
+                      << r.iterations << " iterations, |f| = " << r.fnorm
+                      << (!converged ? " (sem convergir)" : qualified ? "" : " (acima da tolerância de referência)")
+                      << std::endl;
+            if (best_time < 0.0 || t < best_time) {
+                best_time = t;
+                best = r;
+                best_x_ = net.x;
+                current_ = b;
+            }
+        }
+        net.x = best_x_;
+        calibrate_ = false;
+        // A calibração é a primeira relaxação do passo: vira a referência
+        reference_ = 0.0;
+        first_seconds_ = (best_time < 1.0e30) ? best_time : best_time - 1.0e30;
+        step_calls_ = 1;
+        std::cout << "Info: autotune: usando " << choices_[current_].label() << std::endl;
+        if (cache_) {
+            cache_->store(key_, choices_[current_], 1.0e3 * first_seconds_);
+            cache_->save();
+        }
+        return best;
+    }
+
+    std::vector<TuningChoice> choices_;
+    std::vector<std::unique_ptr<RelaxBackend<K>>> backends_;  // um por candidato
+    TuningCache* cache_;
+    TuningKey key_;
+    std::size_t current_ = 0;
+    bool calibrate_ = true;
+    double reference_ = 0.0;
+    double first_seconds_ = 0.0;
+    int step_calls_ = 0;
+    std::vector<double> x0_, best_x_;
+};
+
+}  // namespace spring
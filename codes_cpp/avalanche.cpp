@@ -0,0 +1,220 @@
+// avalanche.cpp
+
+#include "avalanche.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace spring {
+
+AvalancheForest::AvalancheForest(const Box& box, double radius)
+    : box_(box), radius_(radius), radius_sq_(radius * radius), pool_(std::make_unique<Pool>()),
+      touched_(0, std::hash<std::uint64_t>(), std::equal_to<std::uint64_t>(), PoolAllocator<std::uint64_t>(pool_.get())) {
+    if (!(radius > 0.0)) {
+        throw std::runtime_error("Erro: o raio de redistribuição deve ser positivo");
+    }
+    if (box_.period[0] > 0.0) ncx_ = std::max<std::int64_t>(1, static_cast<std::int64_t>(box_.period[0] / radius));
+}
+
+double AvalancheForest::dx(double a, double b) const {
+    double d = a - b;
+    if (box_.period[0] > 0.0) d -= box_.period[0] * std::nearbyint(d * box_.inv_period[0]);
+    return d;
+}
+
+std::uint64_t AvalancheForest::cell_of(double x, double y) const {
+    std::int64_t cx = 0;
+    if (box_.period[0] > 0.0) {
+        const double t = (x - box_.lo[0]) * box_.inv_period[0];
+        cx = static_cast<std::int64_t>(std::floor((t - std::floor(t)) * ncx_));
+        cx = std::min(std::max<std::int64_t>(cx, 0), ncx_ - 1);
+    } else {
+        cx = static_cast<std::int64_t>(std::floor((x - box_.lo[0]) / radius_)) + (std::int64_t(1) << 31);
+    }
+    const std::int64_t cy = static_cast<std::int64_t>(std::floor((y - box_.lo[1]) / radius_)) + (std::int64_t(1) << 31);
+    return (static_cast<std::uint64_t>(cy) << 32) | static_cast<std::uint64_t>(cx);
+}
+
+void AvalancheForest::begin_step(int step) {
+    step_ = step;
+    node_x_.clear();
+    node_y_.clear();
+    node_ux_.clear();
+    node_tree_.clear();
+    node_gen_.clear();
+    prev_begin_ = prev_end_ = 0;
+    prev_cells_.clear();
+    num_trees_ = 0;
+    touched_.clear();
+}
+
+void AvalancheForest::index_previous() {
+    prev_cells_.clear();
+    for (std::size_t n = prev_begin_; n < prev_end_; ++n) {
+        prev_cells_.emplace_back(cell_of(node_x_[n], node_y_[n]), static_cast<std::uint32_t>(n));
+    }
+    std::sort(prev_cells_.begin(), prev_cells_.end());
+}
+
+void AvalancheForest::add_iteration(const std::vector<double>& midpoints) {
+    const std::size_t begin = node_x_.size();
+    const std::size_t count = midpoints.size() / 2;
+    const bool periodic_x = box_.period[0] > 0.0;
+
+    for (std::size_t k = 0; k < count; ++k) {
+        const double x = midpoints[2 * k], y = midpoints[2 * k + 1];
+
+        // Pai: quebra mais próxima da iteração anterior dentro do raio
+        std::int64_t parent = -1;
+        double best = radius_sq_;
+        if (!prev_cells_.empty()) {
+            const std::uint64_t c = cell_of(x, y);
+            const std::int64_t cx = static_cast<std::int64_t>(c & 0xffffffffu);
+            const std::int64_t cy = static_cast<std::int64_t>(c >> 32);
+            const std::int64_t span = (periodic_x && ncx_ < 3) ? 0 : 1;
+            for (std::int64_t oy = -1; oy <= 1; ++oy) {
+                for (std::int64_t ox = -span; ox <= span; ++ox) {
+                    std::int64_t nx = cx + ox;
+                    if (periodic_x) nx = (nx + ncx_) % ncx_;
+                    // ncx_ < 3: todas as colunas são vizinhas
+                    for (std::int64_t col = (span == 0 ? 0 : nx); col <= (span == 0 ? ncx_ - 1 : nx); ++col) {
+                        const std::uint64_t key = (static_cast<std::uint64_t>(cy + oy) << 32) | static_cast<std::uint64_t>(col);
+                        auto it = std::lower_bound(prev_cells_.begin(), prev_cells_.end(), std::make_pair(key, std::uint32_t(0)));
+                        for (; it != prev_cells_.end() && it->first == key; ++it) {
+                            const std::uint32_t n = it->second;
+                            const double ddx = dx(x, node_x_[n]), ddy = y - node_y_[n];
+                            const double d2 = ddx * ddx + ddy * ddy;
+                            if (d2 < best || (d2 == best && parent >= 0 && n < parent)) {
+                                best = d2;
+                                parent = n;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        int tree, gen;
+        double ux = x;
+        if (parent < 0) {
+            tree = static_cast<int>(num_trees_);
+            gen = 0;
+            if (num_trees_ == trees_.size()) trees_.emplace_back();
+            Tree& t = trees_[num_trees_++];
+            t.generation.clear();
+            t.sx = t.sy = t.sxx = t.syy = 0.0;
+            t.stats = AvalancheStats();
+            t.stats.step = step_;
+            t.stats.id = tree;
+            t.stats.root_x = x;
+            t.stats.root_y = y;
+            t.xmin = t.xmax = x;
+            t.ymin = t.ymax = y;
+        } else {
+            tree = node_tree_[parent];
+            gen = node_gen_[parent] + 1;
+            ux = node_ux_[parent] + dx(x, node_x_[parent]);
+        }
+
+        // Atualização O(1) da árvore
+        Tree& t = trees_[tree];
+        if (static_cast<int>(t.generation.size()) <= gen) t.generation.resize(gen + 1, 0);
+        ++t.generation[gen];
+        ++t.stats.size;
+        t.stats.depth = std::max(t.stats.depth, gen);
+        const double rx = dx(x, t.stats.root_x), ry = y - t.stats.root_y;
+        t.stats.spread = std::max(t.stats.spread, std::sqrt(rx * rx + ry * ry));
+
+        // Geometria: caixa, momentos e células da matriz
+        t.xmin = std::min(t.xmin, ux);
+        t.xmax = std::max(t.xmax, ux);
+        t.ymin = std::min(t.ymin, y);
+        t.ymax = std::max(t.ymax, y);
+        const double ox = ux - t.stats.root_x, oy = y - t.stats.root_y;
+        t.sx += ox;
+        t.sy += oy;
+        t.sxx += ox * ox;
+        t.syy += oy * oy;
+        if (cells_.w > 0.0) {
+            std::int64_t cx = static_cast<std::int64_t>(std::floor((x - cells_.x0) / cells_.w));
+            if (cells_.nx > 0) cx = ((cx % cells_.nx) + cells_.nx) % cells_.nx;
+            const std::int64_t cy = static_cast<std::int64_t>(std::floor((y - cells_.y0) / cells_.h));
+            const std::uint64_t key = (static_cast<std::uint64_t>(tree) << 40) ^
+                                      (static_cast<std::uint64_t>(cy & 0xfffff) << 20) ^
+                                      static_cast<std::uint64_t>(cx & 0xfffff);
+            if (touched_.insert(key).second) ++t.stats.cells;
+        }
+
+        node_x_.push_back(x);
+        node_y_.push_back(y);
+        node_ux_.push_back(ux);
+        node_tree_.push_back(tree);
+        node_gen_.push_back(gen);
+    }
+
+    prev_begin_ = begin;
+    prev_end_ = node_x_.size();
+    index_previous();
+}
+
+const std::vector<AvalancheStats>& AvalancheForest::end_step() {
+    closed_.clear();
+    for (std::size_t i = 0; i < num_trees_; ++i) {
+        Tree& t = trees_[i];
+        long long parents = 0, children = 0;
+        for (int g = 0; g < t.stats.depth; ++g) parents += t.generation[g];
+        for (int g = 1; g <= t.stats.depth; ++g) children += t.generation[g];
+        t.stats.branching = (parents > 0) ? double(children) / double(parents) : 0.0;
+        const double n = double(t.stats.size);
+        t.stats.extent_x = t.xmax - t.xmin;
+        if (box_.period[0] > 0.0) t.stats.extent_x = std::min(t.stats.extent_x, box_.period[0]);
+        t.stats.extent_y = t.ymax - t.ymin;
+        const double mx = t.sx / n, my = t.sy / n;
+        t.stats.gyration = std::sqrt(std::max(0.0, t.sxx / n - mx * mx + t.syy / n - my * my));
+        closed_.push_back(t.stats);
+    }
+    return closed_;
+}
+
+void AvalancheForest::write_header(std::ostream& out) {
+    out << "realization,step,avalanche,size,depth,branching,spread,root_x,root_y,extent_x,extent_y,gyration,cells\n";
+}
+
+void AvalancheForest::write_events(std::ostream& out, int realization) const {
+    for (const AvalancheStats& a : closed_) {
+        out << realization << ',' << a.step << ',' << a.id << ',' << a.size << ',' << a.depth << ','
+            << a.branching << ',' << a.spread << ',' << a.root_x << ',' << a.root_y << ',' << a.extent_x << ','
+            << a.extent_y << ',' << a.gyration << ',' << a.cells << '\n';
+    }
+}
+
+MatrixCells MatrixCells::for_lattice(int L_matrix, double l0, const Box& box) {
+    MatrixCells cells;
+    if (L_matrix <= 0) return cells;
+    cells.x0 = 0.25 * l0;
+    cells.y0 = 0.0;
+    cells.w = L_matrix * l0;
+    cells.h = L_matrix * l0 * std::sqrt(3.0) / 2.0;
+    if (box.period[0] > 0.0) cells.nx = std::max<std::int64_t>(1, std::llround(box.period[0] / cells.w));
+    return cells;
+}
+
+void LogHistogram::add(double value) {
+    std::size_t bin = 0;
+    if (value >= 1.0) bin = static_cast<std::size_t>(std::floor(std::log2(value))) + 1;
+    if (bins_.size() <= bin) bins_.resize(bin + 1, 0);
+    ++bins_[bin];
+    ++total_;
+}
+
+void LogHistogram::write(std::ostream& out, const std::string& name) const {
+    for (std::size_t b = 0; b < bins_.size(); ++b) {
+        if (bins_[b] == 0) continue;
+        const double lo = (b == 0) ? 0.0 : std::ldexp(1.0, int(b) - 1);
+        const double hi = std::ldexp(1.0, int(b));
+        out << name << ',' << lo << ',' << hi << ',' << bins_[b] << '\n';
+    }
+}
+
+}  // namespace spring
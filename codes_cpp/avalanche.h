@@ -0,0 +1,135 @@
+// avalanche.h
+//
+// Árvore causal das avalanches, construída durante a simulação.
+//
+// Dentro de um passo de deformação, cada iteração do loop da avalanche
+// quebra um conjunto de ligações. Cada quebra nova é atribuída à quebra mais
+// próxima da iteração anterior (distância entre pontos médios, periódica em
+// x) dentro do raio de redistribuição de carga; sem pai, ela inicia uma nova
+// árvore. As quebras da iteração anterior ficam num índice espacial de
+// células de lado `radius` (ordenado por célula), de modo que cada consulta
+// olha apenas as 9 células vizinhas e o custo total é O(quebras).
+//
+// Por árvore (avalanche) são mantidos, incrementalmente: tamanho, profundidade
+// (última geração), número de quebras por geração e alcance (maior distância
+// de uma quebra até a raiz). A razão de ramificação é
+//   sum_{g >= 1} n_g / sum_{g < depth} n_g,
+// o número médio de filhos das gerações que tiveram descendentes.
+//
+// Descritores geométricos, também O(1) por quebra: cada ponto médio é
+// desdobrado em x em relação ao pai (x_u = x_u(pai) + dx mínimo), de modo que
+// a caixa envolvente e o raio de giração de uma avalanche que atravessa a
+// borda periódica saem contínuos; a extensão em x é limitada ao período. O
+// raio de giração vem das somas de x e x^2 relativas à raiz. As células da
+// matriz tocadas (grade de L_matrix, ver MatrixCells) são contadas com um
+// conjunto de pares (árvore, célula) do passo.
+//
+// Memória: os registros das árvores são reaproveitados de um passo para o
+// outro e os nós do conjunto (árvore, célula) vêm de um `Pool` (memory.h),
+// então, depois dos primeiros passos, registrar quebras não aloca.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "kernels.h"
+#include "memory.h"
+
+namespace spring {
+
+struct AvalancheStats {
+    int step = 0;
+    int id = 0;
+    long long size = 0;
+    int depth = 0;
+    double branching = 0.0;
+    double spread = 0.0;
+    double root_x = 0.0, root_y = 0.0;
+    double extent_x = 0.0, extent_y = 0.0;  // caixa envolvente
+    double gyration = 0.0;
+    long long cells = 0;                    // células da matriz tocadas
+};
+
+// Células da matriz inquebrável: retângulos w x h a partir de (x0, y0),
+// nx por período em x. w = 0 desativa a contagem.
+struct MatrixCells {
+    double x0 = 0.0, y0 = 0.0, w = 0.0, h = 0.0;
+    std::int64_t nx = 0;
+
+    // Grade da rede triangular gerada com L_matrix (generator.cpp): as linhas
+    // j % L == 0 e os zigue-zagues i % L == 0, em média em x = (i + 1/4) l0.
+    static MatrixCells for_lattice(int L_matrix, double l0, const Box& box);
+};
+
+// Histograma logarítmico (base 2) acumulado entre realizações.
+class LogHistogram {
+public:
+    void add(double value);
+    void write(std::ostream& out, const std::string& name) const;
+    long long total() const { return total_; }
+
+private:
+    std::vector<long long> bins_;  // bin b: [2^(b-1), 2^b), bin 0: < 1
+    long long total_ = 0;
+};
+
+class AvalancheForest {
+public:
+    AvalancheForest(const Box& box, double radius);
+
+    void set_matrix_cells(const MatrixCells& cells) { cells_ = cells; }
+
+    void begin_step(int step);
+
+    // Quebras de uma iteração da avalanche: pontos médios (x, y) intercalados.
+    void add_iteration(const std::vector<double>& midpoints);
+
+    // Fecha as árvores do passo corrente.
+    const std::vector<AvalancheStats>& end_step();
+
+    // Uma linha por avalanche do último passo (ver write_header).
+    static void write_header(std::ostream& out);
+    void write_events(std::ostream& out, int realization) const;
+
+private:
+    struct Tree {
+        AvalancheStats stats;
+        std::vector<long long> generation;  // quebras por geração
+        double xmin = 0.0, xmax = 0.0, ymin = 0.0, ymax = 0.0;
+        double sx = 0.0, sy = 0.0, sxx = 0.0, syy = 0.0;  // relativas à raiz
+    };
+
+    double dx(double a, double b) const;
+    std::uint64_t cell_of(double x, double y) const;
+    void index_previous();
+
+    Box box_;
+    double radius_;
+    double radius_sq_;
+    std::int64_t ncx_ = 1;  // células em x (periódicas)
+    int step_ = 0;
+
+    // Quebras do passo corrente
+    std::vector<double> node_x_, node_y_, node_ux_;
+    std::vector<int> node_tree_, node_gen_;
+    std::size_t prev_begin_ = 0, prev_end_ = 0;
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> prev_cells_;  // (célula, nó), ordenado
+
+    MatrixCells cells_;
+    std::unique_ptr<Pool> pool_;
+    std::unordered_set<std::uint64_t, std::hash<std::uint64_t>, std::equal_to<std::uint64_t>,
+                       PoolAllocator<std::uint64_t>>
+        touched_;  // (árvore, célula)
+
+    std::vector<Tree> trees_;  // os num_trees_ primeiros são do passo corrente
+    std::size_t num_trees_ = 0;
+    std::vector<AvalancheStats> closed_;
+};
+
+}  // namespace spring
@@ -0,0 +1,106 @@
+// coloring.cpp
+
+#include "coloring.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace spring {
+
+namespace {
+
+// Classe da ligação (nó, direção) da rede triangular
+int lattice_color(const TriangularLattice& lat, std::uint32_t node, int dir) {
+    const std::uint32_t j = node / lat.N, i = node % lat.N;
+    if (dir == 0) return (lat.N % 2 == 1 && i + 1 == lat.N) ? 2 : static_cast<int>(i % 2);
+    return 3 + 2 * (dir - 1) + static_cast<int>(j % 2);
+}
+
+// Classe estrutural de cada ligação, ou vazio se a rede não for triangular
+std::vector<std::uint8_t> lattice_colors(const Network& net) {
+    if (net.implicit) {
+        std::vector<std::uint8_t> color(net.num_bonds, 0xFF);
+        for (std::uint32_t s = 0; s < net.num_bonds; ++s) {
+            std::uint32_t a, b;
+            if (!net.lattice.endpoints(s, a, b)) continue;
+            color[s] = static_cast<std::uint8_t>(lattice_color(net.lattice, a, static_cast<int>(s / (net.lattice.N * net.lattice.N))));
+        }
+        return color;
+    }
+    const std::uint32_t N = static_cast<std::uint32_t>(std::lround(std::sqrt(double(net.num_atoms))));
+    if (N < 3 || N * N != net.num_atoms) return {};
+    const TriangularLattice lat{N};
+    std::vector<std::uint8_t> color(net.num_bonds);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        const std::uint32_t a1 = net.bond_atom1[b], a2 = net.bond_atom2[b];
+        int c = -1;
+        for (int dir = 0; dir < TriangularLattice::num_directions && c < 0; ++dir) {
+            std::uint32_t other;
+            if (lat.neighbor(a1, dir, other) && other == a2) c = lattice_color(lat, a1, dir);
+            else if (lat.neighbor(a2, dir, other) && other == a1) c = lattice_color(lat, a2, dir);
+        }
+        if (c < 0) return {};
+        color[b] = static_cast<std::uint8_t>(c);
+    }
+    return color;
+}
+
+// Coloração gulosa de arestas na ordem das ligações: a menor classe livre
+// nas duas pontas
+std::vector<std::uint8_t> greedy_colors(const Network& net) {
+    std::vector<std::uint64_t> used(net.num_atoms, 0);
+    std::vector<std::uint8_t> color(net.num_bonds, 0xFF);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.endpoints(b, a1, a2)) continue;
+        const std::uint64_t free = ~(used[a1] | used[a2]);
+        if (free == 0) throw std::runtime_error("Erro: a coloração das ligações exige mais de 64 classes");
+        const int c = __builtin_ctzll(free);
+        used[a1] |= std::uint64_t(1) << c;
+        used[a2] |= std::uint64_t(1) << c;
+        color[b] = static_cast<std::uint8_t>(c);
+    }
+    return color;
+}
+
+}  // namespace
+
+BondColoring color_bonds(const Network& net) {
+    BondColoring coloring;
+    std::vector<std::uint8_t> color = lattice_colors(net);
+    coloring.lattice = !color.empty();
+    if (!coloring.lattice) color = greedy_colors(net);
+
+    // Agrupa por classe, na ordem das ligações; as classes vazias somem
+    std::vector<std::uint32_t> count(64, 0);
+    for (std::uint8_t c : color) {
+        if (c != 0xFF) ++count[c];
+    }
+    std::vector<std::uint32_t> slot(64, 0);
+    coloring.start.push_back(0);
+    for (int c = 0; c < 64; ++c) {
+        if (count[c] == 0) continue;
+        slot[c] = coloring.start.back();
+        coloring.start.push_back(coloring.start.back() + count[c]);
+    }
+    coloring.bond.resize(coloring.start.back());
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        if (color[b] != 0xFF) coloring.bond[slot[color[b]]++] = b;
+    }
+    return coloring;
+}
+
+bool check_coloring(const Network& net, const BondColoring& coloring) {
+    std::vector<int> seen(net.num_atoms, -1);
+    for (int c = 0; c < coloring.num_colors(); ++c) {
+        for (std::uint32_t i = coloring.start[c]; i < coloring.start[c + 1]; ++i) {
+            std::uint32_t a1, a2;
+            if (!net.endpoints(coloring.bond[i], a1, a2)) return false;
+            if (seen[a1] == c || seen[a2] == c) return false;
+            seen[a1] = seen[a2] = c;
+        }
+    }
+    return true;
+}
+
+}  // namespace spring
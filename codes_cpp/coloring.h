@@ -0,0 +1,161 @@
+// coloring.h
+//
+// Coloração das ligações para o laço de forças com threads.
+//
+// Cada ligação soma forças nas duas pontas; com várias threads no mesmo laço,
+// duas ligações que compartilham um átomo escreveriam em f[átomo] ao mesmo
+// tempo. Em vez de atômicos ou de cópias de f por thread, as ligações são
+// divididas em classes sem átomos em comum: dentro de uma classe, cada thread
+// escreve direto em f, e as classes são separadas por uma barreira.
+//
+// Na rede triangular de create_network.py a coloração é estrutural, pela
+// direção e pela paridade (lattice.h): leste pela paridade da coluna (mais
+// uma classe para a ligação que dá a volta quando N é ímpar), norte e
+// diagonal pela paridade da linha; são 6 ou 7 classes. Redes explícitas que
+// são a rede triangular completa ou diluída usam a mesma regra; as demais
+// (Delaunay, arquivos arbitrários) usam coloração gulosa de arestas, com no
+// máximo 2*grau - 1 classes.
+//
+// Cada átomo recebe no máximo uma contribuição por classe, sempre na ordem
+// das classes, então as forças não dependem do número de threads; a energia
+// também não (blocos fixos e árvore de reduce.h). Em relação ao laço serial
+// de kernels.h, só a ordem das parcelas muda.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "kernels.h"
+#include "network.h"
+#include "parallel.h"
+#include "reduce.h"
+
+namespace spring {
+
+struct BondColoring {
+    std::vector<std::uint32_t> start;  // num_colors + 1
+    std::vector<std::uint32_t> bond;   // ligações agrupadas por classe
+    bool lattice = false;              // coloração estrutural da rede triangular
+
+    int num_colors() const { return start.empty() ? 0 : static_cast<int>(start.size() - 1); }
+    std::uint32_t size(int c) const { return start[c + 1] - start[c]; }
+    std::size_t bytes() const { return (start.capacity() + bond.capacity()) * sizeof(std::uint32_t); }
+};
+
+// Classes da rede triangular se a rede for uma, senão coloração gulosa.
+// Lança std::runtime_error se a gulosa precisar de mais de 64 classes.
+BondColoring color_bonds(const Network& net);
+
+// Confere que nenhuma classe tem duas ligações com um átomo em comum.
+bool check_coloring(const Network& net, const BondColoring& coloring);
+
+// Laço de forças colorido com `threads` threads. O pool de threads, a
+// barreira entre as classes e as energias parciais são criados uma vez (por
+// execução, em native_main) e reusados a cada avaliação, sem alocar.
+//
+// Cada classe é cortada em blocos fixos de `block` ligações, e cada thread
+// avalia blocos inteiros; a energia de cada bloco é somada em ordem e os
+// blocos são combinados pela árvore fixa de reduce.h. Forças e energia não
+// dependem do número de threads.
+class ColoredForces {
+public:
+    static constexpr std::uint32_t block = 256;
+
+    ColoredForces(const BondColoring& coloring, int threads)
+        : coloring_(coloring), pool_(threads), barrier_(pool_.size()) {
+        const int colors = coloring.num_colors();
+        first_block_.assign(colors + 1, 0);
+        for (int c = 0; c < colors; ++c) first_block_[c + 1] = first_block_[c] + (coloring.size(c) + block - 1) / block;
+        partial_.assign(first_block_[colors], 0.0);
+    }
+
+    int threads() const { return pool_.size(); }
+    std::size_t bytes() const {
+        return partial_.capacity() * sizeof(double) + first_block_.capacity() * sizeof(std::uint32_t);
+    }
+
+    // Mesmas forças e energia de network_forces (f acumula)
+    template <class K>
+    double compute(const Network& net, const double* x, double* f) {
+        const int threads = pool_.size(), colors = coloring_.num_colors();
+        const bool variable = !net.rest_len.empty();
+        auto work = [&](int t) {
+            for (int c = 0; c < colors; ++c) {
+                const std::uint32_t blocks = first_block_[c + 1] - first_block_[c];
+                const std::uint32_t begin = blocks * t / threads, end = blocks * (t + 1) / threads;
+                for (std::uint32_t blk = begin; blk < end; ++blk) {
+                    const std::uint32_t lo = coloring_.start[c] + blk * block;
+                    const std::uint32_t hi = std::min(coloring_.start[c + 1], lo + block);
+                    double energy = 0.0;
+                    for (std::uint32_t i = lo; i < hi; ++i) {
+                        const std::uint32_t s = coloring_.bond[i];
+                        if (!net.alive.test(s)) continue;
+                        std::uint32_t a = 0, b = 0;
+                        net.endpoints(s, a, b);
+                        double d[3];
+                        K::bond_vector(x, static_cast<int>(a), static_cast<int>(b), net.box, d);
+                        const double r = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                        const double dr = r - (variable ? double(net.rest_len[s]) : net.r0);
+                        const double fbond = (r > 0.0) ? -2.0 * net.k * dr / r : 0.0;
+                        energy += net.k * dr * dr;
+                        for (int k = 0; k < K::dimension; ++k) {
+                            f[3 * a + k] += fbond * d[k];
+                            f[3 * b + k] -= fbond * d[k];
+                        }
+                    }
+                    partial_[first_block_[c] + blk] = energy;
+                }
+                if (threads > 1) barrier_.wait();
+            }
+        };
+        pool_.run(work);
+        return reproducible_sum(partial_.data(), partial_.size());
+    }
+
+private:
+    const BondColoring& coloring_;
+    WorkerPool pool_;
+    Barrier barrier_;
+    std::vector<std::uint32_t> first_block_;  // primeiro bloco de cada classe (num_colors + 1)
+    std::vector<double> partial_;             // energia por bloco
+};
+
+// Tempo por avaliação do laço serial e do colorido com 1, 2, 4, ...,
+// `max_threads` threads, e o maior desvio das forças em relação ao serial.
+template <class K>
+void benchmark_forces(const Network& net, const BondColoring& coloring, int max_threads, std::ostream& out) {
+    const std::size_t n3 = 3 * static_cast<std::size_t>(net.num_atoms);
+    const int reps = static_cast<int>(std::max<std::uint32_t>(5, 20000000u / std::max<std::uint32_t>(net.num_bonds, 1)));
+    std::vector<double> reference(n3), f(n3);
+    auto time_per_eval = [&](auto&& eval) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < reps; ++r) {
+            std::fill(f.begin(), f.end(), 0.0);
+            eval();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return 1.0e3 * elapsed.count() / reps;
+    };
+
+    const double serial_ms = time_per_eval([&] { network_forces<K>(net, net.x.data(), f.data()); });
+    reference = f;
+    out << "Info: forças (" << reps << " avaliações): serial " << serial_ms << " ms" << std::endl;
+    double one_ms = 0.0;
+    for (int t = 1; t <= max_threads; t = (t < max_threads && 2 * t > max_threads) ? max_threads : 2 * t) {
+        ColoredForces colored(coloring, t);
+        const double ms = time_per_eval([&] { colored.compute<K>(net, net.x.data(), f.data()); });
+        if (t == 1) one_ms = ms;
+        double deviation = 0.0;
+        for (std::size_t i = 0; i < n3; ++i) deviation = std::max(deviation, std::fabs(f[i] - reference[i]));
+        out << "Info: forças coloridas, " << t << " threads: " << ms << " ms (speedup " << one_ms / ms
+            << ", eficiência " << std::lround(100.0 * one_ms / (ms * t)) << "%), desvio máximo " << deviation << std::endl;
+    }
+}
+
+}  // namespace spring
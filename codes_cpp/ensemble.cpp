@@ -0,0 +1,191 @@
+// ensemble.cpp
+
+#include "ensemble.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+#include "parallel.h"
+
+namespace spring {
+
+void RealizationSummary::add_step(double strain_value, double stress_value) {
+    strain.push_back(static_cast<float>(strain_value));
+    stress.push_back(static_cast<float>(stress_value));
+    if (stress_value > peak_stress) {
+        peak_stress = stress_value;
+        failure_strain = strain_value;
+    }
+}
+
+std::size_t RealizationSummary::bytes() const {
+    return (strain.capacity() + stress.capacity()) * sizeof(float) +
+           (avalanches.capacity() + trees.capacity()) * sizeof(std::uint32_t) + sizeof(*this);
+}
+
+std::size_t EnsembleAggregator::bytes() const {
+    std::size_t total = 0;
+    for (const RealizationSummary& r : runs_) total += r.bytes();
+    return total;
+}
+
+namespace {
+
+// Curva (0, 0), (strain_i, stress_i) interpolada linearmente em `grid`;
+// além do último ponto vale o último valor.
+void interpolate(const RealizationSummary& run, const std::vector<double>& grid, double* out) {
+    std::size_t i = 0;
+    for (std::size_t k = 0; k < grid.size(); ++k) {
+        const double g = grid[k];
+        while (i < run.strain.size() && run.strain[i] < g) ++i;
+        if (run.strain.empty()) {
+            out[k] = 0.0;
+        } else if (i == run.strain.size()) {
+            out[k] = run.stress.back();
+        } else {
+            const double s1 = run.strain[i], f1 = run.stress[i];
+            const double s0 = (i > 0) ? run.strain[i - 1] : 0.0, f0 = (i > 0) ? run.stress[i - 1] : 0.0;
+            out[k] = (s1 > s0) ? f0 + (f1 - f0) * (g - s0) / (s1 - s0) : f1;
+        }
+    }
+}
+
+std::size_t size_bin(std::uint32_t s) {
+    std::size_t b = 0;
+    while ((std::uint64_t(1) << (b + 1)) <= s) ++b;
+    return b;  // [2^b, 2^(b+1))
+}
+
+// Percentil com interpolação linear entre postos (valores já ordenados)
+double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    const double pos = q * (sorted.size() - 1);
+    const std::size_t lo = static_cast<std::size_t>(std::floor(pos));
+    const std::size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+}
+
+}  // namespace
+
+void EnsembleAggregator::report(std::ostream& out, const BootstrapSettings& settings) const {
+    const std::size_t R = runs_.size();
+    if (R == 0) throw std::runtime_error("Erro: ensemble vazio");
+
+    // --- Grade comum de deformação ---
+    double smax = 0.0;
+    std::size_t max_steps = 0;
+    for (const RealizationSummary& r : runs_) {
+        if (!r.strain.empty()) smax = std::max(smax, double(r.strain.back()));
+        max_steps = std::max(max_steps, r.strain.size());
+    }
+    const std::size_t G = settings.grid_points > 0 ? std::size_t(settings.grid_points) : std::max<std::size_t>(1, max_steps);
+    std::vector<double> grid(G);
+    for (std::size_t k = 0; k < G; ++k) grid[k] = smax * double(k + 1) / double(G);
+
+    // --- Resumos por realização no formato do bootstrap ---
+    // Histogramas log2 por realização: avalanches por passo e árvores causais
+    std::size_t nbins = 0, tbins = 0;
+    for (const RealizationSummary& r : runs_) {
+        for (std::uint32_t s : r.avalanches) nbins = std::max(nbins, size_bin(s) + 1);
+        for (std::uint32_t s : r.trees) tbins = std::max(tbins, size_bin(s) + 1);
+    }
+    std::vector<double> curves(R * G);
+    std::vector<double> counts(R * nbins, 0.0), totals(R, 0.0);
+    std::vector<double> tree_counts(R * tbins, 0.0), tree_totals(R, 0.0);
+    for (std::size_t r = 0; r < R; ++r) {
+        interpolate(runs_[r], grid, &curves[r * G]);
+        for (std::uint32_t s : runs_[r].avalanches) counts[r * nbins + size_bin(s)] += 1.0;
+        totals[r] = double(runs_[r].avalanches.size());
+        for (std::uint32_t s : runs_[r].trees) tree_counts[r * tbins + size_bin(s)] += 1.0;
+        tree_totals[r] = double(runs_[r].trees.size());
+    }
+
+    // Estatísticas de uma amostra (índices de realizações): curva média,
+    // P(S), distribuição das árvores, deformação de falha e tensão de pico
+    // médias.
+    const std::size_t T0 = G + nbins, F = T0 + tbins;
+    const std::size_t M = F + 2;
+    auto statistics = [&](const std::size_t* sample, double* stat) {
+        std::fill(stat, stat + M, 0.0);
+        double events = 0.0, tree_events = 0.0;
+        for (std::size_t i = 0; i < R; ++i) {
+            const std::size_t r = sample[i];
+            for (std::size_t k = 0; k < G; ++k) stat[k] += curves[r * G + k];
+            for (std::size_t b = 0; b < nbins; ++b) stat[G + b] += counts[r * nbins + b];
+            for (std::size_t b = 0; b < tbins; ++b) stat[T0 + b] += tree_counts[r * tbins + b];
+            events += totals[r];
+            tree_events += tree_totals[r];
+            stat[F] += runs_[r].failure_strain;
+            stat[F + 1] += runs_[r].peak_stress;
+        }
+        for (std::size_t k = 0; k < G; ++k) stat[k] /= double(R);
+        for (std::size_t b = 0; b < nbins; ++b) stat[G + b] = (events > 0.0) ? stat[G + b] / events : 0.0;
+        for (std::size_t b = 0; b < tbins; ++b) stat[T0 + b] = (tree_events > 0.0) ? stat[T0 + b] / tree_events : 0.0;
+        stat[F] /= double(R);
+        stat[F + 1] /= double(R);
+    };
+
+    std::vector<std::size_t> identity(R);
+    for (std::size_t r = 0; r < R; ++r) identity[r] = r;
+    std::vector<double> estimate(M);
+    statistics(identity.data(), estimate.data());
+
+    // --- Reamostragem em blocos com geradores próprios ---
+    const std::size_t B = static_cast<std::size_t>(std::max(0, settings.resamples));
+    const std::size_t block = static_cast<std::size_t>(std::max(1, settings.block));
+    const std::size_t nblocks = (B + block - 1) / block;
+    std::vector<double> boot(B * M);
+    parallel_for(nblocks, settings.threads, [&](std::size_t begin, std::size_t end, int) {
+        std::vector<std::size_t> sample(R);
+        for (std::size_t blk = begin; blk < end; ++blk) {
+            std::mt19937_64 rng(settings.seed * 0x9E3779B97F4A7C15ULL + blk + 1);
+            std::uniform_int_distribution<std::size_t> pick(0, R - 1);
+            for (std::size_t b = blk * block; b < std::min(B, (blk + 1) * block); ++b) {
+                for (std::size_t i = 0; i < R; ++i) sample[i] = pick(rng);
+                statistics(sample.data(), &boot[b * M]);
+            }
+        }
+    });
+
+    // Intervalos de percentil por coluna (em paralelo por coluna)
+    const double qlo = 0.5 * (1.0 - settings.confidence), qhi = 0.5 * (1.0 + settings.confidence);
+    std::vector<double> lo(M, 0.0), hi(M, 0.0);
+    parallel_for(M, settings.threads, [&](std::size_t begin, std::size_t end, int) {
+        std::vector<double> column(B);
+        for (std::size_t m = begin; m < end; ++m) {
+            for (std::size_t b = 0; b < B; ++b) column[b] = boot[b * M + m];
+            std::sort(column.begin(), column.end());
+            lo[m] = B ? percentile(column, qlo) : estimate[m];
+            hi[m] = B ? percentile(column, qhi) : estimate[m];
+        }
+    });
+
+    // --- Relatório (uma passada) ---
+    out << "# ensemble: " << R << " realizations, " << B << " bootstrap resamples, confidence "
+        << settings.confidence << "\n";
+    out << "# failure_strain,mean,lo,hi\n";
+    out << "failure_strain," << estimate[F] << ',' << lo[F] << ',' << hi[F] << "\n";
+    out << "# peak_stress,mean,lo,hi\n";
+    out << "peak_stress," << estimate[F + 1] << ',' << lo[F + 1] << ',' << hi[F + 1] << "\n";
+    out << "# stress_strain: strain,mean,lo,hi\n";
+    for (std::size_t k = 0; k < G; ++k) {
+        out << grid[k] << ',' << estimate[k] << ',' << lo[k] << ',' << hi[k] << "\n";
+    }
+    out << "# avalanche_size: s_lo,s_hi,P,lo,hi\n";
+    for (std::size_t b = 0; b < nbins; ++b) {
+        const std::size_t m = G + b;
+        out << (std::uint64_t(1) << b) << ',' << (std::uint64_t(1) << (b + 1)) << ',' << estimate[m] << ','
+            << lo[m] << ',' << hi[m] << "\n";
+    }
+    out << "# tree_size: s_lo,s_hi,P,lo,hi\n";
+    for (std::size_t b = 0; b < tbins; ++b) {
+        const std::size_t m = T0 + b;
+        out << (std::uint64_t(1) << b) << ',' << (std::uint64_t(1) << (b + 1)) << ',' << estimate[m] << ','
+            << lo[m] << ',' << hi[m] << "\n";
+    }
+    out.flush();
+}
+
+}  // namespace spring
@@ -0,0 +1,64 @@
+// ensemble.h
+//
+// Agregação do ensemble de realizações com intervalos de confiança bootstrap.
+//
+// Cada realização deixa um resumo compacto (curva tensão-deformação em
+// float32, tamanhos de avalanche e deformação de falha); nada de posições ou
+// dumps. Ao final da varredura, `EnsembleAggregator::report` escreve, numa
+// única passada:
+// - a curva média interpolada numa grade comum de deformação, com banda de
+//   confiança;
+// - P(S) em bins log2, normalizada por avalanche, com banda de confiança,
+//   com S o número de ligações quebradas num passo de carregamento (passos
+//   sem quebras não contam); a distribuição dos tamanhos das árvores causais
+//   (avalanche.h) sai à parte, no mesmo formato;
+// - média da deformação de falha (deformação no pico de tensão) e da tensão
+//   de pico, com intervalos.
+//
+// O bootstrap reamostra realizações com reposição. As reamostragens são
+// feitas em paralelo em blocos fixos de `block` reamostras; cada bloco tem
+// seu próprio gerador (semeado por (seed, bloco)), de modo que o resultado
+// não depende do número de threads. Os intervalos são percentis.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace spring {
+
+struct RealizationSummary {
+    std::vector<float> strain;              // deslocamento da parede / altura, por passo
+    std::vector<float> stress;              // força na parede / largura
+    std::vector<std::uint32_t> avalanches;  // ligações quebradas por passo (S > 0)
+    std::vector<std::uint32_t> trees;       // tamanhos das árvores causais
+    double failure_strain = 0.0;
+    double peak_stress = 0.0;
+
+    void add_step(double strain_value, double stress_value);
+    std::size_t bytes() const;
+};
+
+struct BootstrapSettings {
+    int resamples = 1000;
+    double confidence = 0.95;
+    int grid_points = 0;  // 0: número máximo de passos das realizações
+    std::uint64_t seed = 1;
+    int threads = 1;
+    int block = 32;
+};
+
+class EnsembleAggregator {
+public:
+    void add(RealizationSummary summary) { runs_.push_back(std::move(summary)); }
+    std::size_t size() const { return runs_.size(); }
+    std::size_t bytes() const;
+
+    void report(std::ostream& out, const BootstrapSettings& settings) const;
+
+private:
+    std::vector<RealizationSummary> runs_;
+};
+
+}  // namespace spring
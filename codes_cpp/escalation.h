@@ -0,0 +1,127 @@
+// escalation.h
+//
+// Telemetria das relaxações e recuperação automática quando uma delas para
+// num limite.
+//
+// `minimize 1.0e-5 1.0e-7 1000 10000` pode parar em maxiter ou maxeval sem
+// aviso, e a varredura de quebras roda então sobre um estado sem convergir.
+// Cada `RelaxResult` traz iterações, avaliações, |f| final e o motivo da
+// parada (relax.h). Quando o motivo é um dos limites, `RelaxEscalation`
+// continua a partir do estado atual numa escada de três degraus, até um
+// deles convergir:
+//
+//   1. o mesmo backend, com limites 10x maiores;
+//   2. outro método (Newton-Krylov; FIRE se o backend já for Newton);
+//   3. CG com a busca linear mais curta (dmax / 10) e limites 10x maiores.
+//
+// Os backends de recuperação só são criados na primeira escalada.
+// `RelaxTelemetry` conta os motivos de parada das relaxações (após a
+// recuperação), as que atingiram um limite, as recuperadas em cada degrau e
+// as que seguiram sem convergir, para o resumo do fim da execução.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "relax.h"
+
+namespace spring {
+
+struct RelaxTelemetry {
+    static constexpr int num_reasons = 5;
+    static constexpr int num_levels = 3;
+
+    long long calls = 0;
+    long long stops[num_reasons] = {};
+    long long capped = 0;                // a primeira tentativa parou num limite
+    long long recovered[num_levels] = {};
+    long long unconverged = 0;           // nem a escada convergiu
+    double max_fnorm = 0.0;              // maior |f| final das convergidas
+
+    void add(const RelaxResult& r) {
+        ++calls;
+        ++stops[static_cast<int>(r.stop)];
+        if (r.escalations > 0) ++capped;
+        if (!r.converged()) ++unconverged;
+        else if (r.escalations > 0) ++recovered[r.escalations - 1];
+        if (r.converged()) max_fnorm = std::max(max_fnorm, r.fnorm);
+    }
+
+    void print(std::ostream& out) const {
+        out << "Info: relaxações: " << calls << " (";
+        bool first = true;
+        for (int s = 0; s < num_reasons; ++s) {
+            if (stops[s] == 0) continue;
+            out << (first ? "" : ", ") << stop_reason_name(static_cast<StopReason>(s)) << " " << stops[s];
+            first = false;
+        }
+        out << "); |f| máximo das convergidas " << max_fnorm << std::endl;
+        if (capped > 0) {
+            out << "Info: " << capped << " relaxações atingiram um limite: recuperadas com mais iterações "
+                << recovered[0] << ", com outro método " << recovered[1] << ", com busca linear mais curta "
+                << recovered[2] << "; sem convergir " << unconverged << std::endl;
+        }
+    }
+};
+
+template <class K>
+class RelaxEscalation {
+public:
+    // Recupera `result` (de `primary`) se ele parou num limite; acumula
+    // iterações e avaliações de todos os degraus e devolve o resultado do
+    // último. `result.escalations` diz quantos degraus foram usados.
+    RelaxResult recover(RelaxBackend<K>& primary, Network& net, const RelaxSettings& settings, RelaxResult result) {
+        if (result.converged()) return result;
+        RelaxSettings longer = settings;
+        longer.maxiter *= 10;
+        longer.maxeval *= 10;
+        for (int level = 1; level <= 3 && !result.converged(); ++level) {
+            RelaxSettings stage = longer;
+            RelaxBackend<K>* backend = &primary;
+            if (level == 2) {
+                if (!alternate_) {
+                    if (std::string(primary.name()) == "newton") alternate_ = std::make_unique<FireRelax<K>>();
+                    else alternate_ = std::make_unique<NewtonRelax<K>>();
+                }
+                backend = alternate_.get();
+            } else if (level == 3) {
+                if (!careful_) careful_ = std::make_unique<CgRelax<K>>();
+                backend = careful_.get();
+                stage.dmax = 0.1 * settings.dmax;
+            }
+            const RelaxResult next = backend->relax(net, stage);
+            result.iterations += next.iterations;
+            result.force_evals += next.force_evals;
+            result.linear_iterations += next.linear_iterations;
+            result.energy = next.energy;
+            result.fnorm = next.fnorm;
+            result.wall_force = next.wall_force;
+            result.stop = next.stop;
+            result.escalations = level;
+        }
+        return result;
+    }
+
+    static const char* level_name(int level) {
+        switch (level) {
+            case 1: return "more iterations";
+            case 2: return "alternate solver";
+            case 3: return "shorter line search";
+        }
+        return "none";
+    }
+
+    std::size_t workspace_bytes() const {
+        return (alternate_ ? alternate_->workspace_bytes() : 0) + (careful_ ? careful_->workspace_bytes() : 0);
+    }
+
+private:
+    std::unique_ptr<RelaxBackend<K>> alternate_;
+    std::unique_ptr<CgRelax<K>> careful_;
+};
+
+}  // namespace spring
@@ -0,0 +1,160 @@
+// generator.cpp
+
+#include "generator.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace spring {
+
+bool is_unbreakable(const TriangularLattice& lat, std::uint32_t node, int dir, int L_matrix) {
+    if (L_matrix <= 0) return false;  // No matrix structure
+    const std::uint32_t L = static_cast<std::uint32_t>(L_matrix);
+    const std::uint32_t j = node / lat.N, i = node % lat.N;
+    // Horizontal unbreakable spring on rows that are multiples of L_matrix
+    if (dir == 0) return j % L == 0;
+    // Zigzag unbreakable spring: same column index, column multiple of L_matrix
+    if (dir == 1) return i % L == 0;
+    return false;
+}
+
+Network generate_lattice_network(const LatticeSpec& spec, bool implicit) {
+    if (spec.N < 3) {
+        throw std::runtime_error("Erro: a rede triangular exige N >= 3");
+    }
+    std::cout << "Info: Gerando rede " << spec.N << "x" << spec.N << " com L_matrix=" << spec.L_matrix
+              << " (seed " << spec.seed << ", p = " << spec.dilution << ")" << std::endl;
+
+    Network net;
+    TriangularLattice lat{spec.N};
+    const std::uint32_t N = spec.N;
+    net.num_atoms = lat.num_nodes();
+    net.x.assign(3 * static_cast<std::size_t>(net.num_atoms), 0.0);
+    net.atom_type.assign(net.num_atoms, atom_mobile);
+    for (std::uint32_t j = 0; j < N; ++j) {
+        for (std::uint32_t i = 0; i < N; ++i) {
+            const std::uint32_t node = j * N + i;
+            net.x[3 * node] = (i + 0.5 * (j % 2)) * spec.l0;
+            net.x[3 * node + 1] = j * spec.l0 * std::sqrt(3.0) / 2.0;
+            if (j == 0) net.atom_type[node] = atom_bottom;
+            else if (j == N - 1) net.atom_type[node] = atom_top;
+        }
+    }
+
+    const double ymax = (N - 1) * spec.l0 * std::sqrt(3.0) / 2.0;
+    const double boxlo[3] = {-0.25 * spec.l0, -1.0, -1.0};
+    const double boxhi[3] = {-0.25 * spec.l0 + N * spec.l0, ymax + 1.0, 1.0};
+    net.box = Box::from_bounds(boxlo, boxhi);
+
+    // Limiares na ordem (nó, direção); os slots inexistentes ficam inativos
+    std::mt19937_64 rng(spec.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::mt19937_64 dilution_rng(spec.seed ^ 0xD1B54A32D192ED03ULL);
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> slot_threshold(lat.num_slots(), inf);
+    std::vector<char> slot_exists(lat.num_slots(), 0);
+    for (std::uint32_t node = 0; node < lat.num_nodes(); ++node) {
+        for (int dir = 0; dir < TriangularLattice::num_directions; ++dir) {
+            std::uint32_t other;
+            if (!lat.neighbor(node, dir, other)) continue;
+            if (spec.dilution < 1.0 && uniform(dilution_rng) >= spec.dilution) continue;
+            const std::uint32_t s = lat.slot(node, dir);
+            slot_exists[s] = 1;
+            if (!is_unbreakable(lat, node, dir, spec.L_matrix)) {
+                const double len = spec.l0 * (1.0 + uniform(rng));
+                slot_threshold[s] = static_cast<float>(len * len);
+            }
+        }
+    }
+
+    if (implicit) {
+        net.implicit = true;
+        net.lattice = lat;
+        net.num_bonds = lat.num_slots();
+        net.break_len_sq = std::move(slot_threshold);
+        net.alive.assign(net.num_bonds, false);
+        for (std::uint32_t s = 0; s < net.num_bonds; ++s) {
+            if (slot_exists[s]) {
+                net.alive.set(s);
+                ++net.num_physical_bonds;
+            }
+        }
+    } else {
+        net.bond_atom1.reserve(lat.num_slots());
+        net.bond_atom2.reserve(lat.num_slots());
+        net.break_len_sq.reserve(lat.num_slots());
+        for (std::uint32_t node = 0; node < lat.num_nodes(); ++node) {
+            for (int dir = 0; dir < TriangularLattice::num_directions; ++dir) {
+                const std::uint32_t s = lat.slot(node, dir);
+                if (!slot_exists[s]) continue;
+                std::uint32_t other;
+                lat.neighbor(node, dir, other);
+                net.bond_atom1.push_back(node);
+                net.bond_atom2.push_back(other);
+                net.break_len_sq.push_back(slot_threshold[s]);
+            }
+        }
+        net.num_bonds = net.num_physical_bonds = static_cast<std::uint32_t>(net.bond_atom1.size());
+        net.alive.assign(net.num_bonds, true);
+    }
+
+    std::cout << "Info: Rede gerada com " << net.num_atoms << " átomos e " << net.num_physical_bonds
+              << " ligações" << (implicit ? " (implícita)." : ".") << std::endl;
+    return net;
+}
+
+bool convert_to_implicit(Network& net) {
+    if (net.implicit) return true;
+    const std::uint32_t N = static_cast<std::uint32_t>(std::lround(std::sqrt(double(net.num_atoms))));
+    if (N < 3 || N * N != net.num_atoms) return false;
+    TriangularLattice lat{N};
+
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> slot_threshold(lat.num_slots(), inf);
+    BondMask slot_alive;
+    slot_alive.assign(lat.num_slots(), false);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        const std::uint32_t a1 = net.bond_atom1[b], a2 = net.bond_atom2[b];
+        std::uint32_t s = lat.num_slots();
+        for (int dir = 0; dir < TriangularLattice::num_directions && s == lat.num_slots(); ++dir) {
+            std::uint32_t other;
+            if (lat.neighbor(a1, dir, other) && other == a2) s = lat.slot(a1, dir);
+            else if (lat.neighbor(a2, dir, other) && other == a1) s = lat.slot(a2, dir);
+        }
+        if (s == lat.num_slots() || slot_alive.test(s)) return false;
+        slot_alive.set(s);
+        slot_threshold[s] = net.break_len_sq[b];
+    }
+    // A rede precisa cobrir todos os slots existentes, inclusive os quebrados
+    // (mantidos com bit 0): exige-se aqui a rede completa.
+    for (std::uint32_t s = 0; s < lat.num_slots(); ++s) {
+        std::uint32_t a, b;
+        if (lat.endpoints(s, a, b) != slot_alive.test(s)) return false;
+    }
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        if (!net.alive.test(b)) {
+            // ligação quebrada antes da conversão
+            std::uint32_t a1 = net.bond_atom1[b], a2 = net.bond_atom2[b];
+            for (int dir = 0; dir < TriangularLattice::num_directions; ++dir) {
+                std::uint32_t other = 0;
+                if (lat.neighbor(a1, dir, other) && other == a2) slot_alive.reset(lat.slot(a1, dir));
+                if (lat.neighbor(a2, dir, other) && other == a1) slot_alive.reset(lat.slot(a2, dir));
+            }
+        }
+    }
+
+    net.implicit = true;
+    net.lattice = lat;
+    net.num_bonds = lat.num_slots();
+    net.bond_atom1.clear();
+    net.bond_atom1.shrink_to_fit();
+    net.bond_atom2.clear();
+    net.bond_atom2.shrink_to_fit();
+    net.break_len_sq = std::move(slot_threshold);
+    net.alive = std::move(slot_alive);
+    return true;
+}
+
+}  // namespace spring
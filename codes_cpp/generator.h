@@ -0,0 +1,36 @@
+// generator.h
+//
+// Gerador em processo das redes de create_network.py, sem passar por
+// arquivos de dados.
+
+#pragma once
+
+#include <cstdint>
+
+#include "network.h"
+
+namespace spring {
+
+struct LatticeSpec {
+    std::uint32_t N = 12;
+    int L_matrix = 4;
+    std::uint64_t seed = 1;
+    double l0 = 1.0;
+    double dilution = 1.0;  // probabilidade de cada ligação existir
+};
+
+// Porta de is_unbreakable() para uma ligação (nó, direção) da rede triangular.
+bool is_unbreakable(const TriangularLattice& lat, std::uint32_t node, int dir, int L_matrix);
+
+// Porta de create_spring_network() + write_lammps_data_file(): posições,
+// tipos de átomo (fundo/topo), ligações inquebráveis do L_matrix e limiares
+// l0 * (1 + U(0, 1)). O período em x é N * l0, o da própria rede.
+// Com dilution < 1, cada ligação é mantida com essa probabilidade.
+Network generate_lattice_network(const LatticeSpec& spec, bool implicit);
+
+// Converte uma rede explícita para o modo implícito se sua conectividade for
+// exatamente a rede triangular N x N (átomos em ordem de id). Retorna false e
+// não altera a rede caso contrário.
+bool convert_to_implicit(Network& net);
+
+}  // namespace spring
@@ -0,0 +1,118 @@
+// graph.cpp
+
+#include "graph.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace spring {
+
+Adjacency build_adjacency(const Network& net) {
+    Adjacency adj;
+    adj.offsets.assign(net.num_atoms + 1, 0);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        ++adj.offsets[a1 + 1];
+        ++adj.offsets[a2 + 1];
+    }
+    for (std::uint32_t a = 0; a < net.num_atoms; ++a) adj.offsets[a + 1] += adj.offsets[a];
+    adj.neighbors.resize(adj.offsets.back());
+    adj.bonds.resize(adj.offsets.back());
+    std::vector<std::uint32_t> fill(adj.offsets.begin(), adj.offsets.end() - 1);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        adj.neighbors[fill[a1]] = a2;
+        adj.bonds[fill[a1]++] = b;
+        adj.neighbors[fill[a2]] = a1;
+        adj.bonds[fill[a2]++] = b;
+    }
+    return adj;
+}
+
+std::uint64_t hilbert_index(double x, double y, const Box& box) {
+    const std::uint32_t side = 1u << 16;
+    auto quantize = [&](double v, int axis) {
+        const double t = (v - box.lo[axis]) * box.inv_period[axis];
+        const double q = std::min(std::max(t, 0.0), 1.0) * (side - 1);
+        return static_cast<std::uint32_t>(q);
+    };
+    std::uint32_t qx = quantize(x, 0), qy = quantize(y, 1);
+    std::uint64_t d = 0;
+    for (std::uint32_t s = side / 2; s > 0; s /= 2) {
+        const std::uint32_t rx = (qx & s) ? 1 : 0;
+        const std::uint32_t ry = (qy & s) ? 1 : 0;
+        d += std::uint64_t(s) * s * ((3 * rx) ^ ry);
+        // rotação do quadrante
+        if (ry == 0) {
+            if (rx == 1) {
+                qx = side - 1 - qx;
+                qy = side - 1 - qy;
+            }
+            std::swap(qx, qy);
+        }
+    }
+    return d;
+}
+
+std::vector<std::uint32_t> reorder_network(Network& net) {
+    if (net.implicit) {
+        throw std::runtime_error("Erro: a renumeração exige uma rede explícita");
+    }
+    const std::uint32_t n = net.num_atoms;
+    std::vector<std::uint64_t> key(n);
+    for (std::uint32_t a = 0; a < n; ++a) key[a] = hilbert_index(net.x[3 * a], net.x[3 * a + 1], net.box);
+    std::vector<std::uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return key[a] < key[b]; });
+
+    std::vector<std::uint32_t> new_index(n);
+    std::vector<double> x(net.x.size());
+    std::vector<std::uint8_t> atom_type(n);
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const std::uint32_t a = order[i];
+        new_index[a] = i;
+        for (int c = 0; c < 3; ++c) x[3 * i + c] = net.x[3 * a + c];
+        atom_type[i] = net.atom_type[a];
+    }
+    net.x = std::move(x);
+    net.atom_type = std::move(atom_type);
+
+    // Ligações: endpoints renumerados (menor primeiro) e ordenados
+    const std::uint32_t m = net.num_bonds;
+    for (std::uint32_t b = 0; b < m; ++b) {
+        std::uint32_t a1 = new_index[net.bond_atom1[b]], a2 = new_index[net.bond_atom2[b]];
+        if (a2 < a1) std::swap(a1, a2);
+        net.bond_atom1[b] = a1;
+        net.bond_atom2[b] = a2;
+    }
+    std::vector<std::uint32_t> bond_order(m);
+    std::iota(bond_order.begin(), bond_order.end(), 0u);
+    std::sort(bond_order.begin(), bond_order.end(), [&](std::uint32_t p, std::uint32_t q) {
+        if (net.bond_atom1[p] != net.bond_atom1[q]) return net.bond_atom1[p] < net.bond_atom1[q];
+        return net.bond_atom2[p] < net.bond_atom2[q];
+    });
+
+    std::vector<std::uint32_t> atom1(m), atom2(m);
+    std::vector<float> threshold(m), rest(net.rest_len.empty() ? 0 : m);
+    BondMask alive;
+    alive.assign(m, false);
+    for (std::uint32_t i = 0; i < m; ++i) {
+        const std::uint32_t b = bond_order[i];
+        atom1[i] = net.bond_atom1[b];
+        atom2[i] = net.bond_atom2[b];
+        threshold[i] = net.break_len_sq[b];
+        if (!rest.empty()) rest[i] = net.rest_len[b];
+        if (net.alive.test(b)) alive.set(i);
+    }
+    net.bond_atom1 = std::move(atom1);
+    net.bond_atom2 = std::move(atom2);
+    net.break_len_sq = std::move(threshold);
+    net.rest_len = std::move(rest);
+    net.alive = std::move(alive);
+    return new_index;
+}
+
+}  // namespace spring
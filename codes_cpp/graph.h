@@ -0,0 +1,38 @@
+// graph.h
+//
+// Adjacência CSR dos átomos pelas ligações ativas e renumeração dos átomos
+// pela curva de Hilbert.
+//
+// Em redes irregulares (diluídas, Delaunay) a ordem dos átomos no arquivo não
+// tem relação com a vizinhança; renumerar pela curva de Hilbert e ordenar as
+// ligações pelo primeiro átomo devolve às varreduras de forças e de quebras o
+// acesso quase sequencial a x que a rede triangular tem por construção.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "network.h"
+
+namespace spring {
+
+struct Adjacency {
+    std::vector<std::uint32_t> offsets;    // num_atoms + 1
+    std::vector<std::uint32_t> neighbors;  // átomo vizinho
+    std::vector<std::uint32_t> bonds;      // ligação correspondente
+
+    std::uint32_t degree(std::uint32_t a) const { return offsets[a + 1] - offsets[a]; }
+};
+
+Adjacency build_adjacency(const Network& net);
+
+// Índice na curva de Hilbert (ordem 2^16 por eixo) do ponto (x, y) da caixa.
+std::uint64_t hilbert_index(double x, double y, const Box& box);
+
+// Renumera os átomos na ordem de Hilbert e ordena as ligações por
+// (átomo1, átomo2), permutando limiares, comprimentos de repouso e bits
+// ativos. Apenas redes explícitas; retorna a permutação (antigo -> novo).
+std::vector<std::uint32_t> reorder_network(Network& net);
+
+}  // namespace spring
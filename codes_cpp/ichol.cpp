@@ -0,0 +1,222 @@
+// ichol.cpp
+
+#include "ichol.h"
+
+namespace spring {
+
+namespace {
+
+const int kIdx[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+
+}  // namespace
+
+IncompleteCholesky::IncompleteCholesky(const Network& net, int dimension, double tile) : dim_(dimension) {
+    const std::uint32_t n = net.num_atoms;
+
+    // Ligações por átomo (CSR)
+    adj_start_.assign(n + 1, 0);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2) || a1 == a2) continue;
+        ++adj_start_[a1 + 1];
+        ++adj_start_[a2 + 1];
+    }
+    for (std::uint32_t i = 0; i < n; ++i) adj_start_[i + 1] += adj_start_[i];
+    adj_bond_.resize(adj_start_[n]);
+    {
+        std::vector<std::size_t> fill(adj_start_.begin(), adj_start_.end() - 1);
+        for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+            std::uint32_t a1, a2;
+            if (!net.alive.test(b) || !net.endpoints(b, a1, a2) || a1 == a2) continue;
+            adj_bond_[fill[a1]++] = b;
+            adj_bond_[fill[a2]++] = b;
+        }
+    }
+
+    // Vizinhos de índice menor, ordenados e sem repetição
+    lower_start_.assign(n + 1, 0);
+    std::vector<std::uint32_t> nb;
+    for (std::uint32_t a = 0; a < n; ++a) {
+        nb.clear();
+        for (std::size_t e = adj_start_[a]; e < adj_start_[a + 1]; ++e) {
+            std::uint32_t a1 = 0, a2 = 0;
+            net.endpoints(adj_bond_[e], a1, a2);
+            const std::uint32_t other = (a1 == a) ? a2 : a1;
+            if (other < a) nb.push_back(other);
+        }
+        std::sort(nb.begin(), nb.end());
+        nb.erase(std::unique(nb.begin(), nb.end()), nb.end());
+        lower_.insert(lower_.end(), nb.begin(), nb.end());
+        lower_start_[a + 1] = lower_.size();
+    }
+
+    // Padrão de L: a linha (a, p) tem os blocos dos vizinhos menores, as
+    // componentes q < p do próprio átomo e a diagonal
+    const std::size_t dofs = dim_ * static_cast<std::size_t>(n);
+    row_start_.assign(dofs + 1, 0);
+    for (std::uint32_t a = 0; a < n; ++a) {
+        const std::size_t nl = lower_start_[a + 1] - lower_start_[a];
+        for (int p = 0; p < dim_; ++p) {
+            const std::size_t i = dim_ * std::size_t(a) + p;
+            row_start_[i + 1] = row_start_[i] + dim_ * nl + p + 1;
+        }
+    }
+    col_.resize(row_start_[dofs]);
+    l_.assign(row_start_[dofs], 0.0);
+    for (std::uint32_t a = 0; a < n; ++a) {
+        for (int p = 0; p < dim_; ++p) {
+            const std::size_t i = dim_ * std::size_t(a) + p;
+            std::size_t e = row_start_[i];
+            for (std::size_t t = lower_start_[a]; t < lower_start_[a + 1]; ++t) {
+                for (int q = 0; q < dim_; ++q) col_[e++] = static_cast<std::uint32_t>(dim_ * lower_[t] + q);
+            }
+            for (int q = 0; q <= p; ++q) col_[e++] = static_cast<std::uint32_t>(dim_ * a + q);
+        }
+    }
+    y_.assign(dofs, 0.0);
+
+    // Regiões pela posição inicial; cada ligação conta nas regiões das pontas
+    int cells[3] = {1, 1, 1};
+    for (int d = 0; d < dim_; ++d) {
+        const double extent = net.box.hi[d] - net.box.lo[d];
+        cells[d] = (tile > 0.0 && extent > tile) ? static_cast<int>(std::ceil(extent / tile)) : 1;
+    }
+    region_.assign(n, 0);
+    for (std::uint32_t a = 0; a < n; ++a) {
+        std::uint32_t r = 0;
+        for (int d = dim_ - 1; d >= 0; --d) {
+            const double extent = net.box.hi[d] - net.box.lo[d];
+            int c = (extent > 0.0) ? static_cast<int>((net.x[3 * a + d] - net.box.lo[d]) / extent * cells[d]) : 0;
+            c = std::min(std::max(c, 0), cells[d] - 1);
+            r = r * cells[d] + c;
+        }
+        region_[a] = r;
+    }
+    region_bonds_.assign(std::size_t(cells[0]) * cells[1] * cells[2], 0);
+    region_broken_.assign(region_bonds_.size(), 0);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        ++region_bonds_[region_[a1]];
+        if (region_[a2] != region_[a1]) ++region_bonds_[region_[a2]];
+    }
+    const std::uint64_t* alive = net.alive.words();
+    alive_.assign(alive, alive + (net.num_bonds + 63) / 64);
+}
+
+std::vector<std::uint32_t> IncompleteCholesky::damaged_regions(const Network& net, double limit) {
+    const std::size_t words = (net.num_bonds + 63) / 64;
+    const std::uint64_t* alive = net.alive.words();
+    for (std::size_t w = 0; w < words; ++w) {
+        std::uint64_t diff = alive_[w] ^ alive[w];
+        alive_[w] = alive[w];
+        while (diff) {
+            const std::uint32_t b = static_cast<std::uint32_t>(64 * w + __builtin_ctzll(diff));
+            diff &= diff - 1;
+            std::uint32_t a1, a2;
+            if (!net.endpoints(b, a1, a2)) continue;
+            ++region_broken_[region_[a1]];
+            if (region_[a2] != region_[a1]) ++region_broken_[region_[a2]];
+        }
+    }
+    std::vector<std::uint32_t> damaged;
+    for (std::uint32_t r = 0; r < region_broken_.size(); ++r) {
+        if (region_broken_[r] > 0 && region_broken_[r] >= limit * region_bonds_[r]) {
+            damaged.push_back(r);
+            region_broken_[r] = 0;
+        }
+    }
+    return damaged;
+}
+
+void IncompleteCholesky::assemble_row(const Network& net, std::uint32_t atom, const std::vector<BondStiffness>& blocks) {
+    const std::size_t first = dim_ * std::size_t(atom);
+    std::fill(l_.begin() + row_start_[first], l_.begin() + row_start_[first + dim_], 0.0);
+    const std::size_t lo = lower_start_[atom], nl = lower_start_[atom + 1] - lo;
+    for (const BondStiffness& s : blocks) {
+        const std::uint32_t other = (s.a == atom) ? s.b : s.a;
+        const bool coupled = other < atom && net.atom_type[other] == atom_mobile;
+        const std::size_t t = coupled
+            ? std::lower_bound(lower_.begin() + lo, lower_.begin() + lo + nl, other) - (lower_.begin() + lo)
+            : 0;
+        for (int p = 0; p < dim_; ++p) {
+            const std::size_t row = row_start_[first + p];
+            for (int q = 0; q < dim_; ++q) {
+                const double k = s.k[kIdx[p][q]];
+                if (q <= p) l_[row + dim_ * nl + q] += k;
+                if (coupled) l_[row + dim_ * t + q] -= k;
+            }
+        }
+    }
+}
+
+void IncompleteCholesky::factor_atom(std::uint32_t atom) {
+    for (int p = 0; p < dim_; ++p) {
+        const std::size_t i = dim_ * std::size_t(atom) + p;
+        const std::size_t begin = row_start_[i], diag = row_start_[i + 1] - 1;
+        const double a_ii = l_[diag];
+        if (!(a_ii > 0.0)) {
+            // Sem rigidez (átomo fixo ou solto): linha identidade
+            std::fill(l_.begin() + begin, l_.begin() + diag, 0.0);
+            l_[diag] = 1.0;
+            continue;
+        }
+        for (std::size_t e = begin; e < diag; ++e) {
+            const std::uint32_t j = col_[e];
+            // Produto das linhas i e j nas colunas < j (intercalação)
+            double sum = l_[e];
+            std::size_t u = begin, v = row_start_[j];
+            const std::size_t vend = row_start_[j + 1] - 1;
+            while (u < e && v < vend) {
+                if (col_[u] < col_[v]) {
+                    ++u;
+                } else if (col_[v] < col_[u]) {
+                    ++v;
+                } else {
+                    sum -= l_[u++] * l_[v++];
+                }
+            }
+            l_[e] = sum / l_[vend];
+        }
+        double pivot = a_ii;
+        for (std::size_t e = begin; e < diag; ++e) pivot -= l_[e] * l_[e];
+        if (pivot <= 1.0e-8 * a_ii) {
+            // Pivô quebrado: a linha fica com a diagonal de A
+            std::fill(l_.begin() + begin, l_.begin() + diag, 0.0);
+            pivot = a_ii;
+            ++breakdowns_;
+        }
+        l_[diag] = std::sqrt(pivot);
+    }
+}
+
+void IncompleteCholesky::apply(const Network& net, const double* r, double* z) const {
+    const std::size_t dofs = y_.size();
+    // L y = r
+    for (std::size_t i = 0; i < dofs; ++i) {
+        const std::size_t diag = row_start_[i + 1] - 1;
+        double sum = r[3 * (i / dim_) + i % dim_];
+        for (std::size_t e = row_start_[i]; e < diag; ++e) sum -= l_[e] * y_[col_[e]];
+        y_[i] = sum / l_[diag];
+    }
+    // L^T z = y, por colunas
+    for (std::size_t i = dofs; i-- > 0;) {
+        const std::size_t diag = row_start_[i + 1] - 1;
+        const double zi = y_[i] / l_[diag];
+        y_[i] = zi;
+        for (std::size_t e = row_start_[i]; e < diag; ++e) y_[col_[e]] -= l_[e] * zi;
+    }
+    for (std::uint32_t a = 0; a < net.num_atoms; ++a) {
+        const bool mobile = net.atom_type[a] == atom_mobile;
+        for (int c = 0; c < 3; ++c) z[3 * a + c] = (mobile && c < dim_) ? y_[dim_ * std::size_t(a) + c] : 0.0;
+    }
+}
+
+std::size_t IncompleteCholesky::bytes() const {
+    return (adj_start_.capacity() + lower_start_.capacity() + row_start_.capacity()) * sizeof(std::size_t) +
+           (adj_bond_.capacity() + lower_.capacity() + col_.capacity() + region_.capacity() +
+            region_bonds_.capacity() + region_broken_.capacity()) * sizeof(std::uint32_t) +
+           (l_.capacity() + y_.capacity()) * sizeof(double) + alive_.capacity() * sizeof(std::uint64_t);
+}
+
+}  // namespace spring
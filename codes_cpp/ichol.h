@@ -0,0 +1,188 @@
+// ichol.h
+//
+// Cholesky incompleto (IC(0)) com atualização preguiçosa sob dano.
+//
+// `IncompleteCholesky` fatora M = L L^T com L no padrão de esparsidade da
+// Hessiana (um bloco D x D por par de átomos ligados, na numeração natural
+// dos átomos), sobre a matriz com o termo de tensão truncado em zero de
+// linear.h (`bond_stiffness`). Átomos fixos são linhas identidade. Quando um
+// pivô quebra (fragmentos soltos, modos de núcleo), a linha fica com a
+// diagonal de A; qualquer L com diagonal positiva dá um M definido positivo,
+// então o precondicionador é sempre válido, só mais ou menos bom.
+//
+// Por isso a fatoração não precisa acompanhar cada quebra: M é construído uma
+// vez e reusado. A rede é dividida em regiões (quadrados de `tile` unidades de
+// comprimento, pela posição inicial dos átomos) e as quebras são contadas por
+// região; quando a fração quebrada de uma região passa do limite, só as
+// linhas dos átomos dela são recalculadas, com a geometria atual e as linhas
+// vizinhas como estão. Ver `IcRelax` para o critério por iterações.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "kernels.h"
+#include "linear.h"
+#include "network.h"
+#include "relax.h"
+
+namespace spring {
+
+class IncompleteCholesky {
+public:
+    IncompleteCholesky(const Network& net, int dimension, double tile);
+
+    // Regiões cuja fração de ligações quebradas desde a última atualização
+    // passou de `limit` (o contador de cada região devolvida é zerado).
+    std::vector<std::uint32_t> damaged_regions(const Network& net, double limit);
+
+    // Recalcula as linhas dos átomos das regiões dadas (todas se null).
+    // Retorna o número de linhas recalculadas.
+    template <class K>
+    std::size_t refresh(const Network& net, const std::vector<std::uint32_t>* regions);
+
+    // z = M^-1 r (passo 3 por átomo; zero nos átomos hoje fixos)
+    void apply(const Network& net, const double* r, double* z) const;
+
+    std::uint32_t num_regions() const { return static_cast<std::uint32_t>(region_bonds_.size()); }
+    std::size_t nonzeros() const { return col_.size(); }
+    std::size_t breakdowns() const { return breakdowns_; }
+    std::size_t bytes() const;
+
+private:
+    void assemble_row(const Network& net, std::uint32_t atom, const std::vector<BondStiffness>& blocks);
+    void factor_atom(std::uint32_t atom);
+
+    int dim_ = 2;
+    // Vizinhança: todas as ligações de cada átomo e os vizinhos de índice
+    // menor (sem repetição), que dão os blocos de L na linha do átomo
+    std::vector<std::size_t> adj_start_, lower_start_;
+    std::vector<std::uint32_t> adj_bond_, lower_;
+    // L por linhas (CSR, colunas crescentes, diagonal por último)
+    std::vector<std::size_t> row_start_;
+    std::vector<std::uint32_t> col_;
+    std::vector<double> l_;
+    std::size_t breakdowns_ = 0;
+    // Regiões
+    std::vector<std::uint32_t> region_, region_bonds_, region_broken_;
+    std::vector<std::uint64_t> alive_;
+    mutable std::vector<double> y_;
+};
+
+template <class K>
+std::size_t IncompleteCholesky::refresh(const Network& net, const std::vector<std::uint32_t>* regions) {
+    std::vector<std::uint8_t> marked;
+    if (regions) {
+        marked.assign(region_bonds_.size(), 0);
+        for (std::uint32_t r : *regions) marked[r] = 1;
+    } else {
+        breakdowns_ = 0;
+    }
+    // As linhas dependem das anteriores: recalcula na ordem dos átomos
+    std::size_t rows = 0;
+    std::vector<BondStiffness> blocks;
+    BondStiffness s;
+    for (std::uint32_t a = 0; a < net.num_atoms; ++a) {
+        if (regions && !marked[region_[a]]) continue;
+        blocks.clear();
+        if (net.atom_type[a] == atom_mobile) {
+            for (std::size_t e = adj_start_[a]; e < adj_start_[a + 1]; ++e) {
+                if (bond_stiffness<K>(net, adj_bond_[e], s)) blocks.push_back(s);
+            }
+        }
+        assemble_row(net, a, blocks);
+        factor_atom(a);
+        rows += dim_;
+    }
+    return rows;
+}
+
+// --- CG não linear precondicionado por IC(0) ---
+// Além das regiões danificadas, a fatoração inteira é refeita quando uma
+// relaxação precisa de mais de `degrade` vezes as iterações de referência
+// (o máximo das `window` primeiras relaxações depois da última fatoração
+// completa): a geometria se afastou de M em toda parte.
+template <class K>
+class IcRelax : public CgRelax<K> {
+public:
+    explicit IcRelax(double tile = 16.0, double limit = 0.01, double degrade = 2.0, int window = 4)
+        : tile_(tile), limit_(limit), degrade_(degrade), window_(window) {}
+
+    const char* name() const override { return "ic"; }
+
+    RelaxResult relax(Network& net, const RelaxSettings& settings) override {
+        RelaxResult result;
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!ichol_) {
+            ichol_ = std::make_unique<IncompleteCholesky>(net, K::dimension, tile_ * net.r0);
+            ichol_->refresh<K>(net, nullptr);
+            result.full_refreshes = 1;
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            std::cout << "Info: ic: IC(0) com " << ichol_->nonzeros() << " não nulos, " << ichol_->num_regions()
+                      << " regiões, " << ichol_->breakdowns() << " pivôs descartados; fatoração " << elapsed.count()
+                      << " s, " << ichol_->bytes() / (1024.0 * 1024.0) << " MiB" << std::endl;
+        } else if (full_due_) {
+            ichol_->damaged_regions(net, 0.0);
+            ichol_->refresh<K>(net, nullptr);
+            result.full_refreshes = 1;
+        } else {
+            const std::vector<std::uint32_t> damaged = ichol_->damaged_regions(net, limit_);
+            if (!damaged.empty()) {
+                ichol_->refresh<K>(net, &damaged);
+                result.local_refreshes = static_cast<int>(damaged.size());
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        result.refresh_seconds = elapsed.count();
+        if (result.full_refreshes > 0) {
+            full_due_ = false;
+            calls_ = 0;
+            baseline_ = 0;
+        }
+
+        net_ = &net;
+        const RelaxResult cg = CgRelax<K>::relax(net, settings);
+        net_ = nullptr;
+        result.iterations = cg.iterations;
+        result.force_evals = cg.force_evals;
+        result.energy = cg.energy;
+        result.fnorm = cg.fnorm;
+        result.wall_force = cg.wall_force;
+        result.stop = cg.stop;
+
+        if (calls_++ < window_) {
+            baseline_ = std::max(baseline_, cg.iterations);
+        } else if (cg.iterations > degrade_ * baseline_) {
+            full_due_ = true;
+        }
+        return result;
+    }
+
+    std::size_t workspace_bytes() const override {
+        return CgRelax<K>::workspace_bytes() + (ichol_ ? ichol_->bytes() : 0);
+    }
+
+protected:
+    bool precondition(const std::vector<double>& f, std::vector<double>& s) override {
+        s.resize(f.size());
+        ichol_->apply(*net_, f.data(), s.data());
+        return true;
+    }
+
+private:
+    double tile_, limit_, degrade_;
+    int window_;
+    std::unique_ptr<IncompleteCholesky> ichol_;
+    const Network* net_ = nullptr;
+    bool full_due_ = false;
+    int calls_ = 0, baseline_ = 0;
+};
+
+}  // namespace spring
@@ -0,0 +1,250 @@
+// kernels.h
+//
+// Kernels críticos da simulação (varredura de quebra, forças harmônicas e
+// preditor de quebra) especializados em tempo de compilação.
+//
+// A política de contorno (periodicidade por eixo), a dimensão e a política
+// de carregamento são fixas durante toda a execução. Em vez de testar essas
+// condições para cada ligação, os kernels são templates sobre essas políticas
+// e o driver faz um único `dispatch_kernels()` na inicialização. Cada
+// combinação gera um laço interno sem desvios e totalmente inlined.
+//
+// Layout de posições: vetor plano com passo 3 (x, y, z), o mesmo usado pelo
+// LAMMPS em atom->x[0].
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace spring {
+
+// --- Caixa de simulação ---
+// Guarda o período e seu inverso para que o wrap não precise de divisão.
+struct Box {
+    double lo[3] = {0.0, 0.0, 0.0};
+    double hi[3] = {0.0, 0.0, 0.0};
+    double period[3] = {0.0, 0.0, 0.0};
+    double inv_period[3] = {0.0, 0.0, 0.0};
+
+    static Box from_bounds(const double* boxlo, const double* boxhi) {
+        Box box;
+        for (int d = 0; d < 3; ++d) {
+            box.lo[d] = boxlo[d];
+            box.hi[d] = boxhi[d];
+            box.period[d] = boxhi[d] - boxlo[d];
+            box.inv_period[d] = (box.period[d] > 0.0) ? 1.0 / box.period[d] : 0.0;
+        }
+        return box;
+    }
+};
+
+// --- Política de contorno ---
+// Periodicidade por eixo. `boundary p s p` do in.config corresponde a
+// Boundary<true, false, true>.
+template <bool PX, bool PY, bool PZ>
+struct Boundary {
+    static constexpr bool periodic[3] = {PX, PY, PZ};
+
+    template <int Axis>
+    static inline double wrap(double d, const Box& box) {
+        if constexpr (periodic[Axis]) {
+            return d - box.period[Axis] * std::nearbyint(d * box.inv_period[Axis]);
+        } else {
+            return d;
+        }
+    }
+};
+
+// --- Políticas de carregamento ---
+// Cada política define o deslocamento imposto aos átomos do topo e o campo
+// afim correspondente, G·d, usado pelo preditor: d' = d + deps * G·d.
+struct Tensile {
+    static constexpr const char* name = "tensile";
+    static inline void displacement(double inc, double* u) { u[0] = 0.0; u[1] = inc; u[2] = 0.0; }
+    static inline void affine(const double* d, double* gd) { gd[0] = 0.0; gd[1] = d[1]; gd[2] = 0.0; }
+};
+
+struct Shear {
+    static constexpr const char* name = "shear";
+    static inline void displacement(double inc, double* u) { u[0] = inc; u[1] = 0.0; u[2] = 0.0; }
+    static inline void affine(const double* d, double* gd) { gd[0] = d[1]; gd[1] = 0.0; gd[2] = 0.0; }
+};
+
+enum class Loading { tensile, shear };
+
+inline Loading parse_loading(const std::string& name) {
+    if (name == Tensile::name) return Loading::tensile;
+    if (name == Shear::name) return Loading::shear;
+    throw std::runtime_error("Erro: modo de carregamento desconhecido: " + name);
+}
+
+// --- Visões das ligações consumidas pelos kernels ---
+// Os índices são locais (posição no vetor de átomos), não tags do LAMMPS.
+// Os tipos de índice e de limiar são parâmetros para que o mesmo kernel sirva
+// ao driver LAMMPS (int/double) e ao layout compacto do motor nativo
+// (uint32_t/float). Um limiar infinito desativa a ligação na varredura.
+template <class Index, class Real>
+struct BasicScanBonds {
+    int n = 0;
+    const Index* atom1 = nullptr;
+    const Index* atom2 = nullptr;
+    const Real* break_len_sq = nullptr;  // limiar de quebra ao quadrado
+};
+using ScanBonds = BasicScanBonds<int, double>;
+
+template <class Index>
+struct BasicForceBonds {
+    int n = 0;
+    const Index* atom1 = nullptr;
+    const Index* atom2 = nullptr;
+    const std::uint64_t* alive = nullptr;  // bitset, 1 = ligação ativa
+    double k = 1.0;                        // E = k (r - r0)^2, como bond_style harmonic
+    double r0 = 1.0;
+
+    double rest(int) const { return r0; }
+};
+using ForceBonds = BasicForceBonds<int>;
+
+// Comprimento de repouso por ligação (redes fora da rede triangular)
+template <class Index>
+struct VariableForceBonds : BasicForceBonds<Index> {
+    const float* rest_len = nullptr;
+
+    double rest(int i) const { return rest_len[i]; }
+};
+
+struct Prediction {
+    double strain = std::numeric_limits<double>::infinity();
+    int bond = -1;
+};
+
+template <class B, int D, class L>
+struct Kernels {
+    static_assert(D == 2 || D == 3, "dimension must be 2 or 3");
+    using boundary = B;
+    using loading = L;
+    static constexpr int dimension = D;
+
+    static inline void bond_vector(const double* x, int a, int b, const Box& box, double* d) {
+        d[0] = B::template wrap<0>(x[3 * a] - x[3 * b], box);
+        d[1] = B::template wrap<1>(x[3 * a + 1] - x[3 * b + 1], box);
+        d[2] = (D == 3) ? B::template wrap<2>(x[3 * a + 2] - x[3 * b + 2], box) : 0.0;
+    }
+
+    // Varredura de quebra: escreve em `out` os índices (em `bonds`) das
+    // ligações cujo comprimento excede o limiar. `out` deve comportar
+    // bonds.n entradas; a compactação é feita sem desvio.
+    template <class Bonds>
+    static int scan(const double* x, const Bonds& bonds, const Box& box, int* out) {
+        int count = 0;
+        for (int i = 0; i < bonds.n; ++i) {
+            double d[3];
+            bond_vector(x, bonds.atom1[i], bonds.atom2[i], box, d);
+            double dist_sq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            out[count] = i;
+            count += (dist_sq > bonds.break_len_sq[i]);
+        }
+        return count;
+    }
+
+    // Forças harmônicas acumuladas em `f` (passo 3). Retorna a energia.
+    template <class Bonds>
+    static double forces(const double* x, const Bonds& bonds, const Box& box, double* f) {
+        double energy = 0.0;
+        for (int i = 0; i < bonds.n; ++i) {
+            const int a = bonds.atom1[i];
+            const int b = bonds.atom2[i];
+            double d[3];
+            bond_vector(x, a, b, box, d);
+            const double r = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            const double dr = r - bonds.rest(i);
+            const double w = static_cast<double>((bonds.alive[i >> 6] >> (i & 63)) & 1u);
+            const double fbond = (r > 0.0) ? -2.0 * bonds.k * dr * w / r : 0.0;
+            energy += w * bonds.k * dr * dr;
+            for (int c = 0; c < D; ++c) {
+                f[3 * a + c] += fbond * d[c];
+                f[3 * b + c] -= fbond * d[c];
+            }
+        }
+        return energy;
+    }
+
+    // Preditor: menor incremento de deformação afim (na política L) para o
+    // qual alguma ligação atinge seu limiar, resolvendo
+    // |d + deps G·d|^2 = break_len^2 para cada ligação.
+    template <class Bonds>
+    static Prediction predict(const double* x, const Bonds& bonds, const Box& box) {
+        Prediction best;
+        for (int i = 0; i < bonds.n; ++i) {
+            double d[3], gd[3];
+            bond_vector(x, bonds.atom1[i], bonds.atom2[i], box, d);
+            L::affine(d, gd);
+            const double a = gd[0] * gd[0] + gd[1] * gd[1] + gd[2] * gd[2];
+            const double b = 2.0 * (d[0] * gd[0] + d[1] * gd[1] + d[2] * gd[2]);
+            const double c = d[0] * d[0] + d[1] * d[1] + d[2] * d[2] - bonds.break_len_sq[i];
+            double eps = std::numeric_limits<double>::infinity();
+            if (c >= 0.0) {
+                eps = 0.0;
+            } else if (a > 0.0) {
+                // c < 0 garante uma única raiz positiva
+                eps = (-b + std::sqrt(b * b - 4.0 * a * c)) / (2.0 * a);
+            }
+            if (eps < best.strain) {
+                best.strain = eps;
+                best.bond = i;
+            }
+        }
+        return best;
+    }
+};
+
+// --- Configuração e dispatch ---
+struct KernelConfig {
+    bool periodic[3] = {true, false, true};
+    int dimension = 2;
+    Loading loading = Loading::tensile;
+};
+
+namespace detail {
+
+template <bool PX, bool PY, bool PZ, class Fn>
+decltype(auto) dispatch_dim_loading(const KernelConfig& cfg, Fn&& fn) {
+    using B = Boundary<PX, PY, PZ>;
+    if (cfg.dimension == 3) {
+        if (cfg.loading == Loading::shear) return fn(Kernels<B, 3, Shear>{});
+        return fn(Kernels<B, 3, Tensile>{});
+    }
+    if (cfg.loading == Loading::shear) return fn(Kernels<B, 2, Shear>{});
+    return fn(Kernels<B, 2, Tensile>{});
+}
+
+}  // namespace detail
+
+// Seleciona a especialização uma única vez. `fn` recebe uma instância vazia
+// de Kernels<...> e deve ser genérica (ex.: lambda com parâmetro auto).
+template <class Fn>
+decltype(auto) dispatch_kernels(const KernelConfig& cfg, Fn&& fn) {
+    if (cfg.dimension != 2 && cfg.dimension != 3) {
+        throw std::runtime_error("Erro: dimensão não suportada: " + std::to_string(cfg.dimension));
+    }
+    // In 2D the z flag is irrelevant; folding it avoids duplicate instances.
+    const bool pz = (cfg.dimension == 3) && cfg.periodic[2];
+    const int key = (cfg.periodic[0] ? 4 : 0) | (cfg.periodic[1] ? 2 : 0) | (pz ? 1 : 0);
+    switch (key) {
+        case 0: return detail::dispatch_dim_loading<false, false, false>(cfg, std::forward<Fn>(fn));
+        case 1: return detail::dispatch_dim_loading<false, false, true>(cfg, std::forward<Fn>(fn));
+        case 2: return detail::dispatch_dim_loading<false, true, false>(cfg, std::forward<Fn>(fn));
+        case 3: return detail::dispatch_dim_loading<false, true, true>(cfg, std::forward<Fn>(fn));
+        case 4: return detail::dispatch_dim_loading<true, false, false>(cfg, std::forward<Fn>(fn));
+        case 5: return detail::dispatch_dim_loading<true, false, true>(cfg, std::forward<Fn>(fn));
+        case 6: return detail::dispatch_dim_loading<true, true, false>(cfg, std::forward<Fn>(fn));
+        default: return detail::dispatch_dim_loading<true, true, true>(cfg, std::forward<Fn>(fn));
+    }
+}
+
+}  // namespace spring
@@ -0,0 +1,126 @@
+// lattice.h
+//
+// Geometria da rede triangular de create_network.py e kernels da rede
+// implícita.
+//
+// O nó (j, i) tem id j*N + i. Cada nó possui até três ligações "para frente",
+// seguindo get_neighbors():
+//   direção 0 (leste):    (j, i+1), com wrap periódico em i;
+//   direção 1 (norte):    (j+1, i);
+//   direção 2 (diagonal): (j+1, i-1) se j é par, (j+1, i+1) se j é ímpar.
+// Na rede implícita a ligação é identificada por slot = dir*N*N + nó, e os
+// vizinhos são calculados, não lidos. Para uma linha j e uma direção, os
+// vizinhos formam uma sequência com deslocamento constante (exceto a coluna
+// que dá a volta), então os kernels percorrem a linha com passo unitário.
+
+#pragma once
+
+#include <cstdint>
+
+#include "kernels.h"
+
+namespace spring {
+
+struct TriangularLattice {
+    std::uint32_t N = 0;
+
+    static constexpr int num_directions = 3;
+
+    std::uint32_t num_nodes() const { return N * N; }
+    std::uint32_t num_slots() const { return num_directions * N * N; }
+    std::uint32_t slot(std::uint32_t node, int dir) const { return dir * N * N + node; }
+
+    // Retorna false para as direções inexistentes na última linha.
+    bool neighbor(std::uint32_t node, int dir, std::uint32_t& other) const {
+        const std::uint32_t j = node / N, i = node % N;
+        if (dir == 0) {
+            other = j * N + (i + 1 == N ? 0 : i + 1);
+            return true;
+        }
+        if (j + 1 >= N) return false;
+        if (dir == 1) {
+            other = (j + 1) * N + i;
+        } else if (j % 2 == 0) {
+            other = (j + 1) * N + (i == 0 ? N - 1 : i - 1);
+        } else {
+            other = (j + 1) * N + (i + 1 == N ? 0 : i + 1);
+        }
+        return true;
+    }
+
+    bool endpoints(std::uint32_t slot_id, std::uint32_t& a, std::uint32_t& b) const {
+        a = slot_id % (N * N);
+        return neighbor(a, static_cast<int>(slot_id / (N * N)), b);
+    }
+
+    // Enumera os trechos contíguos: fn(a0, len, offset, s0) cobre os nós
+    // a0..a0+len-1, com vizinho a+offset e slot s0 + (a - a0).
+    template <class Fn>
+    void for_each_run(Fn&& fn) const {
+        const std::int64_t n = N;
+        const std::uint32_t nn = N * N;
+        for (std::uint32_t j = 0; j < N; ++j) {
+            const std::uint32_t row = j * N;
+            fn(row, N - 1, std::int64_t(1), row);
+            fn(row + N - 1, 1u, -(n - 1), row + N - 1);
+            if (j + 1 >= N) continue;
+            fn(row, N, n, nn + row);
+            if (j % 2 == 0) {
+                fn(row + 1, N - 1, n - 1, 2 * nn + row + 1);
+                fn(row, 1u, 2 * n - 1, 2 * nn + row);
+            } else {
+                fn(row, N - 1, n + 1, 2 * nn + row);
+                fn(row + N - 1, 1u, std::int64_t(1), 2 * nn + row + N - 1);
+            }
+        }
+    }
+};
+
+// --- Kernels da rede implícita ---
+// Mesma física de Kernels<B, D, L>::scan/forces, percorrendo os trechos da
+// rede em vez de listas de índices.
+template <class K>
+struct LatticeKernels {
+    static int scan(const TriangularLattice& lat, const double* x, const float* break_len_sq,
+                    const Box& box, int* out) {
+        int count = 0;
+        lat.for_each_run([&](std::uint32_t a0, std::uint32_t len, std::int64_t offset, std::uint32_t s0) {
+            const float* thr = break_len_sq + s0;
+            for (std::uint32_t k = 0; k < len; ++k) {
+                const std::uint32_t a = a0 + k;
+                double d[3];
+                K::bond_vector(x, static_cast<int>(a + offset), static_cast<int>(a), box, d);
+                const double dist_sq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+                out[count] = static_cast<int>(s0 + k);
+                count += (dist_sq > thr[k]);
+            }
+        });
+        return count;
+    }
+
+    static double forces(const TriangularLattice& lat, const double* x, const std::uint64_t* alive,
+                         double k_spring, double r0, const Box& box, double* f) {
+        double energy = 0.0;
+        lat.for_each_run([&](std::uint32_t a0, std::uint32_t len, std::int64_t offset, std::uint32_t s0) {
+            for (std::uint32_t k = 0; k < len; ++k) {
+                const int a = static_cast<int>(a0 + k);
+                const int b = static_cast<int>(a + offset);
+                const std::uint32_t s = s0 + k;
+                double d[3];
+                K::bond_vector(x, a, b, box, d);
+                const double r = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                const double dr = r - r0;
+                const double w = static_cast<double>((alive[s >> 6] >> (s & 63)) & 1u);
+                const double fbond = (r > 0.0) ? -2.0 * k_spring * dr * w / r : 0.0;
+                energy += w * k_spring * dr * dr;
+                for (int c = 0; c < K::dimension; ++c) {
+                    f[3 * a + c] += fbond * d[c];
+                    f[3 * b + c] -= fbond * d[c];
+                }
+            }
+        });
+        return energy;
+    }
+};
+
+}  // namespace spring
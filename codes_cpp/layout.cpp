@@ -0,0 +1,410 @@
+// layout.cpp
+
+#include "layout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "graph.h"
+#include "parallel.h"
+
+namespace spring {
+
+namespace {
+
+std::vector<std::string> split(const std::string& text, char sep) {
+    std::vector<std::string> parts;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, sep)) parts.push_back(item);
+    return parts;
+}
+
+double wrap_x(const Network& net, double dx) {
+    if (!net.periodic[0]) return dx;
+    return dx - net.box.period[0] * std::nearbyint(dx * net.box.inv_period[0]);
+}
+
+void bond_midpoint(const Network& net, std::uint32_t a1, std::uint32_t a2, double& mx, double& my) {
+    mx = net.x[3 * a1] + 0.5 * wrap_x(net, net.x[3 * a2] - net.x[3 * a1]);
+    my = 0.5 * (net.x[3 * a1 + 1] + net.x[3 * a2 + 1]);
+    if (net.periodic[0]) mx = net.box.lo[0] + std::fmod(std::fmod(mx - net.box.lo[0], net.box.period[0]) + net.box.period[0], net.box.period[0]);
+}
+
+// --- Índices (j, i) da rede triangular a partir das posições ---
+struct LatticeIndex {
+    std::uint32_t N = 0;
+    std::vector<std::uint32_t> row, col;
+};
+
+LatticeIndex lattice_index(const Network& net) {
+    LatticeIndex idx;
+    idx.N = static_cast<std::uint32_t>(std::lround(std::sqrt(double(net.num_atoms))));
+    if (idx.N < 3 || idx.N * idx.N != net.num_atoms) {
+        throw std::runtime_error("Erro: layouts grid/gradient exigem a rede triangular N x N");
+    }
+    const double h = net.r0 * std::sqrt(3.0) / 2.0;
+    double oy = std::numeric_limits<double>::infinity();
+    for (std::uint32_t a = 0; a < net.num_atoms; ++a) oy = std::min(oy, net.x[3 * a + 1]);
+    double ox = std::numeric_limits<double>::infinity();
+    for (std::uint32_t a = 0; a < net.num_atoms; ++a) {
+        if (net.x[3 * a + 1] < oy + 0.25 * h) ox = std::min(ox, net.x[3 * a]);
+    }
+    idx.row.resize(net.num_atoms);
+    idx.col.resize(net.num_atoms);
+    const long long N = idx.N;
+    for (std::uint32_t a = 0; a < net.num_atoms; ++a) {
+        long long j = std::llround((net.x[3 * a + 1] - oy) / h);
+        long long i = std::llround((net.x[3 * a] - ox) / net.r0 - 0.5 * double(j % 2));
+        idx.row[a] = static_cast<std::uint32_t>(j);
+        idx.col[a] = static_cast<std::uint32_t>(((i % N) + N) % N);
+    }
+    return idx;
+}
+
+// Mesma regra de is_unbreakable(), com tamanho de célula por linha.
+template <class CellSize, class IsMatrixRow>
+bool lattice_rule(const LatticeIndex& idx, std::uint32_t a1, std::uint32_t a2, CellSize cell, IsMatrixRow matrix_row) {
+    std::uint32_t j1 = idx.row[a1], j2 = idx.row[a2], i1 = idx.col[a1], i2 = idx.col[a2];
+    if (j1 > j2) {
+        std::swap(j1, j2);
+        std::swap(i1, i2);
+    }
+    if (j1 == j2 && matrix_row(j1)) {
+        const std::uint32_t di = (i1 > i2) ? i1 - i2 : i2 - i1;
+        if (di == 1 || di == idx.N - 1) return true;
+    }
+    const std::uint32_t L = cell(j1);
+    return L > 0 && j1 != j2 && i1 == i2 && i1 % L == 0;
+}
+
+// --- Localizador do nó mais próximo (grade de baldes) ---
+class NodeLocator {
+public:
+    explicit NodeLocator(const Network& net) : net_(net) {
+        cell_ = std::max(net.r0, 1.0e-6);
+        nx_ = std::max(1, static_cast<int>(std::ceil(net.box.period[0] / cell_)));
+        ny_ = std::max(1, static_cast<int>(std::ceil(net.box.period[1] / cell_)));
+        buckets_.assign(static_cast<std::size_t>(nx_) * ny_, {});
+        for (std::uint32_t a = 0; a < net.num_atoms; ++a) {
+            buckets_[bucket(cx(net.x[3 * a]), cy(net.x[3 * a + 1]))].push_back(a);
+        }
+    }
+
+    std::uint32_t nearest(double x, double y) const {
+        const int bx = cx(x), by = cy(y);
+        std::uint32_t best = 0;
+        double best_d2 = std::numeric_limits<double>::infinity();
+        for (int ring = 0; ring <= std::max(nx_, ny_); ++ring) {
+            for (int dy = -ring; dy <= ring; ++dy) {
+                for (int dx = -ring; dx <= ring; ++dx) {
+                    if (std::max(std::abs(dx), std::abs(dy)) != ring) continue;
+                    int qx = bx + dx, qy = by + dy;
+                    if (qy < 0 || qy >= ny_) continue;
+                    if (qx < 0 || qx >= nx_) {
+                        if (!net_.periodic[0]) continue;
+                        qx = ((qx % nx_) + nx_) % nx_;
+                    }
+                    for (std::uint32_t a : buckets_[bucket(qx, qy)]) {
+                        const double ddx = wrap_x(net_, net_.x[3 * a] - x);
+                        const double ddy = net_.x[3 * a + 1] - y;
+                        const double d2 = ddx * ddx + ddy * ddy;
+                        if (d2 < best_d2) {
+                            best_d2 = d2;
+                            best = a;
+                        }
+                    }
+                }
+            }
+            // Todo nó fora do anel atual está a mais de ring * cell
+            if (best_d2 < (ring * cell_) * (ring * cell_)) break;
+        }
+        return best;
+    }
+
+private:
+    int cx(double x) const {
+        int c = static_cast<int>(std::floor((x - net_.box.lo[0]) / cell_));
+        if (net_.periodic[0]) return ((c % nx_) + nx_) % nx_;
+        return std::min(std::max(c, 0), nx_ - 1);
+    }
+    int cy(double y) const {
+        return std::min(std::max(static_cast<int>(std::floor((y - net_.box.lo[1]) / cell_)), 0), ny_ - 1);
+    }
+    std::size_t bucket(int x, int y) const { return static_cast<std::size_t>(y) * nx_ + x; }
+
+    const Network& net_;
+    double cell_ = 1.0;
+    int nx_ = 1, ny_ = 1;
+    std::vector<std::vector<std::uint32_t>> buckets_;
+};
+
+// Caminho guloso de ligações de `from` até `to`: a cada passo vai ao vizinho
+// mais próximo do alvo. Na rede triangular sempre há um vizinho mais próximo.
+void walk_path(const Network& net, const Adjacency& adj, std::uint32_t from, std::uint32_t to,
+               std::vector<std::uint32_t>& bonds_out) {
+    auto dist2 = [&](std::uint32_t a) {
+        const double dx = wrap_x(net, net.x[3 * a] - net.x[3 * to]);
+        const double dy = net.x[3 * a + 1] - net.x[3 * to + 1];
+        return dx * dx + dy * dy;
+    };
+    std::uint32_t cur = from;
+    double cur_d2 = dist2(cur);
+    for (std::uint32_t steps = 0; cur != to && steps < net.num_atoms; ++steps) {
+        std::uint32_t next = cur, bond = 0;
+        double next_d2 = cur_d2;
+        for (std::uint32_t k = adj.offsets[cur]; k < adj.offsets[cur + 1]; ++k) {
+            const double d2 = dist2(adj.neighbors[k]);
+            if (d2 < next_d2) {
+                next_d2 = d2;
+                next = adj.neighbors[k];
+                bond = adj.bonds[k];
+            }
+        }
+        if (next == cur) break;  // mínimo local (rede diluída)
+        bonds_out.push_back(bond);
+        cur = next;
+        cur_d2 = next_d2;
+    }
+}
+
+std::vector<Polyline> honeycomb_polylines(const Network& net, int L) {
+    // Hexágonos com vértice para cima; centros numa rede triangular de passo L.
+    // Cada centro gera as três arestas compartilhadas com os vizinhos a 0°, 60°
+    // e 120°, de modo que cada aresta aparece uma única vez.
+    std::vector<Polyline> lines;
+    const double a = L / std::sqrt(3.0);  // raio circunscrito
+    const double hy = L * std::sqrt(3.0) / 2.0;
+    const double x0 = net.box.lo[0], y0 = net.box.lo[1];
+    const int ncols = static_cast<int>(std::ceil(net.box.period[0] / L)) + 1;
+    const int nrows = static_cast<int>(std::ceil(net.box.period[1] / hy)) + 1;
+    for (int r = -1; r <= nrows; ++r) {
+        for (int c = -1; c <= ncols; ++c) {
+            const double cx = x0 + (c + 0.5 * (r & 1)) * L;
+            const double cy = y0 + r * hy;
+            for (int k = 0; k < 3; ++k) {
+                const double th = k * M_PI / 3.0;
+                const double ux = std::cos(th), uy = std::sin(th);
+                const double mx = cx + 0.5 * L * ux, my = cy + 0.5 * L * uy;
+                Polyline p;
+                p.x = {mx - 0.5 * a * uy, mx + 0.5 * a * uy};
+                p.y = {my + 0.5 * a * ux, my - 0.5 * a * ux};
+                lines.push_back(std::move(p));
+            }
+        }
+    }
+    return lines;
+}
+
+std::vector<Polyline> fibre_polylines(const Network& net, int count, double length, std::uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> ux(net.box.lo[0], net.box.hi[0]);
+    std::uniform_real_distribution<double> uy(net.box.lo[1] + 1.0, net.box.hi[1] - 1.0);
+    std::uniform_real_distribution<double> angle(0.0, M_PI);
+    std::vector<Polyline> lines;
+    for (int f = 0; f < count; ++f) {
+        const double cx = ux(rng), cy = uy(rng), th = angle(rng);
+        Polyline p;
+        p.x = {cx - 0.5 * length * std::cos(th), cx + 0.5 * length * std::cos(th)};
+        p.y = {cy - 0.5 * length * std::sin(th), cy + 0.5 * length * std::sin(th)};
+        lines.push_back(std::move(p));
+    }
+    return lines;
+}
+
+void rasterize_polylines(const Network& net, const std::vector<Polyline>& lines, int threads,
+                         std::vector<std::uint8_t>& classes) {
+    const Adjacency adj = build_adjacency(net);
+    const NodeLocator locator(net);
+    const double ylo = net.box.lo[1], yhi = net.box.hi[1];
+    std::vector<std::vector<std::uint32_t>> found(std::max(1, threads));
+    parallel_for(lines.size(), threads, [&](std::size_t begin, std::size_t end, int tid) {
+        for (std::size_t l = begin; l < end; ++l) {
+            const Polyline& p = lines[l];
+            // Trechos fora da rede em y são descartados
+            for (std::size_t v = 0; v + 1 < p.x.size(); ++v) {
+                double y1 = p.y[v], y2 = p.y[v + 1], x1 = p.x[v], x2 = p.x[v + 1];
+                if ((y1 < ylo && y2 < ylo) || (y1 > yhi && y2 > yhi)) continue;
+                if (y1 != y2) {
+                    auto clip = [&](double& xa, double& ya, double xb, double yb) {
+                        const double yc = std::min(std::max(ya, ylo), yhi);
+                        xa += (xb - xa) * (yc - ya) / (yb - ya);
+                        ya = yc;
+                    };
+                    clip(x1, y1, x2, y2);
+                    clip(x2, y2, x1, y1);
+                }
+                walk_path(net, adj, locator.nearest(x1, y1), locator.nearest(x2, y2), found[tid]);
+            }
+        }
+    });
+    for (const auto& list : found) {
+        for (std::uint32_t b : list) classes[b] = bond_unbreakable;
+    }
+}
+
+std::vector<std::string> read_mask(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Erro: Não foi possível abrir a máscara: " + filename);
+    }
+    std::vector<std::string> rows;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) rows.push_back(line);
+    }
+    if (rows.empty()) throw std::runtime_error("Erro: máscara vazia: " + filename);
+    return rows;
+}
+
+}  // namespace
+
+LayoutSpec LayoutSpec::parse(const std::string& text) {
+    LayoutSpec spec;
+    std::vector<std::string> p = split(text, ',');
+    if (p.empty()) return spec;
+    auto need = [&](std::size_t n) {
+        if (p.size() < n) throw std::runtime_error("Erro: parâmetros insuficientes no layout: " + text);
+    };
+    if (p[0] == "grid") {
+        need(2);
+        spec.kind = grid;
+        spec.L = std::stoi(p[1]);
+    } else if (p[0] == "gradient") {
+        need(3);
+        spec.kind = gradient;
+        spec.L = std::stoi(p[1]);
+        spec.L_top = std::stoi(p[2]);
+    } else if (p[0] == "honeycomb") {
+        need(2);
+        spec.kind = honeycomb;
+        spec.L = std::stoi(p[1]);
+    } else if (p[0] == "fibres") {
+        need(3);
+        spec.kind = fibres;
+        spec.count = std::stoi(p[1]);
+        spec.length = std::stod(p[2]);
+        if (p.size() > 3) spec.seed = std::stoull(p[3]);
+    } else if (p[0] == "mask" || p[0] == "polylines") {
+        need(2);
+        spec.kind = (p[0] == "mask") ? mask : polylines;
+        spec.file = text.substr(p[0].size() + 1);
+    } else {
+        throw std::runtime_error("Erro: layout desconhecido: " + text);
+    }
+    return spec;
+}
+
+std::vector<Polyline> read_polylines(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Erro: Não foi possível abrir as polilinhas: " + filename);
+    }
+    std::vector<Polyline> lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        Polyline p;
+        double x, y;
+        while (in >> x >> y) {
+            p.x.push_back(x);
+            p.y.push_back(y);
+        }
+        if (p.x.size() >= 2) lines.push_back(std::move(p));
+    }
+    return lines;
+}
+
+std::vector<std::uint8_t> classify_bonds(const Network& net, const LayoutSpec& spec, int threads) {
+    std::vector<std::uint8_t> classes(net.num_bonds, bond_breakable);
+    if (spec.kind == LayoutSpec::none) return classes;
+
+    // Regras por ligação: avaliadas em paralelo por blocos de ligações
+    auto per_bond = [&](auto rule) {
+        parallel_for(net.num_bonds, threads, [&](std::size_t begin, std::size_t end, int) {
+            for (std::size_t b = begin; b < end; ++b) {
+                std::uint32_t a1, a2;
+                if (!net.alive.test(b) || !net.endpoints(static_cast<std::uint32_t>(b), a1, a2)) continue;
+                classes[b] = rule(a1, a2) ? bond_unbreakable : bond_breakable;
+            }
+        });
+    };
+
+    switch (spec.kind) {
+        case LayoutSpec::grid: {
+            if (spec.L <= 0) break;
+            const LatticeIndex idx = lattice_index(net);
+            const std::uint32_t L = static_cast<std::uint32_t>(spec.L);
+            per_bond([&](std::uint32_t a1, std::uint32_t a2) {
+                return lattice_rule(idx, a1, a2, [L](std::uint32_t) { return L; },
+                                    [L](std::uint32_t j) { return j % L == 0; });
+            });
+            break;
+        }
+        case LayoutSpec::gradient: {
+            const LatticeIndex idx = lattice_index(net);
+            std::vector<std::uint32_t> cell(idx.N);
+            std::vector<char> matrix_row(idx.N, 0);
+            for (std::uint32_t j = 0; j < idx.N; ++j) {
+                const double t = (idx.N > 1) ? double(j) / double(idx.N - 1) : 0.0;
+                cell[j] = static_cast<std::uint32_t>(std::max(1L, std::lround(spec.L + (spec.L_top - spec.L) * t)));
+            }
+            for (std::uint32_t j = 0; j < idx.N; j += cell[j]) matrix_row[j] = 1;
+            per_bond([&](std::uint32_t a1, std::uint32_t a2) {
+                return lattice_rule(idx, a1, a2, [&](std::uint32_t j) { return cell[j]; },
+                                    [&](std::uint32_t j) { return matrix_row[j] != 0; });
+            });
+            break;
+        }
+        case LayoutSpec::mask: {
+            const std::vector<std::string> rows = read_mask(spec.file);
+            std::size_t width = 0;
+            for (const auto& r : rows) width = std::max(width, r.size());
+            const double height = double(rows.size());
+            per_bond([&](std::uint32_t a1, std::uint32_t a2) {
+                double mx, my;
+                bond_midpoint(net, a1, a2, mx, my);
+                const long px = static_cast<long>((mx - net.box.lo[0]) * net.box.inv_period[0] * double(width));
+                const long py = static_cast<long>((net.box.hi[1] - my) * net.box.inv_period[1] * height);
+                if (px < 0 || py < 0 || px >= static_cast<long>(width) || py >= static_cast<long>(rows.size())) return false;
+                const std::string& row = rows[py];
+                return px < static_cast<long>(row.size()) && (row[px] == '1' || row[px] == '#');
+            });
+            break;
+        }
+        case LayoutSpec::honeycomb:
+            if (spec.L > 0) rasterize_polylines(net, honeycomb_polylines(net, spec.L), threads, classes);
+            break;
+        case LayoutSpec::fibres:
+            rasterize_polylines(net, fibre_polylines(net, spec.count, spec.length, spec.seed), threads, classes);
+            break;
+        case LayoutSpec::polylines:
+            rasterize_polylines(net, read_polylines(spec.file), threads, classes);
+            break;
+        case LayoutSpec::none:
+            break;
+    }
+    return classes;
+}
+
+std::size_t apply_bond_classes(Network& net, const std::vector<std::uint8_t>& classes) {
+    std::size_t count = 0;
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        if (classes[b] == bond_unbreakable && net.alive.test(b)) {
+            net.break_len_sq[b] = std::numeric_limits<float>::infinity();
+            ++count;
+        }
+    }
+    std::cout << "Info: layout com " << count << " ligações inquebráveis." << std::endl;
+    return count;
+}
+
+}  // namespace spring
@@ -0,0 +1,62 @@
+// layout.h
+//
+// Layouts de reforço (ligações inquebráveis) além da grade de L_matrix.
+//
+// O layout é descrito por um texto `tipo,parâmetros`:
+//   grid,L                 grade de is_unbreakable() (linhas j % L == 0 e
+//                          zigue-zagues nas colunas i % L == 0)
+//   gradient,L0,L1         grade com tamanho de célula variando de L0 (fundo)
+//                          a L1 (topo)
+//   honeycomb,L            células hexagonais com centros espaçados de L
+//   fibres,n,comprimento,seed
+//                          n fibras retas de orientação e posição aleatórias
+//   mask,arquivo           bitmap ASCII ('1' ou '#' = reforço; primeira linha
+//                          é o topo) esticado sobre a caixa; vale o pixel do
+//                          ponto médio da ligação
+//   polylines,arquivo      uma polilinha por linha: x1 y1 x2 y2 ...
+// grid e gradient usam os índices (j, i) da rede triangular; os demais valem
+// para qualquer rede. Polilinhas são rasterizadas como caminhos conexos de
+// ligações (passo guloso em direção a cada vértice), de modo que uma fibra
+// nunca fica interrompida.
+//
+// O resultado é uma tabela de classes por ligação, calculada uma vez (em
+// paralelo) e aplicada diretamente aos limiares do motor.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "network.h"
+
+namespace spring {
+
+enum BondClass : std::uint8_t { bond_breakable = 0, bond_unbreakable = 1 };
+
+struct Polyline {
+    std::vector<double> x, y;
+};
+
+struct LayoutSpec {
+    enum Kind { none, grid, gradient, honeycomb, fibres, mask, polylines };
+    Kind kind = none;
+    int L = 0;
+    int L_top = 0;
+    int count = 0;
+    double length = 0.0;
+    std::uint64_t seed = 1;
+    std::string file;
+
+    static LayoutSpec parse(const std::string& text);
+};
+
+std::vector<Polyline> read_polylines(const std::string& filename);
+
+// Tabela de classes (uma entrada por ligação/slot da rede).
+std::vector<std::uint8_t> classify_bonds(const Network& net, const LayoutSpec& spec, int threads);
+
+// Torna inquebráveis as ligações da classe bond_unbreakable. Retorna quantas.
+std::size_t apply_bond_classes(Network& net, const std::vector<std::uint8_t>& classes);
+
+}  // namespace spring
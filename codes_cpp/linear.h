@@ -0,0 +1,695 @@
+// linear.h
+//
+// Resposta linear da rede: operador de rigidez e solvers de Krylov.
+//
+// `StiffnessOperator` é a Hessiana exata da energia E = k (r - r0)^2 no
+// estado atual, sem montagem de matriz global: por ligação ativa guarda-se
+// o bloco 3x3 simétrico
+//   K_b = 2k [ (1 - r0/r) I + (r0/r) n n^T ],   n = d / r,
+// e y = H v é acumulado ligação a ligação. Os graus de liberdade dos átomos
+// fixos (fundo e topo) são condições de Dirichlet: `apply` ignora v neles e
+// zera y neles. Para s vetores de uma vez, cada ligação é lida uma só vez e
+// aplicada aos s vetores (matriz n3 x s, coluna a coluna).
+//
+// `BlockCgSolver` é o CG em bloco (O'Leary): as s colunas compartilham o
+// espaço de Krylov e cada iteração faz uma única passada pelas ligações.
+// Colunas convergidas saem do bloco, que recomeça (P = R) com as restantes;
+// se o sistema s x s ficar singular (colunas dependentes), as colunas
+// restantes seguem com CG de uma coluna.
+//
+// `PipelinedCgSolver` é o CG pipelined de Ghysels e Vanroose (2014): com as
+// recorrências extras w = A r, z = A s e q = A w, os dois produtos internos
+// de cada iteração saem de uma única redução, feita na mesma passada que
+// atualiza os vetores, e o produto q = A w não depende dela (num backend
+// distribuído, o allreduce fica em voo durante a passada pelas ligações).
+// As recorrências acumulam desvio em relação ao resíduo verdadeiro b - A x;
+// a cada `check` iterações e na convergência aparente o resíduo verdadeiro
+// é recalculado e, se o desvio passar de 10% dele (ou se a curvatura
+// p^T A p da recorrência deixar de ser positiva, comum com os modos quase
+// nulos após dano), o solve termina no CG em bloco a partir do melhor x
+// verificado.
+//
+// A Hessiana é simétrica positiva semidefinida no equilíbrio estável
+// (modos soltos após dano dão núcleo; o CG converge em RHS consistentes).
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "kernels.h"
+#include "network.h"
+
+namespace spring {
+
+struct LinearSettings {
+    double tol = 1.0e-8;  // |r_j| <= tol |b_j|
+    int maxiter = 5000;
+    bool pipelined = false;  // PipelinedCgSolver em vez do CG em bloco
+};
+
+struct LinearResult {
+    int iterations = 0;
+    int matvecs = 0;  // passadas pelas ligações (cada uma sobre o bloco ativo)
+    int nrhs = 0;
+    double max_residual = 0.0;  // relativo
+    int fallbacks = 0;          // CG pipelined que terminou no CG em bloco
+};
+
+template <class K>
+class StiffnessOperator {
+public:
+    explicit StiffnessOperator(const Network& net) { update(net); }
+
+    // Recalcula os blocos na geometria atual, só com as ligações vivas (as
+    // quebradas desde a última chamada saem), reaproveitando a memória: um
+    // operador mantido entre passos não aloca.
+    void update(const Network& net) {
+        n3_ = 3 * static_cast<std::size_t>(net.num_atoms);
+        free_.resize(net.num_atoms);
+        for (std::uint32_t i = 0; i < net.num_atoms; ++i) free_[i] = (net.atom_type[i] == atom_mobile);
+        blocks_.clear();
+        for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+            std::uint32_t a1, a2;
+            if (!net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+            double d[3];
+            K::bond_vector(net.x.data(), a1, a2, net.box, d);
+            const double r = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            if (r == 0.0) continue;
+            const double rest = net.rest_len.empty() ? net.r0 : double(net.rest_len[b]);
+            const double c_iso = 2.0 * net.k * (1.0 - rest / r), c_nn = 2.0 * net.k * rest / r;
+            Block blk;
+            blk.a = a1;
+            blk.b = a2;
+            int m = 0;
+            for (int p = 0; p < 3; ++p) {
+                for (int q = p; q < 3; ++q) {
+                    blk.k[m++] = c_nn * d[p] * d[q] / (r * r) + (p == q ? c_iso : 0.0);
+                }
+            }
+            blocks_.push_back(blk);
+        }
+    }
+
+    std::size_t size() const { return n3_; }
+    bool is_free(std::uint32_t atom) const { return free_[atom] != 0; }
+
+    // Y = H V para s colunas (passo n3). Com mask_input = false, V também é
+    // lido nos átomos fixos (para montar -H_mf u_f).
+    void apply(const double* V, double* Y, int s, bool mask_input = true) const {
+        std::fill(Y, Y + n3_ * s, 0.0);
+        static const int idx[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+        for (const Block& blk : blocks_) {
+            const bool fa = free_[blk.a] != 0, fb = free_[blk.b] != 0;
+            const double wa = (fa || !mask_input) ? 1.0 : 0.0, wb = (fb || !mask_input) ? 1.0 : 0.0;
+            for (int j = 0; j < s; ++j) {
+                const double* v = V + n3_ * j;
+                double* y = Y + n3_ * j;
+                double u[3];
+                for (int c = 0; c < 3; ++c) u[c] = wa * v[3 * blk.a + c] - wb * v[3 * blk.b + c];
+                for (int p = 0; p < K::dimension; ++p) {
+                    double ku = 0.0;
+                    for (int q = 0; q < K::dimension; ++q) ku += blk.k[idx[p][q]] * u[q];
+                    if (fa) y[3 * blk.a + p] += ku;
+                    if (fb) y[3 * blk.b + p] -= ku;
+                }
+            }
+        }
+    }
+
+    // Blocos diagonais da Hessiana (6 entradas por átomo: xx xy xz yy yz zz),
+    // só nos átomos livres; base dos precondicionadores de bloco.
+    void diagonal_blocks(std::vector<double>& D) const {
+        D.assign(2 * n3_, 0.0);
+        for (const Block& blk : blocks_) {
+            for (int m = 0; m < 6; ++m) {
+                if (free_[blk.a]) D[6 * std::size_t(blk.a) + m] += blk.k[m];
+                if (free_[blk.b]) D[6 * std::size_t(blk.b) + m] += blk.k[m];
+            }
+        }
+    }
+
+    // Quociente de Rayleigh completo U^T H U (sem Dirichlet): com U a resposta
+    // a um deslocamento imposto unitário, é a rigidez tangente da parede.
+    double quadratic_form(const double* U) const {
+        static const int idx[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+        double sum = 0.0;
+        for (const Block& blk : blocks_) {
+            double u[3];
+            for (int c = 0; c < 3; ++c) u[c] = U[3 * blk.a + c] - U[3 * blk.b + c];
+            for (int p = 0; p < K::dimension; ++p) {
+                for (int q = 0; q < K::dimension; ++q) sum += u[p] * blk.k[idx[p][q]] * u[q];
+            }
+        }
+        return sum;
+    }
+
+    std::size_t bytes() const { return blocks_.capacity() * sizeof(Block) + free_.capacity(); }
+
+private:
+    struct Block {
+        std::uint32_t a, b;
+        double k[6];  // xx xy xz yy yz zz
+    };
+    std::size_t n3_ = 0;
+    std::vector<std::uint8_t> free_;
+    std::vector<Block> blocks_;
+};
+
+// Bloco de rigidez de uma ligação ativa (xx xy xz yy yz zz), base das
+// fatorações (schur.h, ichol.h, schwarz.h)
+struct BondStiffness {
+    std::uint32_t a, b;
+    double k[6];
+};
+
+// K_b da geometria atual com o termo de tensão truncado em zero
+template <class K>
+bool bond_stiffness(const Network& net, std::uint32_t b, BondStiffness& out) {
+    if (!net.alive.test(b) || !net.endpoints(b, out.a, out.b)) return false;
+    double d[3];
+    K::bond_vector(net.x.data(), out.a, out.b, net.box, d);
+    const double r = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    if (r == 0.0) return false;
+    const double rest = net.rest_len.empty() ? net.r0 : double(net.rest_len[b]);
+    const double c_iso = 2.0 * net.k * std::max(0.0, 1.0 - rest / r), c_nn = 2.0 * net.k * rest / r;
+    int m = 0;
+    for (int p = 0; p < 3; ++p) {
+        for (int q = p; q < 3; ++q) out.k[m++] = c_nn * d[p] * d[q] / (r * r) + (p == q ? c_iso : 0.0);
+    }
+    return true;
+}
+
+// Cholesky em perfil (envelope) de uma matriz simétrica local: a linha i
+// guarda as colunas [first[i], i]. Pivôs desprezíveis (modos soltos) são
+// descartados: a linha vira zero e `solve` devolve zero nela.
+struct EnvelopeCholesky {
+    std::vector<std::uint32_t> first;
+    std::vector<std::size_t> row_start;
+    std::vector<double> l;
+
+    std::size_t size() const { return first.size(); }
+    double& at(std::size_t row, std::size_t col) { return l[row_start[row] + col - first[row]]; }
+
+    // Fatora em l a matriz montada em l (triângulo inferior)
+    void factor() {
+        const std::size_t n = size();
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::size_t fi = first[i];
+            double* li = &l[row_start[i]] - fi;
+            for (std::size_t j = fi; j < i; ++j) {
+                const std::size_t fj = first[j];
+                const double* lj = &l[row_start[j]] - fj;
+                double s = li[j];
+                for (std::size_t k = std::max(fi, fj); k < j; ++k) s -= li[k] * lj[k];
+                li[j] = (lj[j] > 0.0) ? s / lj[j] : 0.0;
+            }
+            const double diag = li[i];
+            double d = diag;
+            for (std::size_t k = fi; k < i; ++k) d -= li[k] * li[k];
+            li[i] = (diag > 0.0 && d > 1.0e-10 * diag) ? std::sqrt(d) : 0.0;
+        }
+    }
+
+    // v = K^-1 v
+    void solve(double* v) const {
+        const std::size_t n = size();
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::size_t fi = first[i];
+            const double* li = &l[row_start[i]] - fi;
+            double s = v[i];
+            for (std::size_t k = fi; k < i; ++k) s -= li[k] * v[k];
+            v[i] = (li[i] > 0.0) ? s / li[i] : 0.0;
+        }
+        for (std::size_t i = n; i-- > 0;) {
+            const std::size_t fi = first[i];
+            const double* li = &l[row_start[i]] - fi;
+            v[i] = (li[i] > 0.0) ? v[i] / li[i] : 0.0;
+            for (std::size_t k = fi; k < i; ++k) v[k] -= li[k] * v[i];
+        }
+    }
+
+    std::size_t bytes() const {
+        return first.capacity() * sizeof(std::uint32_t) + row_start.capacity() * sizeof(std::size_t) +
+               l.capacity() * sizeof(double);
+    }
+};
+
+// --- Interface dos solvers lineares ---
+template <class K>
+class LinearSolver {
+public:
+    virtual ~LinearSolver() = default;
+    virtual const char* name() const = 0;
+    // Resolve H X = B (n3 x s, passo n3); X entra como chute inicial.
+    virtual LinearResult solve(const StiffnessOperator<K>& op, const double* B, double* X, int s,
+                               const LinearSettings& settings) = 0;
+};
+
+// Solução de um sistema s x s denso (eliminação com pivoteamento parcial).
+// A é sobrescrita; C (s x m, linha a linha) recebe A^-1 C. Retorna false se
+// algum pivô for desprezível.
+inline bool dense_solve(std::vector<double>& A, std::vector<double>& C, int s, int m) {
+    double scale = 0.0;
+    for (double v : A) scale = std::max(scale, std::fabs(v));
+    for (int col = 0; col < s; ++col) {
+        int piv = col;
+        for (int r = col + 1; r < s; ++r) {
+            if (std::fabs(A[r * s + col]) > std::fabs(A[piv * s + col])) piv = r;
+        }
+        if (std::fabs(A[piv * s + col]) <= 1.0e-13 * scale) return false;
+        if (piv != col) {
+            for (int c = 0; c < s; ++c) std::swap(A[col * s + c], A[piv * s + c]);
+            for (int c = 0; c < m; ++c) std::swap(C[col * m + c], C[piv * m + c]);
+        }
+        for (int r = 0; r < s; ++r) {
+            if (r == col) continue;
+            const double f = A[r * s + col] / A[col * s + col];
+            if (f == 0.0) continue;
+            for (int c = col; c < s; ++c) A[r * s + c] -= f * A[col * s + c];
+            for (int c = 0; c < m; ++c) C[r * m + c] -= f * C[col * m + c];
+        }
+    }
+    for (int r = 0; r < s; ++r) {
+        for (int c = 0; c < m; ++c) C[r * m + c] /= A[r * s + r];
+    }
+    return true;
+}
+
+// Autovalores e autovetores de uma matriz simétrica s x s (Jacobi cíclico).
+// A (linha a linha) é destruída; w recebe os autovalores e V (s x s, linha a
+// linha) os autovetores nas colunas, na mesma ordem.
+inline void symmetric_eigen(std::vector<double>& A, std::vector<double>& w, std::vector<double>& V, int s) {
+    V.assign(std::size_t(s) * s, 0.0);
+    for (int i = 0; i < s; ++i) V[i * s + i] = 1.0;
+    double norm = 0.0;
+    for (double v : A) norm += v * v;
+    for (int sweep = 0; sweep < 50; ++sweep) {
+        double off = 0.0;
+        for (int p = 0; p < s; ++p) {
+            for (int q = p + 1; q < s; ++q) off += A[p * s + q] * A[p * s + q];
+        }
+        if (off <= 1.0e-30 * norm) break;
+        for (int p = 0; p < s; ++p) {
+            for (int q = p + 1; q < s; ++q) {
+                const double apq = A[p * s + q];
+                if (apq == 0.0) continue;
+                // Rotação (p, q) que zera a_pq: t = tan, a menor raiz
+                const double theta = (A[q * s + q] - A[p * s + p]) / (2.0 * apq);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0), sn = t * c;
+                for (int k = 0; k < s; ++k) {
+                    const double akp = A[k * s + p], akq = A[k * s + q];
+                    A[k * s + p] = c * akp - sn * akq;
+                    A[k * s + q] = sn * akp + c * akq;
+                }
+                for (int k = 0; k < s; ++k) {
+                    const double apk = A[p * s + k], aqk = A[q * s + k];
+                    A[p * s + k] = c * apk - sn * aqk;
+                    A[q * s + k] = sn * apk + c * aqk;
+                }
+                for (int k = 0; k < s; ++k) {
+                    const double vkp = V[k * s + p], vkq = V[k * s + q];
+                    V[k * s + p] = c * vkp - sn * vkq;
+                    V[k * s + q] = sn * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    w.resize(s);
+    for (int i = 0; i < s; ++i) w[i] = A[i * s + i];
+}
+
+// --- CG em bloco ---
+template <class K>
+class BlockCgSolver : public LinearSolver<K> {
+public:
+    const char* name() const override { return "block-cg"; }
+
+    LinearResult solve(const StiffnessOperator<K>& op, const double* B, double* X, int s,
+                       const LinearSettings& settings) override {
+        const std::size_t n = op.size();
+        LinearResult result;
+        result.nrhs = s;
+
+        // Resíduos iniciais e normas de referência
+        std::vector<double>& R = residual_;
+        std::vector<double>& bnorm = bnorm_;
+        R.resize(n * s);
+        bnorm.resize(s);
+        op.apply(X, R.data(), s);
+        for (int j = 0; j < s; ++j) {
+            double bb = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                R[n * j + i] = B[n * j + i] - R[n * j + i];
+                bb += B[n * j + i] * B[n * j + i];
+            }
+            bnorm[j] = std::sqrt(bb);
+        }
+        ++result.matvecs;
+
+        std::vector<int>& active = active_;
+        auto refresh_active = [&]() {
+            active.clear();
+            double worst = 0.0;
+            for (int j = 0; j < s; ++j) {
+                const double rel = column_norm(R, n, j) / std::max(bnorm[j], std::numeric_limits<double>::min());
+                worst = std::max(worst, bnorm[j] > 0.0 ? rel : 0.0);
+                if (bnorm[j] > 0.0 && rel > settings.tol) active.push_back(j);
+            }
+            result.max_residual = worst;
+        };
+        refresh_active();
+
+        // Colunas em que o bloco de uma coluna quebrou (curvatura nula)
+        std::vector<char>& stalled = stalled_;
+        stalled.assign(s, 0);
+        bool block_mode = true;
+        while (result.iterations < settings.maxiter) {
+            std::vector<int>& cols = cols_;
+            cols.clear();
+            for (int j : active) {
+                if (!stalled[j]) cols.push_back(j);
+            }
+            if (cols.empty()) break;
+            if (!block_mode) cols.resize(1);
+            std::vector<double>& target = target_;
+            target.resize(cols.size());
+            for (std::size_t c = 0; c < cols.size(); ++c) target[c] = settings.tol * bnorm[cols[c]];
+            if (!iterate(op, R, X, cols, target, settings, result)) {
+                if (cols.size() == 1) stalled[cols[0]] = 1;
+                block_mode = false;  // colunas dependentes: segue coluna a coluna
+            }
+            refresh_active();
+        }
+        return result;
+    }
+
+private:
+    static double column_norm(const std::vector<double>& M, std::size_t n, int j) {
+        double s = 0.0;
+        for (std::size_t i = 0; i < n; ++i) s += M[n * j + i] * M[n * j + i];
+        return std::sqrt(s);
+    }
+
+    // CG em bloco sobre as colunas `cols` até alguma convergir (o bloco
+    // então recomeça com as restantes). Retorna false em quebra do bloco.
+    bool iterate(const StiffnessOperator<K>& op, std::vector<double>& Rall, double* Xall, const std::vector<int>& cols,
+                 const std::vector<double>& target, const LinearSettings& settings, LinearResult& result) {
+        const std::size_t n = op.size();
+        const int m = static_cast<int>(cols.size());
+        R_.assign(n * m, 0.0);
+        for (int c = 0; c < m; ++c) std::copy_n(&Rall[n * cols[c]], n, &R_[n * c]);
+        P_ = R_;
+        Q_.assign(n * m, 0.0);
+        std::vector<double>& RtR = rtr_;
+        std::vector<double>& PtQ = ptq_;
+        std::vector<double>& alpha = alpha_;
+        std::vector<double>& beta = beta_;
+        std::vector<double>& RtR_new = rtr_new_;
+        std::vector<double>& A = a_;
+        for (std::vector<double>* v : {&RtR, &PtQ, &alpha, &beta, &RtR_new, &A}) v->resize(m * m);
+        gram(R_, R_, RtR, n, m);
+
+        bool ok = true;
+        while (result.iterations < settings.maxiter) {
+            ++result.iterations;
+            op.apply(P_.data(), Q_.data(), m);
+            ++result.matvecs;
+
+            // alpha = (P^T Q)^-1 (R^T R)
+            gram(P_, Q_, PtQ, n, m);
+            alpha = RtR;
+            if (!dense_solve(PtQ, alpha, m, m)) {
+                ok = false;
+                break;
+            }
+            for (int c = 0; c < m; ++c) {
+                double* x = Xall + n * cols[c];
+                for (int k = 0; k < m; ++k) {
+                    const double a = alpha[k * m + c];
+                    if (a == 0.0) continue;
+                    const double* p = &P_[n * k];
+                    const double* q = &Q_[n * k];
+                    double* r = &R_[n * c];
+                    for (std::size_t i = 0; i < n; ++i) {
+                        x[i] += a * p[i];
+                        r[i] -= a * q[i];
+                    }
+                }
+            }
+
+            // Convergência de alguma coluna encerra o bloco
+            bool any_converged = false;
+            for (int c = 0; c < m; ++c) any_converged = any_converged || column_norm(R_, n, c) <= target[c];
+            if (any_converged) break;
+
+            // beta = (R^T R)^-1 (R_new^T R_new); P = R + P beta
+            gram(R_, R_, RtR_new, n, m);
+            A = RtR;
+            beta = RtR_new;
+            if (!dense_solve(A, beta, m, m)) {
+                ok = false;
+                break;
+            }
+            Pn_ = R_;
+            for (int c = 0; c < m; ++c) {
+                for (int k = 0; k < m; ++k) {
+                    const double bkc = beta[k * m + c];
+                    if (bkc == 0.0) continue;
+                    for (std::size_t i = 0; i < n; ++i) Pn_[n * c + i] += P_[n * k + i] * bkc;
+                }
+            }
+            std::swap(P_, Pn_);
+            RtR = RtR_new;
+        }
+        for (int c = 0; c < m; ++c) std::copy_n(&R_[n * c], n, &Rall[n * cols[c]]);
+        return ok;
+    }
+
+    // G = A^T B (m x m, linha a linha)
+    static void gram(const std::vector<double>& A, const std::vector<double>& B, std::vector<double>& G,
+                     std::size_t n, int m) {
+        for (int p = 0; p < m; ++p) {
+            for (int q = 0; q < m; ++q) {
+                double s = 0.0;
+                for (std::size_t i = 0; i < n; ++i) s += A[n * p + i] * B[n * q + i];
+                G[p * m + q] = s;
+            }
+        }
+    }
+
+    std::vector<double> R_, P_, Q_, Pn_;
+    // Áreas de trabalho de solve/iterate, reaproveitadas entre chamadas
+    std::vector<double> residual_, bnorm_, target_, rtr_, ptq_, alpha_, beta_, rtr_new_, a_;
+    std::vector<int> active_, cols_;
+    std::vector<char> stalled_;
+};
+
+// --- CG pipelined ---
+template <class K>
+class PipelinedCgSolver : public LinearSolver<K> {
+public:
+    explicit PipelinedCgSolver(int check = 50) : check_(check) {}
+
+    const char* name() const override { return "pipelined-cg"; }
+
+    LinearResult solve(const StiffnessOperator<K>& op, const double* B, double* X, int s,
+                       const LinearSettings& settings) override {
+        const std::size_t n = op.size(), ns = n * static_cast<std::size_t>(s);
+        LinearResult result;
+        result.nrhs = s;
+        R_.assign(ns, 0.0);
+        W_.assign(ns, 0.0);
+        Q_.assign(ns, 0.0);
+        Z_.assign(ns, 0.0);
+        S_.assign(ns, 0.0);
+        P_.assign(ns, 0.0);
+        op.apply(X, R_.data(), s);
+        std::vector<double>& bnorm = bnorm_;
+        std::vector<double>& target = target_;
+        std::vector<double>& gamma = gamma_;
+        std::vector<double>& delta = delta_;
+        std::vector<double>& gamma_old = gamma_old_;
+        std::vector<double>& alpha_old = alpha_old_;
+        std::vector<double>& good = good_;
+        for (std::vector<double>* v : {&bnorm, &target, &gamma, &delta, &gamma_old, &alpha_old, &good}) v->assign(s, 0.0);
+        for (int j = 0; j < s; ++j) {
+            double bb = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                R_[n * j + i] = B[n * j + i] - R_[n * j + i];
+                bb += B[n * j + i] * B[n * j + i];
+            }
+            bnorm[j] = std::sqrt(bb);
+            target[j] = settings.tol * bnorm[j];
+        }
+        // Último iterado com resíduo verdadeiro conhecido e o menor, por coluna
+        Xgood_.assign(X, X + ns);
+        for (int j = 0; j < s; ++j) {
+            double rr = 0.0;
+            for (std::size_t i = 0; i < n; ++i) rr += R_[n * j + i] * R_[n * j + i];
+            good[j] = std::sqrt(rr);
+        }
+        op.apply(R_.data(), W_.data(), s);
+        result.matvecs = 2;
+        for (int j = 0; j < s; ++j) {
+            double g = 0.0, d = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                g += R_[n * j + i] * R_[n * j + i];
+                d += W_[n * j + i] * R_[n * j + i];
+            }
+            gamma[j] = g;
+            delta[j] = d;
+        }
+
+        // 0: iterando, 1: convergência aparente (a verificar), 2: convergida
+        std::vector<char>& state = state_;
+        std::vector<int>& steps = steps_;
+        state.assign(s, 0);
+        steps.assign(s, 0);
+        bool drifted = false;
+        while (true) {
+            const bool check = result.iterations > 0 && result.iterations % check_ == 0;
+            bool pending = false;
+            for (int j = 0; j < s; ++j) {
+                if (state[j] == 0 && std::sqrt(gamma[j]) <= target[j]) state[j] = 1;
+                pending = pending || state[j] == 1;
+            }
+            if (check || pending) {
+                // Resíduo verdadeiro contra a recorrência
+                op.apply(X, Q_.data(), s);
+                ++result.matvecs;
+                result.max_residual = 0.0;
+                for (int j = 0; j < s; ++j) {
+                    double tt = 0.0, dd = 0.0;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const double t = B[n * j + i] - Q_[n * j + i];
+                        tt += t * t;
+                        dd += (t - R_[n * j + i]) * (t - R_[n * j + i]);
+                    }
+                    const double true_norm = std::sqrt(tt), drift = std::sqrt(dd);
+                    if (bnorm[j] > 0.0) result.max_residual = std::max(result.max_residual, true_norm / bnorm[j]);
+                    if (state[j] == 2) continue;
+                    if (true_norm < good[j]) {
+                        good[j] = true_norm;
+                        std::copy_n(X + n * j, n, &Xgood_[n * j]);
+                    }
+                    if (state[j] == 1 && true_norm <= target[j]) {
+                        state[j] = 2;
+                    } else if (state[j] == 1 || drift > 0.1 * std::max(true_norm, target[j])) {
+                        drifted = true;
+                    }
+                }
+            }
+            if (drifted || std::all_of(state.begin(), state.end(), [](char c) { return c == 2; })) break;
+            if (result.iterations >= settings.maxiter) break;
+            ++result.iterations;
+
+            // q = A w não depende de gamma e delta: sobrepõe a redução
+            op.apply(W_.data(), Q_.data(), s);
+            ++result.matvecs;
+            for (int j = 0; j < s; ++j) {
+                if (state[j] == 2) continue;
+                double beta = 0.0, denom = delta[j];
+                if (steps[j] > 0) {
+                    beta = gamma[j] / gamma_old[j];
+                    denom -= beta * gamma[j] / alpha_old[j];
+                }
+                if (!(denom > 0.0)) {
+                    drifted = true;  // curvatura não positiva na recorrência
+                    break;
+                }
+                const double alpha = gamma[j] / denom;
+                // Atualizações e a redução da próxima iteração numa só passada
+                double g = 0.0, d = 0.0;
+                double *x = X + n * j, *r = &R_[n * j], *w = &W_[n * j], *z = &Z_[n * j], *sv = &S_[n * j],
+                       *p = &P_[n * j];
+                const double* q = &Q_[n * j];
+                for (std::size_t i = 0; i < n; ++i) {
+                    z[i] = q[i] + beta * z[i];
+                    sv[i] = w[i] + beta * sv[i];
+                    p[i] = r[i] + beta * p[i];
+                    x[i] += alpha * p[i];
+                    r[i] -= alpha * sv[i];
+                    w[i] -= alpha * z[i];
+                    g += r[i] * r[i];
+                    d += w[i] * r[i];
+                }
+                ++steps[j];
+                gamma_old[j] = gamma[j];
+                alpha_old[j] = alpha;
+                gamma[j] = g;
+                delta[j] = d;
+            }
+        }
+
+        if (drifted) {
+            // Um passo enorme num modo quase nulo pode ter estragado x: as
+            // colunas não convergidas voltam ao melhor iterado verificado
+            for (int j = 0; j < s; ++j) {
+                if (state[j] != 2) std::copy_n(&Xgood_[n * j], n, X + n * j);
+            }
+            LinearSettings rest = settings;
+            rest.maxiter = std::max(0, settings.maxiter - result.iterations);
+            const LinearResult tail = fallback_.solve(op, B, X, s, rest);
+            result.iterations += tail.iterations;
+            result.matvecs += tail.matvecs;
+            result.max_residual = tail.max_residual;
+            result.fallbacks = 1;
+        }
+        return result;
+    }
+
+private:
+    int check_;
+    std::vector<double> R_, W_, Q_, Z_, S_, P_, Xgood_;
+    std::vector<double> bnorm_, target_, gamma_, delta_, gamma_old_, alpha_old_, good_;
+    std::vector<char> state_;
+    std::vector<int> steps_;
+    BlockCgSolver<K> fallback_;
+};
+
+// Campo de deslocamento afim imposto pela parede do topo (u por unidade de
+// deformação na política L) em `U` (n3): u nos átomos do topo, 0 nos demais.
+template <class L>
+void wall_displacement(const Network& net, double* U) {
+    double u[3];
+    L::displacement(1.0, u);
+    std::fill(U, U + 3 * static_cast<std::size_t>(net.num_atoms), 0.0);
+    for (std::uint32_t i = 0; i < net.num_atoms; ++i) {
+        if (net.atom_type[i] == atom_top) {
+            for (int c = 0; c < 3; ++c) U[3 * i + c] = u[c];
+        }
+    }
+}
+
+// Menor incremento de deslocamento da parede até a próxima quebra ao longo
+// do campo de resposta linear U (deslocamento total por unidade, incluindo
+// os átomos fixos): |d + eps (U_a - U_b)|^2 = break_len^2 por ligação.
+template <class K>
+Prediction predict_linear(const Network& net, const double* U) {
+    Prediction best;
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.breakable(b) || !net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        double d[3], g[3];
+        K::bond_vector(net.x.data(), a1, a2, net.box, d);
+        for (int c = 0; c < 3; ++c) g[c] = (c < K::dimension) ? U[3 * a1 + c] - U[3 * a2 + c] : 0.0;
+        const double a = g[0] * g[0] + g[1] * g[1] + g[2] * g[2];
+        const double bq = 2.0 * (d[0] * g[0] + d[1] * g[1] + d[2] * g[2]);
+        const double c = d[0] * d[0] + d[1] * d[1] + d[2] * d[2] - net.break_len_sq[b];
+        double eps = std::numeric_limits<double>::infinity();
+        if (c >= 0.0) eps = 0.0;
+        else if (a > 0.0) eps = (-bq + std::sqrt(bq * bq - 4.0 * a * c)) / (2.0 * a);
+        if (eps < best.strain) {
+            best.strain = eps;
+            best.bond = static_cast<int>(b);
+        }
+    }
+    return best;
+}
+
+}  // namespace spring
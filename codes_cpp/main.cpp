@@ -8,6 +8,23 @@
 //   para verificar o comprimento das ligações e quebrá-las.
 // - As ligações quebradas têm seu tipo alterado para 0, removendo-as
 //   efetivamente da minimização de energia sem o custo de comandos de script.
+// - A varredura de quebra e o preditor usam os kernels de kernels.h,
+//   especializados para o contorno, a dimensão e o carregamento da execução
+//   por um único dispatch na inicialização.
+// - Cada quebra é atribuída à quebra mais próxima da iteração anterior
+//   (árvore causal de avalanche.h), sem dumps completos.
+// - Com --reproducible, as quebras de cada iteração são ordenadas pelos tags
+//   globais dos átomos (e não pela ordem local das ligações, que muda com a
+//   decomposição e com o `atom_modify sort`). As reduções internas da
+//   minimização do LAMMPS continuam dependendo do número de ranks; a
+//   reprodutibilidade bitwise completa é garantida pelo motor nativo.
+// - O mapeamento tag -> índice local e os limiares por tipo são vetores
+//   planos reaproveitados entre iterações (sem std::map no loop).
+// - Cada `minimize` é lida de volta do Min do LAMMPS (iterações, avaliações,
+//   |f| final e stopstr). Se parou em maxiter ou maxeval, o driver escala
+//   antes da varredura: limites 10x maiores, depois `min_style fire`, depois
+//   CG com `min_modify dmax` 10x menor (escalation.h); as contagens saem no
+//   fim da execução.
 //
 // Compilação (usando CMake):
 // mkdir build && cd build
@@ -21,12 +38,18 @@
 #include <stdexcept>
 #include <map>
 #include <cmath>
+#include <algorithm>
 #include <chrono>
 #include <mpi.h>
 #include "lammps.h"     // Official LAMMPS header
 #include "library.h"    // Provides library function prototypes
 #include "lmptype.h"
 #include "atom.h"
+#include "min.h"
+#include "update.h"
+#include "avalanche.h"
+#include "escalation.h"
+#include "kernels.h"
 
 // The manual extern "C" block is removed.
 // All function prototypes are now correctly sourced from library.h
@@ -62,39 +85,51 @@ std::map<int, double> parse_thresholds(const std::string& filename) {
 }
 
 
-int main(int argc, char* argv[]) {
-    // --- Initialize MPI ---
-    MPI_Init(&argc, &argv);
-    
-    // --- Version Message ---
-    std::cout << "md-minimizer C++ v1.8" << std::endl;
+// Resultado da última `minimize`, lido do Min do LAMMPS
+spring::RelaxResult last_minimize(void* lammps) {
+    spring::RelaxResult result;
+    const LAMMPS_NS::Min* min = static_cast<LAMMPS_NS::LAMMPS*>(lammps)->update->minimize;
+    if (!min) return result;
+    result.iterations = min->niter;
+    result.force_evals = min->neval;
+    result.energy = min->efinal;
+    result.fnorm = std::sqrt(min->fnorm2_final);
+    const std::string stop = min->stopstr ? min->stopstr : "";
+    if (stop == "energy tolerance") result.stop = spring::StopReason::energy;
+    else if (stop == "force tolerance" || stop == "forces are zero") result.stop = spring::StopReason::force;
+    else if (stop == "max iterations") result.stop = spring::StopReason::max_iterations;
+    else if (stop == "max force evaluations") result.stop = spring::StopReason::max_evaluations;
+    else result.stop = spring::StopReason::no_descent;
+    return result;
+}
 
-    // --- Argumentos da Linha de Comando ---
-    if (argc < 4) {
-        std::cerr << "Uso: " << argv[0] << " <config_file> <data_file> <thresholds_file> [total_steps] [strain_inc]" << std::endl;
-        MPI_Finalize();
-        return 1;
-    }
-    std::string config_file = argv[1];
-    std::string data_file = argv[2];
-    std::string thresholds_file = argv[3];
-    int total_steps = (argc > 4) ? std::stoi(argv[4]) : 10;
-    double strain_inc = (argc > 5) ? std::stod(argv[5]) : 0.1;
-    
-    // --- Carregar Limiares de Quebra ---
-    auto thresholds = parse_thresholds(thresholds_file);
+// Loop principal de deformação, especializado para os kernels K.
+template <class K>
+void run_simulation(void* lammps, const std::map<int, double>& thresholds, int total_steps, double strain_inc,
+                    bool reproducible) {
+    using loading = typename K::loading;
+    std::cout << "Info: kernels " << K::dimension << "D, carregamento " << loading::name << std::endl;
 
-    // --- Inicialização do LAMMPS ---
-    void *lammps = lammps_open(0, NULL, MPI_COMM_WORLD, NULL);
-    if (!lammps) {
-        MPI_Finalize();
-        throw std::runtime_error("Failed to initialize LAMMPS");
+    // Buffers da varredura, reutilizados entre iterações
+    std::vector<int> scan_atom1, scan_atom2, scan_bond_index, scan_out;
+    std::vector<double> scan_break_len_sq;
+
+    // Tabelas planas, montadas uma vez: limiar ao quadrado por tipo de
+    // ligação (0: não quebrável) e índice local por tag, reaproveitado entre
+    // iterações em vez de um std::map reconstruído a cada minimização
+    std::vector<double> type_break_len_sq;
+    for (const auto& [type, len] : thresholds) {
+        if (type >= static_cast<int>(type_break_len_sq.size())) type_break_len_sq.resize(type + 1, 0.0);
+        type_break_len_sq[type] = len * len;
     }
+    std::vector<int> tag_to_local_idx;
 
-    // --- Carregar Configuração Estática do Arquivo ---
-    std::string setup_cmds = "variable data_file string " + data_file + "\n" +
-                             "include " + config_file;
-    lammps_commands_string(lammps, setup_cmds.c_str());
+    // Árvore causal das avalanches (raio de 2 comprimentos de repouso)
+    double forest_lo[3], forest_hi[3];
+    lammps_extract_box(lammps, forest_lo, forest_hi, NULL, NULL, NULL, NULL, NULL);
+    spring::AvalancheForest forest(spring::Box::from_bounds(forest_lo, forest_hi), 2.0);
+    std::vector<double> midpoints;
+    spring::RelaxTelemetry telemetry;
 
     // --- Loop Principal de Deformação (Lógica Dinâmica) ---
     long long num_broken_total = 0;
@@ -103,20 +138,53 @@ int main(int argc, char* argv[]) {
         std::cout << "--- Strain Step " << step_id + 1 << "/" << total_steps << " ---" << std::endl;
 
         // Aplica o deslocamento
-        std::string displace_cmd = "displace_atoms top_atoms move 0 " + std::to_string(strain_inc) + " 0";
+        double u[3];
+        loading::displacement(strain_inc, u);
+        std::string displace_cmd = "displace_atoms top_atoms move " + std::to_string(u[0]) + " " +
+                                   std::to_string(u[1]) + " " + std::to_string(u[2]);
         lammps_command(lammps, displace_cmd.c_str());
 
         // Fixa os átomos do topo durante a relaxação
         lammps_command(lammps, "fix 2 top_atoms setforce 0.0 0.0 0.0");
 
+        spring::ScanBonds scan_bonds;
+        spring::Box box;
+        double* x_flat = nullptr;
+
         // --- Loop da Avalanche ---
+        forest.begin_step(step_id + 1);
         while (true) {
             auto minimize_start_time = std::chrono::high_resolution_clock::now();
             lammps_command(lammps, "min_style cg");
             lammps_command(lammps, "minimize 1.0e-5 1.0e-7 1000 10000");
+            spring::RelaxResult relaxed = last_minimize(lammps);
+            const spring::StopReason capped_at = relaxed.stop;
+            // Parou num limite: continua do estado atual, degrau a degrau
+            for (int level = 1; level <= 3 && !relaxed.converged(); ++level) {
+                if (level == 2) lammps_command(lammps, "min_style fire");
+                if (level == 3) lammps_command(lammps, "min_modify dmax 0.01");
+                lammps_command(lammps, "minimize 1.0e-5 1.0e-7 10000 100000");
+                if (level == 2) lammps_command(lammps, "min_style cg");
+                if (level == 3) lammps_command(lammps, "min_modify dmax 0.1");
+                const spring::RelaxResult next = last_minimize(lammps);
+                relaxed.iterations += next.iterations;
+                relaxed.force_evals += next.force_evals;
+                relaxed.energy = next.energy;
+                relaxed.fnorm = next.fnorm;
+                relaxed.stop = next.stop;
+                relaxed.escalations = level;
+            }
+            telemetry.add(relaxed);
             auto minimize_end_time = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> minimize_duration = minimize_end_time - minimize_start_time;
-            std::cout << "   time (minimize): " << minimize_duration.count() << " s" << std::endl;
+            std::cout << "   time (minimize): " << minimize_duration.count() << " s (" << relaxed.iterations
+                      << " iterations, " << relaxed.force_evals << " evals, |f| = " << relaxed.fnorm << ", "
+                      << spring::stop_reason_name(relaxed.stop) << ")" << std::endl;
+            if (relaxed.escalations > 0) {
+                std::cout << "   Relaxation hit " << spring::stop_reason_name(capped_at) << "; escalated to "
+                          << spring::RelaxEscalation<K>::level_name(relaxed.escalations)
+                          << (relaxed.converged() ? "" : ", still unconverged") << std::endl;
+            }
 
             int broken_this_iter = 0;
 
@@ -140,40 +208,64 @@ int main(int argc, char* argv[]) {
             // lammps_get_natoms() returns double, so we cast it.
             int nlocal = static_cast<int>(lammps_get_natoms(lammps));
 
-            std::map<tagint, int> tag_to_local_idx;
-            for(int i = 0; i < nlocal; ++i) {
-                tag_to_local_idx[tag[i]] = i;
-            }
+            tagint max_tag = 0;
+            for (int i = 0; i < nlocal; ++i) max_tag = std::max(max_tag, tag[i]);
+            tag_to_local_idx.assign(static_cast<std::size_t>(max_tag) + 1, -1);
+            for (int i = 0; i < nlocal; ++i) tag_to_local_idx[tag[i]] = i;
 
             double boxlo[3], boxhi[3];
             lammps_extract_box(lammps, boxlo, boxhi, NULL, NULL, NULL, NULL, NULL);
-            double x_period = boxhi[0] - boxlo[0];
+            box = spring::Box::from_bounds(boxlo, boxhi);
 
+            // Monta a lista compacta de ligações quebráveis ativas
+            scan_atom1.clear();
+            scan_atom2.clear();
+            scan_bond_index.clear();
+            scan_break_len_sq.clear();
             for (int i = 0; i < nbonds; ++i) {
                 int current_type = bond_type[i];
-                if (current_type <= 1) continue;
-                if (thresholds.find(current_type) == thresholds.end()) continue;
-
-                double break_len = thresholds.at(current_type);
-                tagint atom1_tag = bond_atom[i][0];
-                tagint atom2_tag = bond_atom[i][1];
-                
-                if (tag_to_local_idx.find(atom1_tag) == tag_to_local_idx.end() ||
-                    tag_to_local_idx.find(atom2_tag) == tag_to_local_idx.end()) continue;
-
-                int idx1 = tag_to_local_idx[atom1_tag];
-                int idx2 = tag_to_local_idx[atom2_tag];
-                
-                double dx = x[idx1][0] - x[idx2][0];
-                double dy = x[idx1][1] - x[idx2][1];
-                dx = dx - x_period * round(dx / x_period);
-                double dist_sq = dx * dx + dy * dy;
-
-                if (sqrt(dist_sq) > break_len) {
-                    bond_type[i] = 0; // Set bond type to 0 to "break" it
-                    broken_this_iter++;
-                }
+                if (current_type <= 1 || current_type >= static_cast<int>(type_break_len_sq.size())) continue;
+                const double len_sq = type_break_len_sq[current_type];
+                if (len_sq <= 0.0) continue;
+
+                const tagint t1 = bond_atom[i][0], t2 = bond_atom[i][1];
+                if (t1 > max_tag || t2 > max_tag) continue;
+                const int i1 = tag_to_local_idx[t1], i2 = tag_to_local_idx[t2];
+                if (i1 < 0 || i2 < 0) continue;
+
+                scan_atom1.push_back(i1);
+                scan_atom2.push_back(i2);
+                scan_bond_index.push_back(i);
+                scan_break_len_sq.push_back(len_sq);
+            }
+            scan_out.resize(scan_atom1.size());
+
+            scan_bonds.n = static_cast<int>(scan_atom1.size());
+            scan_bonds.atom1 = scan_atom1.data();
+            scan_bonds.atom2 = scan_atom2.data();
+            scan_bonds.break_len_sq = scan_break_len_sq.data();
+            x_flat = x[0];
+
+            broken_this_iter = K::scan(x_flat, scan_bonds, box, scan_out.data());
+            if (reproducible) {
+                // Ordem canônica: (menor tag, maior tag) de cada ligação
+                auto key = [&](int i) {
+                    tagint t1 = tag[scan_atom1[i]], t2 = tag[scan_atom2[i]];
+                    return (t1 < t2) ? std::make_pair(t1, t2) : std::make_pair(t2, t1);
+                };
+                std::sort(scan_out.begin(), scan_out.begin() + broken_this_iter,
+                          [&](int p, int q) { return key(p) < key(q); });
+            }
+            midpoints.clear();
+            for (int b = 0; b < broken_this_iter; ++b) {
+                bond_type[scan_bond_index[scan_out[b]]] = 0; // Set bond type to 0 to "break" it
+                const int a1 = scan_atom1[scan_out[b]], a2 = scan_atom2[scan_out[b]];
+                double d[3];
+                K::bond_vector(x_flat, a1, a2, box, d);
+                midpoints.push_back(x[a2][0] + 0.5 * d[0]);
+                midpoints.push_back(x[a2][1] + 0.5 * d[1]);
             }
+            if (broken_this_iter > 0) forest.add_iteration(midpoints);
             auto access_end_time = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> access_duration = access_end_time - access_start_time;
             std::cout << "   time (breakage): " << access_duration.count() << " s" << std::endl;
@@ -186,6 +278,29 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        // Preditor: incremento afim até a próxima quebra a partir do estado relaxado
+        if (x_flat && scan_bonds.n > 0) {
+            spring::Prediction next = K::predict(x_flat, scan_bonds, box);
+            double height = box.period[1];
+            std::cout << "   Predicted next break: strain increment " << next.strain
+                      << " (displacement ~ " << next.strain * height << ")" << std::endl;
+        }
+
+        // Árvore causal do passo
+        const std::vector<spring::AvalancheStats>& avalanches = forest.end_step();
+        const spring::AvalancheStats* largest = nullptr;
+        int depth = 0;
+        for (const spring::AvalancheStats& a : avalanches) {
+            if (!largest || a.size > largest->size) largest = &a;
+            depth = std::max(depth, a.depth);
+        }
+        if (largest) {
+            std::cout << "   Avalanches: " << avalanches.size() << " (largest " << largest->size
+                      << ", max depth " << depth << ")" << std::endl;
+            std::cout << "   Largest avalanche extent " << largest->extent_x << " x " << largest->extent_y
+                      << ", R_g " << largest->gyration << std::endl;
+        }
+
         lammps_command(lammps, "unfix 2");
         
         auto step_end_time = std::chrono::high_resolution_clock::now();
@@ -194,6 +309,68 @@ int main(int argc, char* argv[]) {
         std::cout << "Finished strain step " << step_id + 1 << "; cumulative broken = " << num_broken_total << std::endl;
         std::cout << "Total time for step: " << step_duration.count() << " s\n" << std::endl;
     }
+    telemetry.print(std::cout);
+}
+
+
+int main(int argc, char* argv[]) {
+    // --- Initialize MPI ---
+    MPI_Init(&argc, &argv);
+
+    // --reproducible pode aparecer em qualquer posição
+    bool reproducible = false;
+    for (int a = 1; a < argc; ++a) {
+        if (std::string(argv[a]) == "--reproducible") {
+            reproducible = true;
+            for (int b = a; b + 1 < argc; ++b) argv[b] = argv[b + 1];
+            --argc;
+            break;
+        }
+    }
+    
+    // --- Version Message ---
+    std::cout << "md-minimizer C++ v1.8" << std::endl;
+
+    // --- Argumentos da Linha de Comando ---
+    if (argc < 4) {
+        std::cerr << "Uso: " << argv[0] << " <config_file> <data_file> <thresholds_file> [total_steps] [strain_inc] [tensile|shear] [--reproducible]" << std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+    std::string config_file = argv[1];
+    std::string data_file = argv[2];
+    std::string thresholds_file = argv[3];
+    int total_steps = (argc > 4) ? std::stoi(argv[4]) : 10;
+    double strain_inc = (argc > 5) ? std::stod(argv[5]) : 0.1;
+    spring::Loading loading = (argc > 6) ? spring::parse_loading(argv[6]) : spring::Loading::tensile;
+    
+    // --- Carregar Limiares de Quebra ---
+    auto thresholds = parse_thresholds(thresholds_file);
+
+    // --- Inicialização do LAMMPS ---
+    void *lammps = lammps_open(0, NULL, MPI_COMM_WORLD, NULL);
+    if (!lammps) {
+        MPI_Finalize();
+        throw std::runtime_error("Failed to initialize LAMMPS");
+    }
+
+    // --- Carregar Configuração Estática do Arquivo ---
+    std::string setup_cmds = "variable data_file string " + data_file + "\n" +
+                             "include " + config_file;
+    lammps_commands_string(lammps, setup_cmds.c_str());
+
+    // --- Seleção dos Kernels (uma única vez) ---
+    spring::KernelConfig kernel_config;
+    int periodicity[3];
+    double boxlo[3], boxhi[3];
+    lammps_extract_box(lammps, boxlo, boxhi, NULL, NULL, NULL, periodicity, NULL);
+    for (int d = 0; d < 3; ++d) kernel_config.periodic[d] = (periodicity[d] != 0);
+    kernel_config.dimension = lammps_extract_setting(lammps, "dimension");
+    kernel_config.loading = loading;
+
+    spring::dispatch_kernels(kernel_config, [&](auto kernels) {
+        run_simulation<decltype(kernels)>(lammps, thresholds, total_steps, strain_inc, reproducible);
+    });
 
     // --- Finalização ---
     lammps_close(lammps);
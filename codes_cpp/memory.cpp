@@ -0,0 +1,111 @@
+// memory.cpp
+
+#include "memory.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <new>
+#include <sstream>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+std::atomic<std::uint64_t> g_heap_count{0};
+std::atomic<std::uint64_t> g_heap_bytes{0};
+
+void* counted_malloc(std::size_t bytes) {
+    g_heap_count.fetch_add(1, std::memory_order_relaxed);
+    g_heap_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return std::malloc(bytes ? bytes : 1);
+}
+
+}  // namespace
+
+// --- operator new contado (motor nativo) ---
+void* operator new(std::size_t bytes) {
+    if (void* p = counted_malloc(bytes)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t bytes) {
+    if (void* p = counted_malloc(bytes)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t bytes, const std::nothrow_t&) noexcept { return counted_malloc(bytes); }
+void* operator new[](std::size_t bytes, const std::nothrow_t&) noexcept { return counted_malloc(bytes); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace spring {
+
+std::size_t advise_huge_pages(const void* data, std::size_t bytes) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    constexpr std::uintptr_t huge = std::uintptr_t(2) << 20;
+    const std::uintptr_t begin = (reinterpret_cast<std::uintptr_t>(data) + huge - 1) & ~(huge - 1);
+    const std::uintptr_t end = (reinterpret_cast<std::uintptr_t>(data) + bytes) & ~(huge - 1);
+    if (end <= begin) return 0;
+    if (madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE) != 0) return 0;
+    return end - begin;
+#else
+    (void)data;
+    (void)bytes;
+    return 0;
+#endif
+}
+
+HeapStats heap_stats() {
+    HeapStats s;
+    s.count = g_heap_count.load(std::memory_order_relaxed);
+    s.bytes = g_heap_bytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+void AllocationPhases::begin(const char* phase) {
+    end();
+    int index = -1;
+    for (std::size_t e = 0; e < entries_.size(); ++e) {
+        if (entries_[e].name == phase) index = static_cast<int>(e);
+    }
+    if (index < 0) {
+        entries_.push_back(Entry{phase, {}, {}});
+        index = static_cast<int>(entries_.size()) - 1;
+    }
+    current_ = index;
+    start_ = heap_stats();
+}
+
+void AllocationPhases::end() {
+    if (current_ < 0) return;
+    const HeapStats now = heap_stats();
+    Entry& e = entries_[current_];
+    const std::uint64_t count = now.count - start_.count, bytes = now.bytes - start_.bytes;
+    e.total.count += count;
+    e.total.bytes += bytes;
+    if (steady_) {
+        e.steady.count += count;
+        e.steady.bytes += bytes;
+    }
+    current_ = -1;
+}
+
+void AllocationPhases::print(std::ostream& out) const {
+    // Stream local: o formato fixo não vaza para `out`
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1) << "Info: alocações no heap por fase (total; após o 1º passo):";
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        const Entry& e = entries_[i];
+        line << (i ? "," : "") << ' ' << e.name << ' ' << e.total.count << " (" << e.total.bytes / 1024.0 << " KiB; "
+             << e.steady.count << ", " << e.steady.bytes / 1024.0 << " KiB)";
+    }
+    out << line.str() << std::endl;
+}
+
+}  // namespace spring
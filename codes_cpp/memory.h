@@ -0,0 +1,211 @@
+// memory.h
+//
+// Alocação do estado do motor: arena, pool, páginas grandes e contagem.
+//
+// - `Arena`: alocador de deslocamento em blocos de 1 MiB para os
+//   temporários de uma iteração da avalanche (listas de quebras, grupos de
+//   patches). reset() volta ao início sem devolver os blocos, então depois da
+//   primeira avalanche grande esses temporários não tocam mais o heap.
+//   `ArenaAllocator` adapta a arena a std::vector; deallocate não faz nada.
+// - `Pool`: blocos pequenos (classes de 16 em 16 B até 256 B) com lista
+//   livre, para registros que nascem e morrem aos milhares (nós dos
+//   conjuntos de hash da árvore de avalanches). Blocos maiores vão ao heap.
+// - `advise_huge_pages`: madvise(MADV_HUGEPAGE) no trecho alinhado a 2 MiB de
+//   um array grande, para que o THP (em modo `madvise` ou `always`) use
+//   páginas de 2 MiB nas posições e nas ligações (menos faltas de TLB nas
+//   varreduras de redes N >= 384). Sem efeito fora do Linux.
+// - `heap_stats`: contagem global de alocações pelo operator new substituído
+//   em memory.cpp (apenas no motor nativo); `AllocationPhases` acumula as
+//   diferenças por fase do loop, separando o regime após o primeiro passo.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace spring {
+
+class Arena {
+public:
+    explicit Arena(std::size_t block_bytes = std::size_t(1) << 20) : block_bytes_(block_bytes) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t align) {
+        while (current_ < blocks_.size()) {
+            Block& b = blocks_[current_];
+            const std::size_t offset = (offset_ + align - 1) & ~(align - 1);
+            if (offset + bytes <= b.size) {
+                offset_ = offset + bytes;
+                used_ = std::max(used_, used_before_ + offset_);
+                return b.data.get() + offset;
+            }
+            used_before_ += b.size;
+            ++current_;
+            offset_ = 0;
+        }
+        const std::size_t size = std::max(block_bytes_, bytes + align);
+        blocks_.push_back(Block{std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+        return allocate(bytes, align);
+    }
+
+    // Descarta tudo o que foi alocado, mantendo os blocos
+    void reset() {
+        current_ = 0;
+        offset_ = 0;
+        used_before_ = 0;
+    }
+
+    std::size_t bytes() const {
+        std::size_t total = 0;
+        for (const Block& b : blocks_) total += b.size;
+        return total;
+    }
+    std::size_t high_water() const { return used_; }
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+    std::size_t block_bytes_;
+    std::vector<Block> blocks_;
+    std::size_t current_ = 0, offset_ = 0, used_before_ = 0, used_ = 0;
+};
+
+template <class T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, std::size_t) {}
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+    Arena* arena;
+};
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+class Pool {
+public:
+    static constexpr std::size_t granule = 16;
+    static constexpr std::size_t max_bytes = 256;
+
+    Pool() = default;
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    void* allocate(std::size_t bytes) {
+        if (bytes > max_bytes) return ::operator new(bytes);
+        const std::size_t c = (bytes + granule - 1) / granule - 1;
+        if (!free_[c]) refill(c);
+        Free* p = free_[c];
+        free_[c] = p->next;
+        return p;
+    }
+
+    void deallocate(void* p, std::size_t bytes) {
+        if (bytes > max_bytes) {
+            ::operator delete(p);
+            return;
+        }
+        const std::size_t c = (bytes + granule - 1) / granule - 1;
+        Free* f = static_cast<Free*>(p);
+        f->next = free_[c];
+        free_[c] = f;
+    }
+
+    std::size_t bytes() const { return chunks_.size() * chunk_bytes; }
+
+private:
+    static constexpr std::size_t chunk_bytes = 64 * 1024;
+    struct Free {
+        Free* next;
+    };
+
+    void refill(std::size_t c) {
+        const std::size_t size = (c + 1) * granule;
+        chunks_.emplace_back(new std::byte[chunk_bytes]);
+        std::byte* base = chunks_.back().get();
+        for (std::size_t off = 0; off + size <= chunk_bytes; off += size) {
+            Free* f = reinterpret_cast<Free*>(base + off);
+            f->next = free_[c];
+            free_[c] = f;
+        }
+    }
+
+    Free* free_[max_bytes / granule] = {};
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+};
+
+template <class T>
+struct PoolAllocator {
+    using value_type = T;
+
+    explicit PoolAllocator(Pool* pool) : pool(pool) {}
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(pool->allocate(n * sizeof(T))); }
+    void deallocate(T* p, std::size_t n) { pool->deallocate(p, n * sizeof(T)); }
+
+    template <class U>
+    bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+    template <class U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+
+    Pool* pool;
+};
+
+// Bytes efetivamente marcados (0 se o array não cobre uma página de 2 MiB
+// alinhada, ou fora do Linux)
+std::size_t advise_huge_pages(const void* data, std::size_t bytes);
+
+template <class T, class A>
+std::size_t advise_huge_pages(const std::vector<T, A>& v) {
+    return advise_huge_pages(v.data(), v.capacity() * sizeof(T));
+}
+
+struct HeapStats {
+    std::uint64_t count = 0;
+    std::uint64_t bytes = 0;
+};
+
+// Alocações pelo operator new desde o início do processo
+HeapStats heap_stats();
+
+class AllocationPhases {
+public:
+    // Encerra a fase corrente e começa `phase`
+    void begin(const char* phase);
+    void end();
+    // A partir daqui, as alocações contam também no regime (após o aquecimento)
+    void mark_steady() { steady_ = true; }
+    void print(std::ostream& out) const;
+
+private:
+    struct Entry {
+        std::string name;
+        HeapStats total, steady;
+    };
+    std::vector<Entry> entries_;
+    int current_ = -1;
+    HeapStats start_;
+    bool steady_ = false;
+};
+
+}  // namespace spring
@@ -0,0 +1,715 @@
+// native_main.cpp
+//
+// Driver do motor nativo: reproduz a dinâmica de main.cpp (deslocamento do
+// topo, relaxação, avalanche de quebras) sem o LAMMPS, sobre o layout
+// compacto de network.h.
+//
+// Uso:
+//   spring_network_native <data_file> <thresholds_file> [total_steps] [strain_inc] [tensile|shear] [opções]
+//   spring_network_native --lattice N [--L_matrix L] [--seed S] [total_steps] [strain_inc] [tensile|shear] [opções]
+//   spring_network_native --delaunay N [--jitter J] [--seed S] [total_steps] [strain_inc] [tensile|shear] [opções]
+//
+// Opções:
+//   --implicit        rede implícita (conectividade calculada a partir de (j, i))
+//   --lattice N       gera a rede triangular N x N em processo
+//   --L_matrix L      tamanho da matriz inquebrável da rede gerada (padrão 4)
+//   --seed S          semente dos limiares da rede gerada (padrão 1)
+//   --dilution P      cada ligação da rede gerada existe com probabilidade P
+//   --delaunay N      gera uma rede de Delaunay (periódica em x) com N x N pontos
+//   --jitter J        perturbação dos pontos da rede de Delaunay em unidades de
+//                     l0 (padrão 0.3); J < 0 usa pontos de Poisson
+//   --reorder         renumera átomos e ligações na ordem de Hilbert (redes
+//                     explícitas; padrão para --delaunay)
+//   --realizations R  executa R realizações (a rede gerada usa seed + r)
+//   --correlation_length XI
+//                     limiares correlacionados por um campo gaussiano (FFT)
+//   --threshold_dist D distribuição dos limiares do campo: uniform,a,b ou
+//                     weibull,m,escala (padrão uniform,0,1)
+//   --layout SPEC     layout de reforço (ver layout.h); a rede gerada passa a
+//                     usar L_matrix = 0 e o layout define as inquebráveis
+//   --threads T       threads das etapas paralelas (padrão: todos os núcleos)
+//   --force_threads T threads do laço de forças da relaxação, sobre classes de
+//                     ligações sem átomos em comum (coloring.h; padrão 1:
+//                     laço serial)
+//   --patch_radius R  depois de cada iteração da avalanche com quebras, relaxa
+//                     em paralelo patches de raio R em torno de cada grupo de
+//                     quebras próximas como ponto de partida da relaxação
+//                     global, que decide as quebras (patches.h; padrão 0:
+//                     desligado)
+//   --runaway F       curto-circuito da avalanche catastrófica: dispara quando
+//                     a reação da parede cai abaixo de F vezes o pico, as
+//                     quebras crescem geometricamente ou uma trinca
+//                     atravessa a amostra; com a trinca atravessando, os
+//                     átomos vão direto ao equilíbrio sem tensão (runaway.h;
+//                     padrão 0: desligado)
+//   --force_bench     mede o laço de forças serial e colorido com 1, 2, 4,
+//                     ..., T threads (T = --force_threads ou --threads)
+//   --relax B         backend de relaxação: cg (padrão), fire, newton
+//                     (Newton-Krylov com região de confiança), schur
+//                     (subestruturação no esqueleto inquebrável), recycle
+//                     (Newton com CG deflacionado e subespaço reciclado),
+//                     ic (CG precondicionado por Cholesky incompleto,
+//                     atualizado só onde houve dano), schwarz (CG com
+//                     Schwarz aditivo e espaço grosso) ou auto
+//                     (autotune.h: calibração, monitoramento e cache)
+//   --subdomains S    subdomínios por lado do --relax schwarz (padrão 4)
+//   --maxiter N       limite de iterações de cada relaxação (padrão 1000)
+//   --maxeval N       limite de avaliações de força (padrão 10000); ao
+//                     atingir um limite a relaxação escala (escalation.h)
+//   --tuning_file F   cache das decisões do auto (padrão spring_tuning.txt)
+//   --linear_response resposta linear (CG em bloco, tração e cisalhamento numa
+//                     única solução) e previsão da próxima quebra por passo
+//   --linear_solver S solver da resposta linear: block (CG em bloco, padrão) ou
+//                     pipelined (CG pipelined de Ghysels-Vanroose, uma redução
+//                     por iteração, com volta ao CG em bloco se o resíduo
+//                     desviar)
+//   --rigidity        pebble game incremental após cada quebra: átomos
+//                     flexíveis em relação às paredes são fixados e suas
+//                     ligações saem das forças e da varredura (rigidity.h)
+//   --reproducible    reduções determinísticas na relaxação (reduce.h); a
+//                     sequência de quebras não depende de threads/ranks
+//   --avalanche_radius R
+//                     raio de redistribuição da árvore causal (padrão 2 r0)
+//   --avalanche_log F arquivo CSV com uma linha por avalanche (ver avalanche.h)
+//   --report F        relatório do ensemble com intervalos bootstrap (padrão:
+//                     impresso ao final quando R > 1; ver ensemble.h)
+//   --bootstrap B     número de reamostragens bootstrap (padrão 1000)
+//   --confidence C    nível dos intervalos (padrão 0.95)
+//   --avalanche_hist F histogramas (log2) de tamanho, extensão, raio de
+//                     giração e células da matriz de todas as realizações
+//                     (padrão: impressos ao final)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "autotune.h"
+#include "avalanche.h"
+#include "coloring.h"
+#include "ensemble.h"
+#include "escalation.h"
+#include "generator.h"
+#include "graph.h"
+#include "kernels.h"
+#include "layout.h"
+#include "memory.h"
+#include "network.h"
+#include "offlattice.h"
+#include "parallel.h"
+#include "patches.h"
+#include "relax.h"
+#include "rigidity.h"
+#include "runaway.h"
+#include "threshold_field.h"
+
+// --- Argumentos da Linha de Comando ---
+struct NativeOptions {
+    std::vector<std::string> positional;
+    std::map<std::string, std::string> values;
+    bool flag(const std::string& key) const { return values.count(key) != 0; }
+    std::string get(const std::string& key, const std::string& fallback) const {
+        auto it = values.find(key);
+        return (it == values.end()) ? fallback : it->second;
+    }
+};
+
+NativeOptions parse_options(int argc, char* argv[]) {
+    static const char* switches[] = {"--implicit", "--reorder", "--reproducible", "--linear_response", "--rigidity",
+                                     "--force_bench"};
+    NativeOptions opts;
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg.rfind("--", 0) != 0) {
+            opts.positional.push_back(arg);
+            continue;
+        }
+        bool is_switch = false;
+        for (const char* sw : switches) is_switch = is_switch || (arg == sw);
+        if (is_switch) {
+            opts.values[arg] = "1";
+        } else if (a + 1 < argc) {
+            opts.values[arg] = argv[++a];
+        } else {
+            throw std::runtime_error("Erro: a opção " + arg + " exige um valor");
+        }
+    }
+    return opts;
+}
+
+// Saídas por realização do loop de deformação
+struct RunContext {
+    int realization = 0;
+    double avalanche_radius = 2.0;
+    int L_matrix = 0;  // grade das células da matriz (0: sem contagem)
+    bool reproducible = false;
+    int subdomains = 4;
+    int maxiter = 1000, maxeval = 10000;  // limites de `minimize`
+    int force_threads = 1;
+    bool force_bench = false;
+    double patch_radius = 0.0;  // raio dos patches da pré-relaxação local (0: desligado)
+    double runaway = 0.0;       // fração do pico da reação que dispara o curto-circuito (0: desligado)
+    int threads = 1;
+    int force_bench_threads = 1;
+    bool linear_response = false;
+    bool pipelined_cg = false;
+    bool rigidity = false;
+    std::string relax = "cg";
+    spring::TuningCache* tuning = nullptr;
+    std::ostream* avalanche_log = nullptr;
+    spring::LogHistogram* histograms = nullptr;  // size, extent, gyration, cells
+    spring::RealizationSummary* summary = nullptr;
+};
+
+// Pontos médios (x, y) das ligações quebradas, periódicos como os kernels
+template <class K>
+void broken_midpoints(const spring::Network& net, const int* broken, int count, std::vector<double>& out) {
+    out.clear();
+    for (int b = 0; b < count; ++b) {
+        std::uint32_t a1 = 0, a2 = 0;
+        net.endpoints(static_cast<std::uint32_t>(broken[b]), a1, a2);
+        double d[3];
+        K::bond_vector(net.x.data(), a1, a2, net.box, d);
+        out.push_back(net.x[3 * a2] + 0.5 * d[0]);
+        out.push_back(net.x[3 * a2 + 1] + 0.5 * d[1]);
+    }
+}
+
+// Loop principal de deformação, especializado para os kernels K.
+template <class K>
+void run_simulation(spring::Network& net, int total_steps, double strain_inc, const RunContext& ctx) {
+    using loading = typename K::loading;
+    std::cout << "Info: kernels " << K::dimension << "D, carregamento " << loading::name << std::endl;
+
+    std::unique_ptr<spring::RelaxBackend<K>> relax;
+    if (ctx.relax == "auto") {
+        relax = std::make_unique<spring::AutoTuneRelax<K>>(spring::auto_candidates(net), ctx.tuning,
+                                                           spring::tuning_key(net, ctx.L_matrix));
+    } else {
+        relax = spring::make_relax_backend<K>(ctx.relax);
+    }
+    auto* tuner = dynamic_cast<spring::AutoTuneRelax<K>*>(relax.get());
+    spring::RelaxProfile profile;
+    spring::RelaxEscalation<K> escalation;
+    spring::RelaxTelemetry telemetry;
+    spring::RelaxSettings settings;
+    settings.reproducible = ctx.reproducible;
+    settings.subdomains = ctx.subdomains;
+    settings.maxiter = ctx.maxiter;
+    settings.maxeval = ctx.maxeval;
+    spring::BondColoring coloring;
+    if (ctx.force_threads > 1 || ctx.force_bench) {
+        auto coloring_start_time = std::chrono::high_resolution_clock::now();
+        coloring = spring::color_bonds(net);
+        std::chrono::duration<double> coloring_duration = std::chrono::high_resolution_clock::now() - coloring_start_time;
+        std::uint32_t smallest = net.num_bonds, largest = 0;
+        for (int c = 0; c < coloring.num_colors(); ++c) {
+            smallest = std::min(smallest, coloring.size(c));
+            largest = std::max(largest, coloring.size(c));
+        }
+        std::cout << "Info: coloração " << (coloring.lattice ? "da rede triangular" : "gulosa") << ": "
+                  << coloring.num_colors() << " classes (" << smallest << " a " << largest << " ligações)"
+                  << (spring::check_coloring(net, coloring) ? "" : " INVÁLIDA") << "; " << coloring_duration.count()
+                  << " s" << std::endl;
+        if (ctx.force_bench) spring::benchmark_forces<K>(net, coloring, ctx.force_bench_threads, std::cout);
+    }
+    // Pool de threads e parciais do laço colorido: um por execução
+    std::unique_ptr<spring::ColoredForces> colored;
+    if (ctx.force_threads > 1) {
+        colored = std::make_unique<spring::ColoredForces>(coloring, ctx.force_threads);
+        settings.colored = colored.get();
+    }
+    std::vector<int> scan_out(net.num_bonds);
+    // Resposta linear (--linear_response): operador e resposta mantidos entre
+    // passos; a resposta de um passo é o chute inicial do seguinte
+    std::unique_ptr<spring::StiffnessOperator<K>> stiffness;
+    std::vector<double> imposed, response;
+
+    // Páginas de 2 MiB para os arrays grandes (a partir de N ~ 384 na rede
+    // triangular; memory.h)
+    const std::size_t huge_bytes = spring::advise_huge_pages(net.x) + spring::advise_huge_pages(net.break_len_sq) +
+                                   spring::advise_huge_pages(net.bond_atom1) + spring::advise_huge_pages(net.bond_atom2) +
+                                   spring::advise_huge_pages(net.alive.words(), net.alive.bytes()) +
+                                   spring::advise_huge_pages(scan_out);
+    if (huge_bytes > 0) {
+        std::cout << "Info: páginas grandes (madvise) em " << huge_bytes / (1024.0 * 1024.0) << " MiB" << std::endl;
+    }
+    spring::AvalancheForest forest(net.box, ctx.avalanche_radius);
+    forest.set_matrix_cells(spring::MatrixCells::for_lattice(ctx.L_matrix, net.r0, net.box));
+    std::vector<double> midpoints;
+
+    std::vector<std::uint32_t> top_atoms;
+    for (std::uint32_t i = 0; i < net.num_atoms; ++i) {
+        if (net.atom_type[i] == spring::atom_top) top_atoms.push_back(i);
+    }
+
+    // Altura entre as paredes (para o módulo efetivo)
+    double y_top = 0.0, y_bottom = 0.0;
+    std::size_t n_top = 0, n_bottom = 0;
+    for (std::uint32_t i = 0; i < net.num_atoms; ++i) {
+        if (net.atom_type[i] == spring::atom_top) y_top += net.x[3 * i + 1], ++n_top;
+        if (net.atom_type[i] == spring::atom_bottom) y_bottom += net.x[3 * i + 1], ++n_bottom;
+    }
+    const double height = (n_top && n_bottom) ? y_top / n_top - y_bottom / n_bottom : 1.0;
+    const double width = (net.box.period[0] > 0.0) ? net.box.period[0] : net.box.hi[0] - net.box.lo[0];
+
+    // Pebble game (construído uma vez; cada quebra é uma remoção incremental)
+    std::unique_ptr<spring::PebbleGame> rigidity;
+    if (ctx.rigidity) {
+        auto rigidity_start_time = std::chrono::high_resolution_clock::now();
+        rigidity = std::make_unique<spring::PebbleGame>(net);
+        spring::RigidityReport initial = rigidity->prune_floppy(net);
+        std::chrono::duration<double> rigidity_duration = std::chrono::high_resolution_clock::now() - rigidity_start_time;
+        std::cout << "Info: rigidez: " << initial.rigid_atoms << " átomos no cluster rígido, " << initial.redundant_bonds
+                  << " ligações redundantes, " << initial.floppy_atoms << " átomos flexíveis fixados; "
+                  << rigidity_duration.count() << " s" << std::endl;
+    }
+
+    // Pré-relaxação local em patches (patches.h)
+    std::unique_ptr<spring::PatchRelax<K>> patches;
+    if (ctx.patch_radius > 0.0) patches = std::make_unique<spring::PatchRelax<K>>(ctx.patch_radius, ctx.threads);
+    spring::Arena arena;  // temporários de cada iteração da avalanche
+
+    // Curto-circuito da avalanche catastrófica (runaway.h)
+    std::unique_ptr<spring::RunawayDetector> runaway;
+    if (ctx.runaway > 0.0) {
+        spring::RunawaySettings runaway_settings;
+        runaway_settings.force_fraction = ctx.runaway;
+        runaway = std::make_unique<spring::RunawayDetector>(net, runaway_settings);
+    }
+    std::vector<double> placement_forces;
+
+    // --- Loop Principal de Deformação ---
+    spring::AllocationPhases phases;
+    long long num_broken_total = 0;
+    for (int step_id = 0; step_id < total_steps; ++step_id) {
+        auto step_start_time = std::chrono::high_resolution_clock::now();
+        std::cout << "--- Strain Step " << step_id + 1 << "/" << total_steps << " ---" << std::endl;
+        const long long broken_before_step = num_broken_total;
+
+        // Aplica o deslocamento (os átomos do topo ficam fixos na relaxação)
+        double u[3];
+        loading::displacement(strain_inc, u);
+        for (std::uint32_t i : top_atoms) {
+            for (int c = 0; c < 3; ++c) net.x[3 * i + c] += u[c];
+        }
+
+        // --- Loop da Avalanche ---
+        forest.begin_step(step_id + 1);
+        if (runaway) runaway->begin_step(step_id + 1);
+        double wall_force = 0.0;
+        spring::RigidityReport pruned;
+        double rigidity_seconds = 0.0;
+        bool patch_pending = false;  // candidatas dos patches à espera da varredura global
+        // Registra e aplica uma lista de quebras (árvore causal, bitset, rigidez)
+        auto apply_breaks = [&](const int* broken, int count) {
+            if (count == 0) return;
+            broken_midpoints<K>(net, broken, count, midpoints);
+            forest.add_iteration(midpoints);
+            for (int b = 0; b < count; ++b) net.break_bond(static_cast<std::uint32_t>(broken[b]));
+            if (rigidity) {
+                auto rigidity_start_time = std::chrono::high_resolution_clock::now();
+                for (int b = 0; b < count; ++b) rigidity->remove_bond(static_cast<std::uint32_t>(broken[b]));
+                spring::RigidityReport r = rigidity->prune_floppy(net);
+                pruned.floppy_atoms += r.floppy_atoms;
+                pruned.floppy_clusters += r.floppy_clusters;
+                pruned.removed_bonds += r.removed_bonds;
+                pruned.floppy_modes = std::max(pruned.floppy_modes, r.floppy_modes);
+                pruned.rigid_atoms = r.rigid_atoms;
+                pruned.redundant_bonds = r.redundant_bonds;
+                std::chrono::duration<double> rigidity_duration = std::chrono::high_resolution_clock::now() - rigidity_start_time;
+                rigidity_seconds += rigidity_duration.count();
+            }
+        };
+        while (true) {
+            phases.begin("relax");
+            auto minimize_start_time = std::chrono::high_resolution_clock::now();
+            spring::RelaxResult relaxed;
+            spring::StopReason capped_at = spring::StopReason::max_iterations;
+            // Trinca atravessando: o equilíbrio sem tensão dispensa a relaxação
+            bool placed = false;
+            if (runaway && runaway->failed()) {
+                double u_total[3];
+                loading::displacement((step_id + 1) * strain_inc, u_total);
+                if (runaway->place_stress_free(net, u_total)) {
+                    spring::ForceField<K> field(net, settings);
+                    std::vector<double>& f = placement_forces;
+                    f.assign(3 * static_cast<std::size_t>(net.num_atoms), 0.0);
+                    relaxed.energy = field.compute(net.x.data(), f.data());
+                    relaxed.force_evals = 1;
+                    relaxed.wall_force = field.wall_force();
+                    relaxed.stop = spring::StopReason::force;
+                    double ff = 0.0;
+                    for (double v : f) ff += v * v;
+                    relaxed.fnorm = std::sqrt(ff);
+                    // Mesmo critério de força das relaxações, independente do tamanho
+                    // e do comprimento de repouso
+                    placed = relaxed.fnorm < settings.ftol;
+                    if (!placed) runaway->reject_placement(net);
+                }
+            }
+            if (!placed) {
+                relaxed = relax->relax(net, settings);
+                // Parou num limite: a escada de escalation.h continua do estado atual
+                capped_at = relaxed.stop;
+                relaxed = escalation.recover(*relax, net, settings, relaxed);
+                telemetry.add(relaxed);
+            }
+            auto minimize_end_time = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> minimize_duration = minimize_end_time - minimize_start_time;
+            profile.add(placed ? "stress-free" : relax->name(), relaxed, minimize_duration.count());
+            wall_force = relaxed.wall_force;
+            std::cout << "   time (minimize): " << minimize_duration.count() << " s (";
+            if (placed) std::cout << "stress-free placement, ";
+            std::cout << relaxed.iterations << " iterations, " << relaxed.force_evals << " evals, ";
+            if (relaxed.linear_iterations > 0) std::cout << relaxed.linear_iterations << " CG iterations, ";
+            if (relaxed.refactored_cells > 0) std::cout << relaxed.refactored_cells << " cells refactored, ";
+            if (relaxed.local_refreshes + relaxed.full_refreshes > 0) {
+                std::cout << "preconditioner " << (relaxed.full_refreshes > 0 ? "full" : "local") << " refresh ";
+                if (relaxed.full_refreshes == 0) std::cout << relaxed.local_refreshes << " regions ";
+                std::cout << relaxed.refresh_seconds << " s, ";
+            }
+            std::cout << "|f| = " << relaxed.fnorm << ", " << spring::stop_reason_name(relaxed.stop) << ")" << std::endl;
+            if (relaxed.escalations > 0) {
+                std::cout << "   Relaxation hit " << spring::stop_reason_name(capped_at) << "; escalated to "
+                          << spring::RelaxEscalation<K>::level_name(relaxed.escalations)
+                          << (relaxed.converged() ? "" : ", still unconverged") << std::endl;
+            }
+
+            phases.begin("breakage");
+            auto access_start_time = std::chrono::high_resolution_clock::now();
+            // A varredura compacta em ordem crescente de ligação: a lista de
+            // quebras já é canônica para a rede dada.
+            int broken_this_iter = spring::scan_network<K>(net, scan_out.data());
+            apply_breaks(scan_out.data(), broken_this_iter);
+            auto access_end_time = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> access_duration = access_end_time - access_start_time;
+            std::cout << "   time (breakage): " << access_duration.count() << " s" << std::endl;
+
+            num_broken_total += broken_this_iter;
+            std::cout << "   Avalanche iteration broke " << broken_this_iter << " bonds." << std::endl;
+            if (patch_pending) {
+                const std::size_t candidates = patches->last_round().candidates.size();
+                const int hits = patches->confirmed(scan_out.data(), broken_this_iter);
+                std::cout << "   Patch candidates confirmed: " << hits << " of " << candidates << " (" << broken_this_iter - hits
+                          << " not predicted)" << std::endl;
+                patch_pending = false;
+            }
+
+            if (runaway) runaway->observe(net, wall_force, broken_this_iter, placed);
+            if (broken_this_iter == 0) {
+                break;
+            }
+
+            // Pré-relaxação local em patches em torno das quebras: só move os
+            // átomos; a próxima relaxação global e a sua varredura decidem
+            if (patches && broken_this_iter > 0) {
+                phases.begin("patches");
+                auto patch_start_time = std::chrono::high_resolution_clock::now();
+                const spring::PatchAvalanche::Round& round =
+                    patches->relax(net, scan_out.data(), broken_this_iter, settings, arena);
+                if (!round.skipped) {
+                    std::chrono::duration<double> patch_duration = std::chrono::high_resolution_clock::now() - patch_start_time;
+                    spring::RelaxResult patch_result;
+                    patch_result.iterations = round.iterations;
+                    patch_result.force_evals = round.force_evals;
+                    profile.add("patch", patch_result, patch_duration.count());
+                    std::cout << "   time (patches): " << patch_duration.count() << " s (" << round.patches << " patches, "
+                              << round.atoms << " atoms, " << round.iterations << " iterations, "
+                              << round.candidates.size() << " candidate bonds)" << std::endl;
+                    patch_pending = true;
+                }
+            }
+            arena.reset();
+        }
+
+        // --- Árvore causal do passo ---
+        phases.begin("step");
+        const std::vector<spring::AvalancheStats>& avalanches = forest.end_step();
+        if (!avalanches.empty()) {
+            auto largest = std::max_element(avalanches.begin(), avalanches.end(),
+                [](const spring::AvalancheStats& a, const spring::AvalancheStats& b) { return a.size < b.size; });
+            std::cout << "   Avalanches: " << avalanches.size() << " (largest " << largest->size << ", depth "
+                      << largest->depth << ", branching " << largest->branching << ", spread " << largest->spread
+                      << ")" << std::endl;
+            std::cout << "   Largest avalanche extent " << largest->extent_x << " x " << largest->extent_y
+                      << ", R_g " << largest->gyration << ", matrix cells " << largest->cells << std::endl;
+            if (ctx.avalanche_log) forest.write_events(*ctx.avalanche_log, ctx.realization);
+            for (const spring::AvalancheStats& a : avalanches) {
+                if (ctx.summary) ctx.summary->trees.push_back(static_cast<std::uint32_t>(a.size));
+                ctx.histograms[0].add(double(a.size));
+                ctx.histograms[1].add(std::max(a.extent_x, a.extent_y));
+                ctx.histograms[2].add(a.gyration);
+                ctx.histograms[3].add(double(a.cells));
+            }
+        }
+
+        if (runaway) {
+            if (const spring::RunawayEvent* e = runaway->end_step()) {
+                std::cout << "   Runaway: " << spring::runaway_trigger_name(e->trigger) << ", size " << e->size << " ("
+                          << e->trigger_at << " at the trigger; " << e->relaxations << " relaxations, " << e->placements
+                          << " stress-free placements"
+                          << (e->spanning ? "; spanning crack" : "") << ")" << std::endl;
+            }
+        }
+
+        if (tuner) tuner->phase_boundary();
+
+        if (rigidity && pruned.rigid_atoms > 0) {
+            std::cout << "   Rigidity: pinned " << pruned.floppy_atoms << " floppy atoms (" << pruned.floppy_clusters
+                      << " clusters, up to " << pruned.floppy_modes << " floppy modes), removed " << pruned.removed_bonds
+                      << " unloaded bonds; rigid cluster " << pruned.rigid_atoms << " atoms, "
+                      << pruned.redundant_bonds << " redundant bonds; " << rigidity_seconds << " s" << std::endl;
+        }
+
+        // Rigidez efetiva secante: reação da parede (já calculada pelo solver
+        // na última relaxação, sem quebras) sobre o deslocamento imposto
+        const double displacement = (step_id + 1) * strain_inc;
+        const double secant = wall_force / displacement;
+        std::cout << "   Effective stiffness: F = " << wall_force << ", F/u = " << secant
+                  << ", E_eff = " << secant * height / width;
+
+        // Resposta linear aos dois modos de carregamento num só CG em bloco
+        double tangent = 0.0;
+        if (ctx.linear_response) {
+            auto linear_start_time = std::chrono::high_resolution_clock::now();
+            const std::size_t n3 = 3 * static_cast<std::size_t>(net.num_atoms);
+            if (!stiffness) {
+                stiffness = std::make_unique<spring::StiffnessOperator<K>>(net);
+                imposed.resize(2 * n3);
+                spring::wall_displacement<spring::Tensile>(net, imposed.data());
+                spring::wall_displacement<spring::Shear>(net, imposed.data() + n3);
+                response = imposed;
+            } else {
+                stiffness->update(net);
+            }
+            spring::LinearSettings linear_settings;
+            linear_settings.pipelined = ctx.pipelined_cg;
+            // Chute inicial: a resposta do passo anterior
+            spring::LinearResult lr = relax->linear_response(*stiffness, imposed.data(), nullptr, response.data(), 2,
+                                                             linear_settings);
+            spring::Prediction tensile = spring::predict_linear<K>(net, response.data());
+            spring::Prediction shear = spring::predict_linear<K>(net, response.data() + n3);
+            // Rigidez tangente: quociente de Rayleigh U^T H U da resposta ao modo da execução
+            const std::size_t mode = (std::string(loading::name) == spring::Shear::name) ? 1 : 0;
+            tangent = stiffness->quadratic_form(response.data() + mode * n3);
+            std::cout << ", tangent " << tangent << ", E_t = " << tangent * height / width << std::endl;
+            std::chrono::duration<double> linear_duration = std::chrono::high_resolution_clock::now() - linear_start_time;
+            std::cout << "   Linear response: next break at displacement " << tensile.strain << " (tensile), "
+                      << shear.strain << " (shear); " << (ctx.pipelined_cg ? "pipelined" : "block") << " CG "
+                      << lr.nrhs << " rhs, " << lr.iterations << " iterations, ";
+            if (lr.fallbacks > 0) std::cout << "fell back to block CG, ";
+            std::cout << "residual " << lr.max_residual << ", " << linear_duration.count() << " s" << std::endl;
+        } else {
+            std::cout << std::endl;
+        }
+
+        // Tensão: força de reação na parede por unidade de largura; deformação:
+        // deslocamento da parede sobre a altura. S do passo: todas as quebras.
+        if (ctx.summary) {
+            ctx.summary->add_step(displacement / height, wall_force / width);
+            const long long step_broken = num_broken_total - broken_before_step;
+            if (step_broken > 0) ctx.summary->avalanches.push_back(static_cast<std::uint32_t>(step_broken));
+        }
+
+        auto step_end_time = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> step_duration = step_end_time - step_start_time;
+
+        std::cout << "Finished strain step " << step_id + 1 << "; cumulative broken = " << num_broken_total << std::endl;
+        std::cout << "Total time for step: " << step_duration.count() << " s\n" << std::endl;
+        phases.end();
+        phases.mark_steady();
+    }
+
+    profile.print(std::cout);
+    telemetry.print(std::cout);
+    if (runaway) runaway->print(std::cout);
+    phases.print(std::cout);
+    const std::size_t rigidity_bytes = rigidity ? rigidity->bytes() : 0;
+    const std::size_t work_bytes = relax->workspace_bytes() + escalation.workspace_bytes() + scan_out.capacity() * sizeof(int) + rigidity_bytes + coloring.bytes() +
+                                   (colored ? colored->bytes() : 0) + arena.bytes() + (runaway ? runaway->bytes() : 0);
+    spring::print_memory_report(spring::memory_report(net, work_bytes));
+}
+
+// Rede da realização r: gerada em processo ou lida dos arquivos.
+spring::Network build_network(const NativeOptions& opts, int realization) {
+    const bool implicit = opts.flag("--implicit");
+    spring::Network net;
+    if (opts.flag("--lattice")) {
+        spring::LatticeSpec spec;
+        spec.N = static_cast<std::uint32_t>(std::stoul(opts.get("--lattice", "12")));
+        spec.L_matrix = opts.flag("--layout") ? 0 : std::stoi(opts.get("--L_matrix", "4"));
+        spec.seed = std::stoull(opts.get("--seed", "1")) + static_cast<std::uint64_t>(realization);
+        spec.dilution = std::stod(opts.get("--dilution", "1"));
+        net = spring::generate_lattice_network(spec, implicit);
+    } else if (opts.flag("--delaunay")) {
+        spring::DelaunaySpec spec;
+        spec.N = static_cast<std::uint32_t>(std::stoul(opts.get("--delaunay", "12")));
+        spec.jitter = std::stod(opts.get("--jitter", "0.3"));
+        spec.dilution = std::stod(opts.get("--dilution", "1"));
+        spec.seed = std::stoull(opts.get("--seed", "1")) + static_cast<std::uint64_t>(realization);
+        net = spring::generate_delaunay_network(spec);
+    } else {
+        net = spring::load_network(opts.positional[0], opts.positional[1]);
+        if (implicit && !spring::convert_to_implicit(net)) {
+            std::cerr << "Aviso: a rede não é uma rede triangular regular; usando o modo explícito." << std::endl;
+        }
+    }
+
+    // Ordem de Hilbert para redes irregulares
+    if (!net.implicit && (opts.flag("--reorder") || opts.flag("--delaunay"))) {
+        auto reorder_start_time = std::chrono::high_resolution_clock::now();
+        spring::reorder_network(net);
+        std::chrono::duration<double> reorder_duration = std::chrono::high_resolution_clock::now() - reorder_start_time;
+        std::cout << "   time (reorder): " << reorder_duration.count() << " s" << std::endl;
+    }
+
+    // Classes do layout: dependem da conectividade de cada realização
+    // (diluição, Delaunay, caminhos das fibras), então são recalculadas
+    if (opts.flag("--layout")) {
+        auto layout_start_time = std::chrono::high_resolution_clock::now();
+        const int threads = std::stoi(opts.get("--threads", std::to_string(spring::default_threads())));
+        const std::vector<std::uint8_t> classes =
+            spring::classify_bonds(net, spring::LayoutSpec::parse(opts.get("--layout", "")), threads);
+        std::chrono::duration<double> layout_duration = std::chrono::high_resolution_clock::now() - layout_start_time;
+        std::cout << "   time (layout): " << layout_duration.count() << " s" << std::endl;
+        spring::apply_bond_classes(net, classes);
+    }
+    return net;
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "md-minimizer C++ v1.8 (motor nativo)" << std::endl;
+
+    NativeOptions opts = parse_options(argc, argv);
+    const std::size_t nfiles = (opts.flag("--lattice") || opts.flag("--delaunay")) ? 0 : 2;
+    if (opts.positional.size() < nfiles) {
+        std::cerr << "Uso: " << argv[0] << " <data_file> <thresholds_file> [total_steps] [strain_inc] [tensile|shear] [opções]\n"
+                  << "     " << argv[0] << " --lattice N [--L_matrix L] [--seed S] [total_steps] [strain_inc] [tensile|shear] [opções]\n"
+                  << "     " << argv[0] << " --delaunay N [--jitter J] [--seed S] [total_steps] [strain_inc] [tensile|shear] [opções]"
+                  << std::endl;
+        return 1;
+    }
+    const auto& pos = opts.positional;
+    int total_steps = (pos.size() > nfiles) ? std::stoi(pos[nfiles]) : 10;
+    double strain_inc = (pos.size() > nfiles + 1) ? std::stod(pos[nfiles + 1]) : 0.1;
+    spring::Loading loading = (pos.size() > nfiles + 2) ? spring::parse_loading(pos[nfiles + 2]) : spring::Loading::tensile;
+    const int realizations = std::stoi(opts.get("--realizations", "1"));
+
+    spring::Network net = build_network(opts, 0);
+    spring::print_memory_report(spring::memory_report(net, 0));
+
+    // --- Campo de limiares correlacionados (grade fixa para o ensemble) ---
+    std::unique_ptr<spring::GaussianFieldGenerator> field;
+    spring::ThresholdDistribution threshold_dist = spring::ThresholdDistribution::parse(opts.get("--threshold_dist", "uniform,0,1"));
+    std::mt19937_64 field_rng(std::stoull(opts.get("--seed", "1")) * 0x9E3779B97F4A7C15ULL + 1);
+    if (opts.flag("--correlation_length")) {
+        const double xi = std::stod(opts.get("--correlation_length", "1"));
+        // Espaçamento xi/2: o espectro exp(-k^2 xi^2 / 2) vale e^-19.7 na
+        // frequência de Nyquist, então a grade mais fina só encarece a FFT
+        // (xi = 1 na rede 768: 2048x2048 em vez de 4096x4096)
+        const double cell = std::max(net.r0 / 4.0, std::min(net.r0, xi / 2.0));
+        field = std::make_unique<spring::GaussianFieldGenerator>(net.box, xi, cell);
+        std::cout << "Info: campo gaussiano xi = " << xi << " em grade " << field->nx() << "x" << field->ny() << std::endl;
+    }
+
+    // --- Log e histogramas de avalanches ---
+    RunContext ctx;
+    ctx.reproducible = opts.flag("--reproducible");
+    ctx.subdomains = std::stoi(opts.get("--subdomains", "4"));
+    ctx.maxiter = std::stoi(opts.get("--maxiter", "1000"));
+    ctx.maxeval = std::stoi(opts.get("--maxeval", "10000"));
+    ctx.force_threads = std::stoi(opts.get("--force_threads", "1"));
+    ctx.force_bench = opts.flag("--force_bench");
+    ctx.threads = std::stoi(opts.get("--threads", std::to_string(spring::default_threads())));
+    ctx.patch_radius = std::stod(opts.get("--patch_radius", "0"));
+    ctx.runaway = std::stod(opts.get("--runaway", "0"));
+    ctx.force_bench_threads = opts.flag("--force_threads")
+        ? ctx.force_threads
+        : std::stoi(opts.get("--threads", std::to_string(spring::default_threads())));
+    ctx.linear_response = opts.flag("--linear_response");
+    const std::string linear_solver = opts.get("--linear_solver", "block");
+    if (linear_solver != "block" && linear_solver != "pipelined") {
+        throw std::runtime_error("Erro: solver linear desconhecido: " + linear_solver);
+    }
+    ctx.pipelined_cg = (linear_solver == "pipelined");
+    ctx.rigidity = opts.flag("--rigidity");
+    ctx.relax = opts.get("--relax", "cg");
+    std::unique_ptr<spring::TuningCache> tuning;
+    if (ctx.relax == "auto") {
+        tuning = std::make_unique<spring::TuningCache>(opts.get("--tuning_file", "spring_tuning.txt"));
+        ctx.tuning = tuning.get();
+    }
+    spring::LogHistogram histograms[4];
+    ctx.histograms = histograms;
+    ctx.L_matrix = opts.flag("--layout") ? 0 : std::stoi(opts.get("--L_matrix", opts.flag("--lattice") ? "4" : "0"));
+    ctx.avalanche_radius = std::stod(opts.get("--avalanche_radius", std::to_string(2.0 * net.r0)));
+    std::ofstream avalanche_log;
+    if (opts.flag("--avalanche_log")) {
+        avalanche_log.open(opts.get("--avalanche_log", ""));
+        if (!avalanche_log) throw std::runtime_error("Erro: não foi possível abrir " + opts.get("--avalanche_log", ""));
+        spring::AvalancheForest::write_header(avalanche_log);
+        ctx.avalanche_log = &avalanche_log;
+    }
+
+    spring::EnsembleAggregator ensemble;
+
+    // --- Seleção dos Kernels (uma única vez) ---
+    spring::KernelConfig kernel_config;
+    for (int d = 0; d < 3; ++d) kernel_config.periodic[d] = net.periodic[d];
+    kernel_config.dimension = net.dimension;
+    kernel_config.loading = loading;
+
+    spring::dispatch_kernels(kernel_config, [&](auto kernels) {
+        for (int r = 0; r < realizations; ++r) {
+            if (realizations > 1) std::cout << "=== Realization " << r + 1 << "/" << realizations << " ===" << std::endl;
+            if (r > 0) net = build_network(opts, r);
+            if (field) {
+                auto field_start_time = std::chrono::high_resolution_clock::now();
+                field->next(field_rng);
+                spring::apply_threshold_field(net, *field, threshold_dist);
+                std::chrono::duration<double> field_duration = std::chrono::high_resolution_clock::now() - field_start_time;
+                std::cout << "   time (threshold field): " << field_duration.count() << " s" << std::endl;
+            }
+            ctx.realization = r;
+            spring::RealizationSummary summary;
+            ctx.summary = &summary;
+            run_simulation<decltype(kernels)>(net, total_steps, strain_inc, ctx);
+            ensemble.add(std::move(summary));
+        }
+    });
+
+    // --- Relatório do ensemble (bootstrap) ---
+    if (realizations > 1 || opts.flag("--report")) {
+        auto report_start_time = std::chrono::high_resolution_clock::now();
+        spring::BootstrapSettings boot;
+        boot.resamples = std::stoi(opts.get("--bootstrap", "1000"));
+        boot.confidence = std::stod(opts.get("--confidence", "0.95"));
+        boot.seed = std::stoull(opts.get("--seed", "1"));
+        boot.threads = std::stoi(opts.get("--threads", std::to_string(spring::default_threads())));
+        std::ofstream report_file;
+        if (opts.flag("--report")) report_file.open(opts.get("--report", ""));
+        ensemble.report(report_file.is_open() ? report_file : std::cout, boot);
+        std::chrono::duration<double> report_duration = std::chrono::high_resolution_clock::now() - report_start_time;
+        std::cout << "   time (bootstrap): " << report_duration.count() << " s (" << ensemble.size()
+                  << " realizations, " << ensemble.bytes() / 1024.0 << " KiB of summaries)" << std::endl;
+    }
+
+    // Histogramas do ensemble
+    std::ofstream hist_file;
+    if (opts.flag("--avalanche_hist")) hist_file.open(opts.get("--avalanche_hist", ""));
+    std::ostream& hist_out = hist_file.is_open() ? hist_file : std::cout;
+    hist_out << "quantity,bin_lo,bin_hi,count\n";
+    const char* hist_names[4] = {"size", "extent", "gyration", "cells"};
+    for (int h = 0; h < 4; ++h) histograms[h].write(hist_out, hist_names[h]);
+
+    std::cout << "Simulação finalizada." << std::endl;
+    return 0;
+}
@@ -0,0 +1,201 @@
+// network.cpp
+//
+// Leitura do arquivo de dados do LAMMPS para o layout compacto de network.h.
+
+#include "network.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace spring {
+
+std::size_t BondMask::count() const {
+    std::size_t total = 0;
+    for (std::uint64_t w : words_) total += static_cast<std::size_t>(__builtin_popcountll(w));
+    return total;
+}
+
+namespace {
+
+bool starts_with(const std::string& line, const char* prefix) {
+    return line.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+bool is_blank(const std::string& line) {
+    return line.find_first_not_of(" \t\r") == std::string::npos;
+}
+
+// Limiares indexados pelo tipo de ligação (os tipos são densos: 2..ntypes)
+std::vector<double> read_thresholds_by_type(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Erro: Não foi possível abrir o arquivo de limiares: " + filename);
+    }
+    std::vector<double> by_type;
+    std::string line;
+    int count = 0;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        int bond_type;
+        double break_len;
+        if (sscanf(line.c_str(), "%d %lf", &bond_type, &break_len) == 2 && bond_type >= 0) {
+            if (static_cast<std::size_t>(bond_type) >= by_type.size()) {
+                by_type.resize(bond_type + 1, std::numeric_limits<double>::infinity());
+            }
+            by_type[bond_type] = break_len;
+            ++count;
+        }
+    }
+    if (count == 0) {
+        throw std::runtime_error("Nenhum limiar válido encontrado em " + filename);
+    }
+    std::cout << "Info: Limiares de quebra lidos para " << count << " tipos de ligação." << std::endl;
+    return by_type;
+}
+
+}  // namespace
+
+Network load_network(const std::string& data_file, const std::string& thresholds_file) {
+    std::ifstream file(data_file);
+    if (!file.is_open()) {
+        throw std::runtime_error("Erro: Não foi possível abrir o arquivo de dados: " + data_file);
+    }
+
+    Network net;
+    double boxlo[3] = {0.0, 0.0, -1.0}, boxhi[3] = {0.0, 0.0, 1.0};
+    long long natoms = -1, nbonds = -1;
+    bool have_coeff = false;
+
+    std::string line;
+    std::getline(file, line);  // título
+    std::string section;
+    std::vector<std::uint32_t> id_to_index;
+    std::vector<std::uint32_t> bond_types;  // temporário, até a leitura dos limiares
+
+    while (std::getline(file, line)) {
+        if (is_blank(line)) continue;
+        std::istringstream in(line);
+
+        // --- Cabeçalho e títulos de seção ---
+        if (line.find(" atoms") != std::string::npos && section.empty() && line.find("types") == std::string::npos) {
+            in >> natoms;
+            continue;
+        }
+        if (line.find(" bonds") != std::string::npos && section.empty() && line.find("types") == std::string::npos) {
+            in >> nbonds;
+            continue;
+        }
+        if (line.find("xlo xhi") != std::string::npos) { in >> boxlo[0] >> boxhi[0]; continue; }
+        if (line.find("ylo yhi") != std::string::npos) { in >> boxlo[1] >> boxhi[1]; continue; }
+        if (line.find("zlo zhi") != std::string::npos) { in >> boxlo[2] >> boxhi[2]; continue; }
+        if (line.find("types") != std::string::npos && section.empty()) continue;
+
+        if (starts_with(line, "Masses") || starts_with(line, "Bond Coeffs") ||
+            starts_with(line, "Atoms") || starts_with(line, "Bonds")) {
+            section = line.substr(0, line.find_first_of("#"));
+            while (!section.empty() && std::isspace(static_cast<unsigned char>(section.back()))) section.pop_back();
+            if (section == "Atoms") {
+                if (natoms < 0 || natoms > std::numeric_limits<std::uint32_t>::max()) {
+                    throw std::runtime_error("Erro: número de átomos inválido em " + data_file);
+                }
+                net.num_atoms = static_cast<std::uint32_t>(natoms);
+                net.x.assign(3 * static_cast<std::size_t>(natoms), 0.0);
+                net.atom_type.assign(natoms, atom_mobile);
+                id_to_index.assign(natoms + 1, std::numeric_limits<std::uint32_t>::max());
+            } else if (section == "Bonds") {
+                if (nbonds < 0 || nbonds > std::numeric_limits<std::int32_t>::max()) {
+                    throw std::runtime_error("Erro: número de ligações inválido em " + data_file);
+                }
+                net.num_bonds = static_cast<std::uint32_t>(nbonds);
+                net.bond_atom1.reserve(nbonds);
+                net.bond_atom2.reserve(nbonds);
+                bond_types.reserve(nbonds);
+            }
+            continue;
+        }
+
+        // --- Linhas de dados ---
+        if (section == "Bond Coeffs") {
+            int type;
+            double k, r0;
+            in >> type >> k >> r0;
+            if (!have_coeff) {
+                net.k = k;
+                net.r0 = r0;
+                have_coeff = true;
+            } else if (k != net.k || r0 != net.r0) {
+                throw std::runtime_error("Erro: o layout compacto exige Bond Coeffs iguais para todos os tipos");
+            }
+        } else if (section == "Atoms") {
+            long long id, mol;
+            int type;
+            double px, py, pz;
+            in >> id >> mol >> type >> px >> py >> pz;
+            std::uint32_t index = static_cast<std::uint32_t>(id - 1);
+            if (id < 1 || id > natoms) {
+                throw std::runtime_error("Erro: IDs de átomo devem ser 1..N em " + data_file);
+            }
+            id_to_index[id] = index;
+            net.x[3 * index] = px;
+            net.x[3 * index + 1] = py;
+            net.x[3 * index + 2] = pz;
+            net.atom_type[index] = static_cast<std::uint8_t>(type);
+        } else if (section == "Bonds") {
+            long long id, a1, a2;
+            int type;
+            in >> id >> type >> a1 >> a2;
+            net.bond_atom1.push_back(id_to_index.at(a1));
+            net.bond_atom2.push_back(id_to_index.at(a2));
+            bond_types.push_back(static_cast<std::uint32_t>(type));
+        }
+    }
+
+    if (net.bond_atom1.size() != net.num_bonds) {
+        throw std::runtime_error("Erro: número de ligações lido difere do cabeçalho em " + data_file);
+    }
+
+    // Converte tipo -> limiar ao quadrado (float32). Tipo 1 é inquebrável.
+    std::vector<double> thresholds = read_thresholds_by_type(thresholds_file);
+    net.break_len_sq.resize(net.num_bonds);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::size_t type = bond_types[b];
+        double len = (type > 1 && type < thresholds.size()) ? thresholds[type] : std::numeric_limits<double>::infinity();
+        net.break_len_sq[b] = static_cast<float>(len * len);
+    }
+    net.alive.assign(net.num_bonds, true);
+    net.num_physical_bonds = net.num_bonds;
+
+    net.box = Box::from_bounds(boxlo, boxhi);
+    std::cout << "Info: Rede nativa com " << net.num_atoms << " átomos e " << net.num_bonds << " ligações." << std::endl;
+    return net;
+}
+
+MemoryReport memory_report(const Network& net, std::size_t work_bytes) {
+    MemoryReport report;
+    report.num_bonds = net.num_physical_bonds;
+    report.bond_bytes = net.bond_atom1.capacity() * sizeof(std::uint32_t) +
+                        net.bond_atom2.capacity() * sizeof(std::uint32_t) +
+                        net.break_len_sq.capacity() * sizeof(float) + net.rest_len.capacity() * sizeof(float) +
+                        net.alive.bytes();
+    report.atom_bytes = net.x.capacity() * sizeof(double) + net.atom_type.capacity() * sizeof(std::uint8_t);
+    report.work_bytes = work_bytes;
+    return report;
+}
+
+void print_memory_report(const MemoryReport& report) {
+    // Formata num stream local: o formato fixo não vaza para o std::cout
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2)
+         << "Info: memória por ligação: " << report.bond_bytes_per_bond() << " B (ligações), "
+         << report.total_bytes_per_bond() << " B (total com átomos e buffers); "
+         << (report.bond_bytes + report.atom_bytes + report.work_bytes) / (1024.0 * 1024.0) << " MiB";
+    std::cout << line.str() << std::endl;
+}
+
+}  // namespace spring
@@ -0,0 +1,146 @@
+// network.h
+//
+// Layout compacto do estado do motor nativo para redes grandes.
+//
+// Por ligação são guardados apenas:
+// - dois índices de átomo de 32 bits (sem tagint);
+// - o limiar de quebra como float32, já ao quadrado (a varredura compara
+//   comprimentos ao quadrado e dispensa sqrt);
+// - um bit de ligação ativa.
+// Ligações inquebráveis e ligações já quebradas têm limiar +inf, de modo que
+// a varredura não precisa consultar o bitset. As constantes da mola são
+// globais (todas as redes geradas usam `1.0 1.0` em Bond Coeffs).
+//
+// No modo implícito (redes triangulares regulares) nem os índices são
+// guardados: a ligação é o slot (direção, nó) de lattice.h e restam apenas
+// limiares e bitset, ~4.1 B por ligação. Redes fora da rede triangular
+// (Delaunay) guardam também o comprimento de repouso em float32.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "kernels.h"
+#include "lattice.h"
+
+namespace spring {
+
+// --- Bitset de ligações ativas ---
+class BondMask {
+public:
+    void assign(std::size_t n, bool value) {
+        size_ = n;
+        words_.assign((n + 63) / 64, value ? ~std::uint64_t(0) : 0);
+        if (value && (n % 64) != 0) words_.back() = (std::uint64_t(1) << (n % 64)) - 1;
+    }
+    bool test(std::size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1u; }
+    void set(std::size_t i) { words_[i >> 6] |= std::uint64_t(1) << (i & 63); }
+    void reset(std::size_t i) { words_[i >> 6] &= ~(std::uint64_t(1) << (i & 63)); }
+    std::size_t count() const;
+    std::size_t size() const { return size_; }
+    const std::uint64_t* words() const { return words_.data(); }
+    std::size_t bytes() const { return words_.size() * sizeof(std::uint64_t); }
+
+private:
+    std::size_t size_ = 0;
+    std::vector<std::uint64_t> words_;
+};
+
+// Tipos de átomo, como em create_network.py / in.config. `atom_floppy` só
+// existe no motor nativo: átomo móvel fora do cluster rígido do chão, fixado
+// pela análise de rigidez (rigidity.h).
+enum AtomType : std::uint8_t { atom_mobile = 1, atom_bottom = 2, atom_top = 3, atom_floppy = 4 };
+
+struct Network {
+    // Per-atom data (posições com passo 3, como atom->x do LAMMPS)
+    std::uint32_t num_atoms = 0;
+    std::vector<double> x;
+    std::vector<std::uint8_t> atom_type;
+
+    // Per-bond data. No modo implícito, num_bonds conta slots (3*N*N) e
+    // bond_atom1/bond_atom2 ficam vazios.
+    std::uint32_t num_bonds = 0;
+    std::uint32_t num_physical_bonds = 0;
+    bool implicit = false;
+    TriangularLattice lattice;
+    std::vector<std::uint32_t> bond_atom1;
+    std::vector<std::uint32_t> bond_atom2;
+    std::vector<float> break_len_sq;
+    std::vector<float> rest_len;  // vazio: todas as ligações com r0
+    BondMask alive;
+
+    double k = 1.0;
+    double r0 = 1.0;
+    Box box;
+    bool periodic[3] = {true, false, true};
+    int dimension = 2;
+
+    bool breakable(std::uint32_t b) const {
+        return break_len_sq[b] != std::numeric_limits<float>::infinity();
+    }
+    void break_bond(std::uint32_t b) {
+        alive.reset(b);
+        break_len_sq[b] = std::numeric_limits<float>::infinity();
+    }
+
+    bool endpoints(std::uint32_t b, std::uint32_t& a1, std::uint32_t& a2) const {
+        if (implicit) return lattice.endpoints(b, a1, a2);
+        a1 = bond_atom1[b];
+        a2 = bond_atom2[b];
+        return true;
+    }
+
+    BasicScanBonds<std::uint32_t, float> scan_view() const {
+        return {static_cast<int>(num_bonds), bond_atom1.data(), bond_atom2.data(), break_len_sq.data()};
+    }
+    BasicForceBonds<std::uint32_t> force_view() const {
+        return {static_cast<int>(num_bonds), bond_atom1.data(), bond_atom2.data(), alive.words(), k, r0};
+    }
+    VariableForceBonds<std::uint32_t> variable_force_view() const {
+        VariableForceBonds<std::uint32_t> view;
+        static_cast<BasicForceBonds<std::uint32_t>&>(view) = force_view();
+        view.rest_len = rest_len.data();
+        return view;
+    }
+};
+
+// --- Kernels sobre a rede inteira ---
+// Escolhem uma vez por chamada entre o caminho explícito e o implícito.
+template <class K>
+int scan_network(const Network& net, int* out) {
+    if (net.implicit) return LatticeKernels<K>::scan(net.lattice, net.x.data(), net.break_len_sq.data(), net.box, out);
+    return K::scan(net.x.data(), net.scan_view(), net.box, out);
+}
+
+template <class K>
+double network_forces(const Network& net, const double* x, double* f) {
+    if (net.implicit) return LatticeKernels<K>::forces(net.lattice, x, net.alive.words(), net.k, net.r0, net.box, f);
+    if (!net.rest_len.empty()) return K::forces(x, net.variable_force_view(), net.box, f);
+    return K::forces(x, net.force_view(), net.box, f);
+}
+
+// Lê o arquivo de dados do LAMMPS gerado por create_network.py e o arquivo
+// de limiares de quebra.
+Network load_network(const std::string& data_file, const std::string& thresholds_file);
+
+// --- Relatório de memória ---
+struct MemoryReport {
+    std::size_t bond_bytes = 0;   // conectividade + limiares + bitset
+    std::size_t atom_bytes = 0;   // posições + tipos
+    std::size_t work_bytes = 0;   // buffers do relaxador e da varredura
+    std::uint32_t num_bonds = 0;
+
+    double bond_bytes_per_bond() const { return num_bonds ? double(bond_bytes) / num_bonds : 0.0; }
+    double total_bytes_per_bond() const {
+        return num_bonds ? double(bond_bytes + atom_bytes + work_bytes) / num_bonds : 0.0;
+    }
+};
+
+MemoryReport memory_report(const Network& net, std::size_t work_bytes);
+void print_memory_report(const MemoryReport& report);
+
+}  // namespace spring
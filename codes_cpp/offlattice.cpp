@@ -0,0 +1,315 @@
+// offlattice.cpp
+
+#include "offlattice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+#include "graph.h"
+
+namespace spring {
+
+namespace {
+
+// Triângulo em sentido anti-horário; nbr[i] é o vizinho oposto a v[i]
+struct Triangle {
+    std::uint32_t v[3];
+    std::int32_t nbr[3];
+    bool alive;
+};
+
+class Triangulator {
+public:
+    Triangulator(const std::vector<double>& px, const std::vector<double>& py) : px_(px), py_(py) {
+        // Supertriângulo contendo todos os pontos (vértices n, n+1, n+2)
+        const std::size_t n = px.size();
+        double xmin = px[0], xmax = px[0], ymin = py[0], ymax = py[0];
+        for (std::size_t i = 1; i < n; ++i) {
+            xmin = std::min(xmin, px[i]);
+            xmax = std::max(xmax, px[i]);
+            ymin = std::min(ymin, py[i]);
+            ymax = std::max(ymax, py[i]);
+        }
+        const double span = std::max(xmax - xmin, ymax - ymin) + 1.0;
+        const double cx = 0.5 * (xmin + xmax), cy = 0.5 * (ymin + ymax);
+        px_.push_back(cx - 20.0 * span);
+        py_.push_back(cy - 10.0 * span);
+        px_.push_back(cx + 20.0 * span);
+        py_.push_back(cy - 10.0 * span);
+        px_.push_back(cx);
+        py_.push_back(cy + 20.0 * span);
+        const std::uint32_t s = static_cast<std::uint32_t>(n);
+        tris_.push_back({{s, s + 1, s + 2}, {-1, -1, -1}, true});
+        tris_.reserve(2 * n + 8);
+    }
+
+    void insert(std::uint32_t p) {
+        const std::int32_t start = locate(p);
+
+        // Cavidade: triângulos cujo circuncírculo contém p (conexa a partir de start)
+        cavity_.clear();
+        cavity_.push_back(start);
+        tris_[start].alive = false;
+        for (std::size_t c = 0; c < cavity_.size(); ++c) {
+            const Triangle& t = tris_[cavity_[c]];
+            for (int e = 0; e < 3; ++e) {
+                const std::int32_t nb = t.nbr[e];
+                if (nb >= 0 && tris_[nb].alive && in_circle(tris_[nb], p)) {
+                    tris_[nb].alive = false;
+                    cavity_.push_back(nb);
+                }
+            }
+        }
+
+        // Arestas da fronteira da cavidade -> novos triângulos (p, a, b)
+        created_.clear();
+        for (std::int32_t c : cavity_) {
+            for (int e = 0; e < 3; ++e) {
+                const Triangle t = tris_[c];
+                const std::int32_t outer = t.nbr[e];
+                if (outer >= 0 && !tris_[outer].alive && is_in_cavity(outer)) continue;
+                const std::uint32_t a = t.v[(e + 1) % 3], b = t.v[(e + 2) % 3];
+                const std::int32_t id = new_triangle({{p, a, b}, {outer, -1, -1}, true});
+                if (outer >= 0) {
+                    Triangle& o = tris_[outer];
+                    for (int k = 0; k < 3; ++k) {
+                        if (o.nbr[k] == c) o.nbr[k] = id;
+                    }
+                }
+                created_.push_back(id);
+            }
+        }
+        // Vizinhança entre os novos triângulos (leque em torno de p)
+        for (std::int32_t t : created_) {
+            for (std::int32_t u : created_) {
+                if (tris_[u].v[1] == tris_[t].v[2]) tris_[t].nbr[1] = u;  // aresta (b, p)
+                if (tris_[u].v[2] == tris_[t].v[1]) tris_[t].nbr[2] = u;  // aresta (p, a)
+            }
+        }
+        for (std::int32_t c : cavity_) free_.push_back(c);
+        last_ = created_.front();
+    }
+
+    std::vector<std::array<std::uint32_t, 2>> edges(std::uint32_t num_points) const {
+        std::vector<std::array<std::uint32_t, 2>> out;
+        for (std::size_t t = 0; t < tris_.size(); ++t) {
+            const Triangle& tri = tris_[t];
+            if (!tri.alive) continue;
+            for (int e = 0; e < 3; ++e) {
+                // cada aresta interna aparece em dois triângulos: fica a do menor índice
+                const std::int32_t nb = tri.nbr[e];
+                if (nb >= 0 && static_cast<std::size_t>(nb) < t) continue;
+                std::uint32_t a = tri.v[(e + 1) % 3], b = tri.v[(e + 2) % 3];
+                if (a >= num_points || b >= num_points) continue;
+                if (b < a) std::swap(a, b);
+                out.push_back({a, b});
+            }
+        }
+        return out;
+    }
+
+private:
+    double orient(std::uint32_t a, std::uint32_t b, std::uint32_t c) const {
+        return (px_[b] - px_[a]) * (py_[c] - py_[a]) - (py_[b] - py_[a]) * (px_[c] - px_[a]);
+    }
+
+    bool in_circle(const Triangle& t, std::uint32_t p) const {
+        const double adx = px_[t.v[0]] - px_[p], ady = py_[t.v[0]] - py_[p];
+        const double bdx = px_[t.v[1]] - px_[p], bdy = py_[t.v[1]] - py_[p];
+        const double cdx = px_[t.v[2]] - px_[p], cdy = py_[t.v[2]] - py_[p];
+        const double det = (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy) -
+                           (bdx * bdx + bdy * bdy) * (adx * cdy - cdx * ady) +
+                           (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+        return det > 0.0;
+    }
+
+    // Caminhada de visibilidade a partir do último triângulo criado
+    std::int32_t locate(std::uint32_t p) const {
+        std::int32_t t = last_;
+        for (std::size_t steps = 0; steps < 4 * tris_.size() + 16; ++steps) {
+            const Triangle& tri = tris_[t];
+            int exit = -1;
+            for (int e = 0; e < 3 && exit < 0; ++e) {
+                if (tri.nbr[e] >= 0 && orient(tri.v[(e + 1) % 3], tri.v[(e + 2) % 3], p) < 0.0) exit = e;
+            }
+            if (exit < 0) return t;
+            t = tri.nbr[exit];
+        }
+        throw std::runtime_error("Erro: falha na localização do ponto na triangulação");
+    }
+
+    bool is_in_cavity(std::int32_t t) const {
+        return std::find(cavity_.begin(), cavity_.end(), t) != cavity_.end();
+    }
+
+    std::int32_t new_triangle(const Triangle& t) {
+        if (!free_.empty()) {
+            const std::int32_t id = free_.back();
+            free_.pop_back();
+            tris_[id] = t;
+            return id;
+        }
+        tris_.push_back(t);
+        return static_cast<std::int32_t>(tris_.size() - 1);
+    }
+
+    std::vector<double> px_, py_;
+    std::vector<Triangle> tris_;
+    std::vector<std::int32_t> cavity_, created_, free_;
+    std::int32_t last_ = 0;
+};
+
+}  // namespace
+
+std::vector<std::array<std::uint32_t, 2>> delaunay_edges(const std::vector<double>& px,
+                                                         const std::vector<double>& py) {
+    const std::uint32_t n = static_cast<std::uint32_t>(px.size());
+    if (n < 3) return {};
+
+    // Ordem de inserção de Hilbert sobre a caixa envolvente
+    double lo[3] = {px[0], py[0], 0.0}, hi[3] = {px[0], py[0], 1.0};
+    for (std::uint32_t i = 1; i < n; ++i) {
+        lo[0] = std::min(lo[0], px[i]);
+        hi[0] = std::max(hi[0], px[i]);
+        lo[1] = std::min(lo[1], py[i]);
+        hi[1] = std::max(hi[1], py[i]);
+    }
+    const Box bounds = Box::from_bounds(lo, hi);
+    std::vector<std::uint64_t> key(n);
+    for (std::uint32_t i = 0; i < n; ++i) key[i] = hilbert_index(px[i], py[i], bounds);
+    std::vector<std::uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return key[a] < key[b]; });
+
+    Triangulator tri(px, py);
+    for (std::uint32_t p : order) tri.insert(p);
+    return tri.edges(n);
+}
+
+Network generate_delaunay_network(const DelaunaySpec& spec) {
+    if (spec.N < 3) {
+        throw std::runtime_error("Erro: a rede de Delaunay exige N >= 3");
+    }
+    const bool poisson = spec.jitter < 0.0;
+    std::cout << "Info: Gerando rede de Delaunay " << spec.N << "x" << spec.N << " (";
+    if (poisson) std::cout << "Poisson";
+    else std::cout << "jitter " << spec.jitter;
+    std::cout << ", seed " << spec.seed << ", p = " << spec.dilution << ")" << std::endl;
+
+    const std::uint32_t N = spec.N;
+    const double width = N * spec.l0;
+    const double row = spec.l0 * std::sqrt(3.0) / 2.0;
+    const double height = (N - 1) * row;
+    std::mt19937_64 rng(spec.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // --- Pontos: fundo e topo regulares, interior perturbado ou de Poisson ---
+    std::vector<double> px, py;
+    std::vector<std::uint8_t> type;
+    auto add_point = [&](double x, double y, std::uint8_t t) {
+        x -= width * std::floor(x / width);
+        px.push_back(x);
+        py.push_back(y);
+        type.push_back(t);
+    };
+    for (std::uint32_t i = 0; i < N; ++i) add_point(i * spec.l0, 0.0, atom_bottom);
+    for (std::uint32_t i = 0; i < N; ++i) add_point((i + 0.5 * ((N - 1) % 2)) * spec.l0, height, atom_top);
+    if (poisson) {
+        // mesma densidade da rede triangular, afastados das linhas fixas
+        for (std::uint32_t k = 0; k < N * (N - 2); ++k) {
+            const double x = width * uniform(rng);
+            const double y = row * 0.5 + (height - row) * uniform(rng);
+            add_point(x, y, atom_mobile);
+        }
+    } else {
+        for (std::uint32_t j = 1; j + 1 < N; ++j) {
+            for (std::uint32_t i = 0; i < N; ++i) {
+                const double dx = spec.jitter * spec.l0 * (uniform(rng) - 0.5);
+                const double dy = spec.jitter * row * (uniform(rng) - 0.5);
+                add_point((i + 0.5 * (j % 2)) * spec.l0 + dx, j * row + dy, atom_mobile);
+            }
+        }
+    }
+    const std::uint32_t num_points = static_cast<std::uint32_t>(px.size());
+
+    // --- Imagens periódicas em x numa faixa de cada borda ---
+    const double margin = std::min(0.5 * width, 6.0 * spec.l0);
+    std::vector<double> tx = px, ty = py;
+    std::vector<std::uint32_t> original(num_points);
+    std::iota(original.begin(), original.end(), 0u);
+    for (std::uint32_t i = 0; i < num_points; ++i) {
+        if (px[i] < margin) {
+            tx.push_back(px[i] + width);
+            ty.push_back(py[i]);
+            original.push_back(i);
+        }
+        if (px[i] >= width - margin) {
+            tx.push_back(px[i] - width);
+            ty.push_back(py[i]);
+            original.push_back(i);
+        }
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::vector<std::array<std::uint32_t, 2>> edges = delaunay_edges(tx, ty);
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    // Arestas com ao menos um ponto original, nos índices originais
+    std::vector<std::array<std::uint32_t, 2>> bonds;
+    bonds.reserve(edges.size());
+    for (const auto& e : edges) {
+        if (e[0] >= num_points && e[1] >= num_points) continue;
+        std::uint32_t a = original[e[0]], b = original[e[1]];
+        if (a == b) continue;
+        if (b < a) std::swap(a, b);
+        bonds.push_back({a, b});
+    }
+    std::sort(bonds.begin(), bonds.end());
+    bonds.erase(std::unique(bonds.begin(), bonds.end()), bonds.end());
+
+    // --- Rede ---
+    Network net;
+    net.num_atoms = num_points;
+    net.x.assign(3 * static_cast<std::size_t>(num_points), 0.0);
+    for (std::uint32_t i = 0; i < num_points; ++i) {
+        net.x[3 * i] = px[i];
+        net.x[3 * i + 1] = py[i];
+    }
+    net.atom_type = std::move(type);
+    const double boxlo[3] = {0.0, -1.0, -1.0};
+    const double boxhi[3] = {width, height + 1.0, 1.0};
+    net.box = Box::from_bounds(boxlo, boxhi);
+    net.r0 = spec.l0;
+
+    std::mt19937_64 dilution_rng(spec.seed ^ 0xD1B54A32D192ED03ULL);
+    net.bond_atom1.reserve(bonds.size());
+    net.bond_atom2.reserve(bonds.size());
+    net.break_len_sq.reserve(bonds.size());
+    net.rest_len.reserve(bonds.size());
+    for (const auto& e : bonds) {
+        if (spec.dilution < 1.0 && uniform(dilution_rng) >= spec.dilution) continue;
+        double dx = px[e[1]] - px[e[0]];
+        dx -= width * std::nearbyint(dx / width);
+        const double dy = py[e[1]] - py[e[0]];
+        const double rest = std::sqrt(dx * dx + dy * dy);
+        const double len = rest * (1.0 + uniform(rng));
+        net.bond_atom1.push_back(e[0]);
+        net.bond_atom2.push_back(e[1]);
+        net.rest_len.push_back(static_cast<float>(rest));
+        net.break_len_sq.push_back(static_cast<float>(len * len));
+    }
+    net.num_bonds = net.num_physical_bonds = static_cast<std::uint32_t>(net.bond_atom1.size());
+    net.alive.assign(net.num_bonds, true);
+
+    std::cout << "Info: Rede gerada com " << net.num_atoms << " átomos e " << net.num_physical_bonds
+              << " ligações (Delaunay em " << duration.count() << " s, grau médio "
+              << 2.0 * net.num_physical_bonds / net.num_atoms << ")." << std::endl;
+    return net;
+}
+
+}  // namespace spring
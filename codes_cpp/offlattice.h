@@ -0,0 +1,44 @@
+// offlattice.h
+//
+// Redes fora da rede triangular: pontos aleatórios triangulados por Delaunay.
+//
+// Os pontos internos são uma rede triangular perturbada (jitter em unidades
+// de l0) ou, com jitter < 0, um processo de Poisson com a mesma densidade.
+// As linhas do fundo e do topo são regulares (espaçamento l0) e recebem os
+// tipos 2 e 3, como em create_network.py. A triangulação é incremental
+// (Bowyer-Watson) com localização por caminhada a partir do último triângulo
+// criado; os pontos são inseridos na ordem de Hilbert, o que mantém a
+// caminhada curta e o custo quase linear.
+//
+// A periodicidade em x é obtida triangulando também imagens dos pontos numa
+// faixa de largura `margin` além de cada borda; das arestas resultantes
+// ficam as que tocam ao menos um ponto original, levadas aos índices
+// originais e sem duplicatas. Cada ligação guarda o seu comprimento de
+// repouso (o da configuração inicial, sem tensão) e o limiar
+// rest * (1 + U(0, 1)), análogo ao da rede triangular.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "network.h"
+
+namespace spring {
+
+struct DelaunaySpec {
+    std::uint32_t N = 12;     // largura e número de linhas, como na rede triangular
+    double jitter = 0.3;      // < 0: pontos de Poisson
+    double dilution = 1.0;    // probabilidade de cada ligação existir
+    std::uint64_t seed = 1;
+    double l0 = 1.0;
+};
+
+// Arestas da triangulação de Delaunay dos pontos (px, py), com i < j.
+std::vector<std::array<std::uint32_t, 2>> delaunay_edges(const std::vector<double>& px,
+                                                         const std::vector<double>& py);
+
+Network generate_delaunay_network(const DelaunaySpec& spec);
+
+}  // namespace spring
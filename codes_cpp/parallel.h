@@ -0,0 +1,139 @@
+// parallel.h
+//
+// Laço paralelo mínimo sobre std::thread, para as etapas de preparação
+// (geração de layouts, etc.) que não justificam uma dependência de OpenMP.
+// `WorkerPool` mantém threads vivas para laços chamados a cada avaliação de
+// forças (coloring.h), onde criar e juntar threads custaria mais que o
+// próprio laço; `Barrier` sincroniza as fases de um mesmo laço (classes de
+// cor).
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace spring {
+
+inline int default_threads() {
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw ? static_cast<int>(hw) : 1;
+}
+
+// Divide [0, n) em `threads` blocos contíguos e chama fn(begin, end, tid).
+// Com um único bloco a chamada é feita na própria thread.
+template <class Fn>
+void parallel_for(std::size_t n, int threads, Fn&& fn) {
+    threads = std::max(1, std::min<int>(threads, static_cast<int>(std::max<std::size_t>(n, 1))));
+    if (threads == 1) {
+        fn(std::size_t(0), n, 0);
+        return;
+    }
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    const std::size_t chunk = (n + threads - 1) / threads;
+    for (int t = 0; t < threads; ++t) {
+        const std::size_t begin = std::min(n, t * chunk);
+        const std::size_t end = std::min(n, begin + chunk);
+        pool.emplace_back([&fn, begin, end, t] { fn(begin, end, t); });
+    }
+    for (auto& th : pool) th.join();
+}
+
+// Threads persistentes: run(fn) chama fn(tid) para tid = 0..size()-1 e
+// espera todas. A thread que chama faz o tid 0; as demais são criadas no
+// construtor e só acordam a cada run(), sem alocar.
+class WorkerPool {
+public:
+    explicit WorkerPool(int threads) : threads_(std::max(1, threads)) {
+        workers_.reserve(threads_ - 1);
+        for (int t = 1; t < threads_; ++t) workers_.emplace_back([this, t] { work(t); });
+    }
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (auto& th : workers_) th.join();
+    }
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int size() const { return threads_; }
+
+    template <class Fn>
+    void run(Fn& fn) {
+        if (threads_ == 1) {
+            fn(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = [](void* arg, int tid) { (*static_cast<Fn*>(arg))(tid); };
+            arg_ = &fn;
+            pending_ = threads_ - 1;
+            ++generation_;
+        }
+        start_.notify_all();
+        fn(0);
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return pending_ == 0; });
+    }
+
+private:
+    void work(int tid) {
+        unsigned long seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+            void (*task)(void*, int) = task_;
+            void* arg = arg_;
+            lock.unlock();
+            task(arg, tid);
+            lock.lock();
+            if (--pending_ == 0) done_.notify_one();
+        }
+    }
+
+    int threads_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_, done_;
+    void (*task_)(void*, int) = nullptr;
+    void* arg_ = nullptr;
+    int pending_ = 0;
+    unsigned long generation_ = 0;
+    bool stop_ = false;
+};
+
+// Barreira reutilizável para `count` threads (std::barrier é C++20)
+class Barrier {
+public:
+    explicit Barrier(int count) : count_(count), waiting_(0) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const unsigned long generation = generation_;
+        if (++waiting_ == count_) {
+            waiting_ = 0;
+            ++generation_;
+            cv_.notify_all();
+            return;
+        }
+        cv_.wait(lock, [&] { return generation != generation_; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int count_, waiting_;
+    unsigned long generation_ = 0;
+};
+
+}  // namespace spring
@@ -0,0 +1,218 @@
+// patches.cpp
+
+#include "patches.h"
+
+#include <cmath>
+
+namespace spring {
+
+namespace {
+
+constexpr std::uint32_t kNone = 0xFFFFFFFFu;
+
+double min_image(const Network& net, int axis, double d) {
+    if (!net.periodic[axis] || net.box.period[axis] <= 0.0) return d;
+    return d - net.box.period[axis] * std::nearbyint(d * net.box.inv_period[axis]);
+}
+
+std::uint32_t find(ArenaVector<std::uint32_t>& parent, std::uint32_t i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+}  // namespace
+
+void PatchAvalanche::index_bonds(const Network& net) {
+    const std::uint32_t n = net.num_atoms;
+    offset_.assign(n + 1, 0);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.endpoints(b, a1, a2)) continue;
+        ++offset_[a1 + 1];
+        ++offset_[a2 + 1];
+    }
+    for (std::uint32_t i = 0; i < n; ++i) offset_[i + 1] += offset_[i];
+    incident_.resize(offset_[n]);
+    std::vector<std::uint32_t> fill(offset_.begin(), offset_.end() - 1);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.endpoints(b, a1, a2)) continue;
+        incident_[fill[a1]++] = b;
+        incident_[fill[a2]++] = b;
+    }
+    owner_.assign(n, kNone);
+    local_.assign(n, kNone);
+    visit_.assign(n, 0);
+    stamp_ = 0;
+}
+
+std::size_t PatchAvalanche::build(const Network& net, const int* seeds, int count, Arena& arena) {
+    // Só os átomos marcados no build anterior voltam a livres
+    for (std::uint32_t a : touched_) owner_[a] = local_[a] = kNone;
+    touched_.clear();
+    num_patches_ = 0;
+    if (count <= 0 || radius_ <= 0.0) return 0;
+    if (offset_.empty()) index_bonds(net);
+
+    // Pontos médios das quebras
+    ArenaVector<double> mid(2 * static_cast<std::size_t>(count), 0.0, ArenaAllocator<double>(&arena));
+    for (int s = 0; s < count; ++s) {
+        std::uint32_t a1 = 0, a2 = 0;
+        net.endpoints(static_cast<std::uint32_t>(seeds[s]), a1, a2);
+        for (int c = 0; c < 2; ++c) {
+            const double d = min_image(net, c, net.x[3 * a1 + c] - net.x[3 * a2 + c]);
+            mid[2 * s + c] = net.x[3 * a2 + c] + 0.5 * d;
+        }
+    }
+
+    // Grupos: componentes do grafo "a menos de `link`" entre pontos médios
+    const double link = 2.0 * (radius_ + 2.5 * net.r0);
+    ArenaVector<std::uint32_t> parent(count, 0, ArenaAllocator<std::uint32_t>(&arena));
+    for (int s = 0; s < count; ++s) parent[s] = static_cast<std::uint32_t>(s);
+    for (int s = 0; s < count; ++s) {
+        for (int t = s + 1; t < count; ++t) {
+            const double dx = min_image(net, 0, mid[2 * s] - mid[2 * t]);
+            const double dy = min_image(net, 1, mid[2 * s + 1] - mid[2 * t + 1]);
+            if (dx * dx + dy * dy < link * link) parent[find(parent, s)] = find(parent, t);
+        }
+    }
+    ArenaVector<std::uint32_t> group(count, kNone, ArenaAllocator<std::uint32_t>(&arena));
+    std::uint32_t groups = 0;
+    for (int s = 0; s < count; ++s) {
+        const std::uint32_t root = find(parent, s);
+        if (group[root] == kNone) group[root] = groups++;
+        group[s] = group[root];
+    }
+    // Registros reaproveitados: as listas mantêm a capacidade
+    if (patches_.size() < groups) patches_.resize(groups);
+    num_patches_ = groups;
+    for (std::uint32_t p = 0; p < groups; ++p) {
+        patches_[p].atoms.clear();
+        patches_[p].bonds.clear();
+    }
+
+    // Interiores: busca em largura pelas ligações a partir das pontas de cada
+    // quebra, sem passar de R do seu ponto médio
+    const double r2 = radius_ * radius_;
+    const std::size_t limit = static_cast<std::size_t>(max_fraction_ * net.num_atoms);
+    std::size_t interior = 0;
+    ArenaVector<std::uint32_t> queue{ArenaAllocator<std::uint32_t>(&arena)};
+    for (int s = 0; s < count; ++s) {
+        if (++stamp_ == 0) {
+            std::fill(visit_.begin(), visit_.end(), 0u);
+            stamp_ = 1;
+        }
+        Patch& patch = patches_[group[s]];
+        std::uint32_t a1 = 0, a2 = 0;
+        net.endpoints(static_cast<std::uint32_t>(seeds[s]), a1, a2);
+        queue.clear();
+        for (std::uint32_t a : {a1, a2}) {
+            if (visit_[a] == stamp_) continue;
+            visit_[a] = stamp_;
+            queue.push_back(a);
+        }
+        for (std::size_t head = 0; head < queue.size(); ++head) {
+            const std::uint32_t a = queue[head];
+            const double dx = min_image(net, 0, net.x[3 * a] - mid[2 * s]);
+            const double dy = min_image(net, 1, net.x[3 * a + 1] - mid[2 * s + 1]);
+            if (dx * dx + dy * dy > r2) continue;
+            if (owner_[a] == kNone) {
+                owner_[a] = group[s];
+                patch.atoms.push_back(a);
+                touched_.push_back(a);
+                if (++interior > limit) {
+                    num_patches_ = 0;
+                    return 0;
+                }
+            }
+            for (std::uint32_t e = offset_[a]; e < offset_[a + 1]; ++e) {
+                std::uint32_t b1 = 0, b2 = 0;
+                net.endpoints(incident_[e], b1, b2);
+                const std::uint32_t w = (b1 == a) ? b2 : b1;
+                if (visit_[w] == stamp_) continue;
+                visit_[w] = stamp_;
+                queue.push_back(w);
+            }
+        }
+    }
+    // Interior em ordem crescente de átomo, como na rede
+    for (std::uint32_t p = 0; p < groups; ++p) {
+        Patch& patch = patches_[p];
+        std::sort(patch.atoms.begin(), patch.atoms.end());
+        for (std::uint32_t i = 0; i < patch.atoms.size(); ++i) local_[patch.atoms[i]] = i;
+        patch.interior = static_cast<std::uint32_t>(patch.atoms.size());
+    }
+
+    // Ligações ativas com uma ponta no interior, em ordem crescente; a outra
+    // ponta, se estiver fora, entra na camada fixa
+    for (std::uint32_t p = 0; p < groups; ++p) {
+        Patch& patch = patches_[p];
+        for (std::uint32_t i = 0; i < patch.interior; ++i) {
+            const std::uint32_t a = patch.atoms[i];
+            for (std::uint32_t e = offset_[a]; e < offset_[a + 1]; ++e) {
+                const std::uint32_t b = incident_[e];
+                std::uint32_t b1 = 0, b2 = 0;
+                if (!net.alive.test(b) || !net.endpoints(b, b1, b2)) continue;
+                const std::uint32_t w = (b1 == a) ? b2 : b1;
+                // Entre dois átomos do interior, a ligação entra pela ponta menor
+                if (owner_[w] == p && w < a) continue;
+                patch.bonds.push_back(b);
+            }
+        }
+        std::sort(patch.bonds.begin(), patch.bonds.end());
+        for (std::uint32_t b : patch.bonds) {
+            std::uint32_t b1 = 0, b2 = 0;
+            net.endpoints(b, b1, b2);
+            for (std::uint32_t a : {b1, b2}) {
+                if (owner_[a] != kNone && owner_[a] != p) {
+                    // Ligação esticada entre dois patches: fica para a global
+                    num_patches_ = 0;
+                    return 0;
+                }
+                if (owner_[a] == kNone) {
+                    owner_[a] = p;
+                    local_[a] = static_cast<std::uint32_t>(patch.atoms.size());
+                    patch.atoms.push_back(a);
+                    touched_.push_back(a);
+                }
+            }
+        }
+    }
+
+    // Redes dos patches
+    for (std::uint32_t p = 0; p < groups; ++p) {
+        Patch& patch = patches_[p];
+        Network& sub = patch.sub;
+        sub.num_atoms = static_cast<std::uint32_t>(patch.atoms.size());
+        sub.x.resize(3 * static_cast<std::size_t>(sub.num_atoms));
+        sub.atom_type.resize(sub.num_atoms);
+        for (std::uint32_t i = 0; i < sub.num_atoms; ++i) {
+            const std::uint32_t a = patch.atoms[i];
+            for (int c = 0; c < 3; ++c) sub.x[3 * i + c] = net.x[3 * a + c];
+            sub.atom_type[i] = (i < patch.interior) ? net.atom_type[a] : static_cast<std::uint8_t>(atom_floppy);
+        }
+        sub.num_bonds = sub.num_physical_bonds = static_cast<std::uint32_t>(patch.bonds.size());
+        sub.bond_atom1.resize(sub.num_bonds);
+        sub.bond_atom2.resize(sub.num_bonds);
+        sub.break_len_sq.resize(sub.num_bonds);
+        if (!net.rest_len.empty()) sub.rest_len.resize(sub.num_bonds);
+        for (std::uint32_t l = 0; l < sub.num_bonds; ++l) {
+            const std::uint32_t b = patch.bonds[l];
+            std::uint32_t a1 = 0, a2 = 0;
+            net.endpoints(b, a1, a2);
+            sub.bond_atom1[l] = local_[a1];
+            sub.bond_atom2[l] = local_[a2];
+            sub.break_len_sq[l] = net.break_len_sq[b];
+            if (!net.rest_len.empty()) sub.rest_len[l] = net.rest_len[b];
+        }
+        sub.alive.assign(sub.num_bonds, true);
+        sub.k = net.k;
+        sub.r0 = net.r0;
+        sub.box = net.box;
+        for (int d = 0; d < 3; ++d) sub.periodic[d] = net.periodic[d];
+        sub.dimension = net.dimension;
+    }
+    return interior;
+}
+
+}  // namespace spring
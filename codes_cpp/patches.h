@@ -0,0 +1,153 @@
+// patches.h
+//
+// Pré-relaxação local em patches em torno das quebras de uma iteração.
+//
+// No fim de uma corrida, uma iteração da avalanche costuma quebrar ligações
+// em células distantes da matriz, cuja redistribuição de carga não interage
+// em primeira ordem. As quebras são agrupadas por proximidade (pontos médios
+// a menos de 2 (R + 2.5 r0), periódico em x) e cada grupo ganha um patch: os
+// átomos a até R de alguma das suas quebras, alcançados por busca em largura
+// pelas ligações a partir das pontas de cada quebra, mais uma camada de
+// átomos vizinhos fixos (tipo atom_floppy) na posição atual. Com essa
+// distância de ligação, interiores e camadas de patches diferentes não se
+// tocam. A montagem custa os átomos e as ligações dos patches, não a rede.
+//
+// Cada patch vira uma `Network` explícita pequena, relaxada com `CgRelax` e
+// varrida com os limiares das suas ligações, todos em paralelo (um patch por
+// tarefa, --threads). As posições dos interiores voltam à rede como ponto de
+// partida da próxima relaxação global. As ligações acima do limiar no patch
+// são só candidatas: com a fronteira congelada a varredura local erra para
+// os dois lados, então nada é quebrado aqui. A relaxação global seguinte e a sua varredura
+// decidem; as candidatas só medem o acerto da previsão local. As quebras são
+// as do loop sem patches, a menos do ponto de partida das relaxações, que
+// muda o estado final dentro de ftol.
+//
+// Se os patches somarem mais de `max_fraction` dos átomos, a rodada não é
+// feita e a relaxação global segue como antes.
+//
+// `PatchAvalanche` agrupa e monta os patches; `PatchRelax<K>` os relaxa. A
+// lista de incidência da rede, os registros dos patches, as redes deles e um
+// `CgRelax` por thread são reaproveitados entre rodadas, e os temporários do
+// agrupamento vêm da arena da iteração (memory.h).
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kernels.h"
+#include "memory.h"
+#include "network.h"
+#include "parallel.h"
+#include "relax.h"
+
+namespace spring {
+
+class PatchAvalanche {
+public:
+    PatchAvalanche(double radius, int threads, double max_fraction = 0.5)
+        : radius_(radius), threads_(threads), max_fraction_(max_fraction) {}
+
+    struct Round {
+        std::vector<int> candidates;  // ligações globais acima do limiar nos patches, crescentes
+        int patches = 0;
+        std::size_t atoms = 0;   // átomos nos interiores dos patches
+        int iterations = 0;      // soma das iterações de CG dos patches
+        int force_evals = 0;
+        bool skipped = false;    // patches grandes demais: só a relaxação global
+    };
+
+protected:
+    struct Patch {
+        Network sub;
+        std::vector<std::uint32_t> atoms;  // índice global de cada átomo local
+        std::uint32_t interior = 0;        // os `interior` primeiros são o interior
+        std::vector<std::uint32_t> bonds;  // índice global de cada ligação local
+        RelaxResult result;
+        std::vector<int> out;
+        int broken = 0;
+    };
+
+    // Monta os patches; retorna o total de átomos nos interiores (0: nenhum
+    // patch, ou grandes demais)
+    std::size_t build(const Network& net, const int* seeds, int count, Arena& arena);
+    // Ligações incidentes a cada átomo (CSR), montada no primeiro build
+    void index_bonds(const Network& net);
+
+    double radius_;
+    int threads_;
+    double max_fraction_;
+    std::vector<Patch> patches_;  // os num_patches_ primeiros são da rodada
+    std::size_t num_patches_ = 0;
+    std::vector<std::uint32_t> owner_;  // patch de cada átomo (interior ou camada)
+    std::vector<std::uint32_t> local_;  // índice local no patch
+    std::vector<std::uint32_t> touched_;  // átomos com owner_ marcado no último build
+    std::vector<std::uint32_t> offset_, incident_;
+    std::vector<std::uint32_t> visit_;  // marca da busca em largura de cada quebra
+    std::uint32_t stamp_ = 0;
+};
+
+template <class K>
+class PatchRelax : public PatchAvalanche {
+public:
+    PatchRelax(double radius, int threads, double max_fraction = 0.5)
+        : PatchAvalanche(radius, threads, max_fraction), relaxers_(std::max(1, threads)) {}
+
+    // Relaxa os patches em torno das ligações recém-quebradas `seeds`, leva
+    // as posições dos interiores para a rede e varre as ligações de cada
+    // patch. Não quebra nada na rede; o resultado vale até a próxima chamada.
+    const Round& relax(Network& net, const int* seeds, int count, const RelaxSettings& settings, Arena& arena) {
+        round_.candidates.clear();
+        round_.atoms = build(net, seeds, count, arena);
+        round_.skipped = (round_.atoms == 0);
+        round_.patches = round_.skipped ? 0 : static_cast<int>(num_patches_);
+        round_.iterations = round_.force_evals = 0;
+        if (round_.skipped) return round_;
+
+        // A coloração é da rede inteira: os patches usam o laço serial
+        RelaxSettings local = settings;
+        local.colored = nullptr;
+        parallel_for(num_patches_, threads_, [&](std::size_t begin, std::size_t end, int tid) {
+            for (std::size_t p = begin; p < end; ++p) {
+                Patch& patch = patches_[p];
+                patch.result = relaxers_[tid].relax(patch.sub, local);
+                patch.out.resize(patch.sub.num_bonds);
+                patch.broken = scan_network<K>(patch.sub, patch.out.data());
+            }
+        });
+
+        for (std::size_t p = 0; p < num_patches_; ++p) {
+            const Patch& patch = patches_[p];
+            for (std::uint32_t i = 0; i < patch.interior; ++i) {
+                const std::uint32_t a = patch.atoms[i];
+                for (int c = 0; c < 3; ++c) net.x[3 * a + c] = patch.sub.x[3 * i + c];
+            }
+            for (int b = 0; b < patch.broken; ++b) round_.candidates.push_back(static_cast<int>(patch.bonds[patch.out[b]]));
+            round_.iterations += patch.result.iterations;
+            round_.force_evals += patch.result.force_evals;
+        }
+        std::sort(round_.candidates.begin(), round_.candidates.end());
+        return round_;
+    }
+
+    const Round& last_round() const { return round_; }
+
+    // Quantas das candidatas da última rodada estão em `broken` (crescente)
+    int confirmed(const int* broken, int count) const {
+        int hits = 0;
+        std::size_t c = 0;
+        for (int b = 0; b < count && c < round_.candidates.size(); ++b) {
+            while (c < round_.candidates.size() && round_.candidates[c] < broken[b]) ++c;
+            if (c < round_.candidates.size() && round_.candidates[c] == broken[b]) ++hits;
+        }
+        return hits;
+    }
+
+private:
+    std::vector<CgRelax<K>> relaxers_;  // um por thread
+    Round round_;
+};
+
+}  // namespace spring
@@ -0,0 +1,331 @@
+// recycle.h
+//
+// Reciclagem de subespaços de Krylov entre relaxações.
+//
+// As relaxações do loop da avalanche resolvem sistemas quase iguais: a mesma
+// rigidez com algumas ligações a menos, ou com a parede um pouco mais
+// deslocada. `RecycleRelax` é Newton com busca linear em que cada passo
+// H p = f vem do CG deflacionado (Saad, Yeung, Erhel e Guyomarc'h, 2000): um
+// subespaço de direções lentas, herdado das relaxações anteriores, é tirado
+// do problema. Ele junta os k vetores de Ritz de menor autovalor do último
+// solve e os h deslocamentos das relaxações anteriores (o próximo passo de
+// deformação repete, em boa parte, a forma do anterior).
+//
+// No início de cada solve a base é A-ortonormalizada na Hessiana atual (uma
+// passada pelas ligações para todas as colunas; direções que viraram núcleo,
+// como modos soltos após quebras, são descartadas), o chute inicial resolve
+// exatamente a parte na base e as direções de busca ficam A-ortogonais a
+// ela. No fim da relaxação, Rayleigh-Ritz em [base, primeiras m direções do
+// último CG] (com os produtos por H já calculados) escolhe os novos vetores
+// de Ritz. A atualização custa só produtos internos: quebras entram na base
+// pela A-ortonormalização seguinte, sem refatorar nada.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "kernels.h"
+#include "linear.h"
+#include "network.h"
+#include "relax.h"
+
+namespace spring {
+
+template <class K>
+class RecycleRelax : public RelaxBackend<K> {
+public:
+    explicit RecycleRelax(int k = 4, int m = 8, int h = 2) : k_(k), m_(m), h_(h) {}
+
+    const char* name() const override { return "recycle"; }
+
+    RelaxResult relax(Network& net, const RelaxSettings& settings) override {
+        const std::size_t n3 = 3 * static_cast<std::size_t>(net.num_atoms);
+        if (n3_ != n3) {
+            n3_ = n3;
+            w_.clear();
+            history_.clear();
+            kw_ = 0;
+        }
+        ForceField<K> field(net, settings);
+        f_.assign(n3, 0.0);
+        ftrial_.assign(n3, 0.0);
+
+        start_ = net.x;
+
+        RelaxResult result;
+        double energy = field.compute(net.x.data(), f_.data());
+        double wall = field.wall_force();
+        result.force_evals = 1;
+        double ff = dot(f_, f_, settings.reproducible);
+
+        for (int iter = 0; iter < settings.maxiter; ++iter) {
+            if (ff < settings.ftol * settings.ftol) {
+                result.stop = StopReason::force;
+                break;
+            }
+            result.iterations = iter + 1;
+
+            StiffnessOperator<K> op(net);
+            const double fnorm = std::sqrt(ff);
+            const int maxcg = static_cast<int>(std::min<std::size_t>(n3, 1000));
+            result.linear_iterations += deflated_cg(op, std::min(0.5, fnorm), maxcg, settings.reproducible);
+            double slope = dot(f_, p_, settings.reproducible);
+            if (!(slope > 0.0)) {
+                p_ = f_;
+                slope = ff;
+            }
+
+            // Armijo por bisseção; no fim da convergência a diferença de
+            // energias some no arredondamento e vale a queda de |f|.
+            x0_ = net.x;
+            const double noise = 1.0e-14 * (std::fabs(energy) + 1.0);
+            double alpha = 1.0, trial = energy, fftrial = ff;
+            bool accepted = false;
+            for (int ls = 0; ls < 30 && result.force_evals < settings.maxeval; ++ls) {
+                for (std::size_t i = 0; i < n3; ++i) net.x[i] = x0_[i] + alpha * p_[i];
+                trial = field.compute(net.x.data(), ftrial_.data());
+                ++result.force_evals;
+                fftrial = dot(ftrial_, ftrial_, settings.reproducible);
+                if (trial <= energy - 1.0e-4 * alpha * slope || (trial <= energy + noise && fftrial < ff)) {
+                    accepted = true;
+                    break;
+                }
+                alpha *= 0.5;
+            }
+            if (!accepted) {
+                net.x = x0_;
+                result.stop = (result.force_evals >= settings.maxeval) ? StopReason::max_evaluations : StopReason::no_descent;
+                break;
+            }
+
+            const double eprevious = energy;
+            energy = trial;
+            wall = field.wall_force();
+            f_.swap(ftrial_);
+            ff = fftrial;
+            if (std::fabs(energy - eprevious) < settings.etol * 0.5 * (std::fabs(energy) + std::fabs(eprevious) + 1.0e-8)) {
+                result.stop = StopReason::energy;
+                break;
+            }
+            if (result.force_evals >= settings.maxeval) {
+                result.stop = StopReason::max_evaluations;
+                break;
+            }
+        }
+
+        // W para a próxima relaxação: Ritz do último solve
+        if (!z_.empty()) rayleigh_ritz();
+        remember_displacement(net);
+        result.energy = energy;
+        result.fnorm = std::sqrt(ff);
+        result.wall_force = wall;
+        return result;
+    }
+
+    std::size_t workspace_bytes() const override {
+        return (f_.capacity() + ftrial_.capacity() + x0_.capacity() + p_.capacity() + r_.capacity() + d_.capacity() +
+                hd_.capacity() + w_.capacity() + aw_.capacity() + v_.capacity() + av_.capacity() + z_.capacity() + az_.capacity()) *
+               sizeof(double);
+    }
+
+private:
+    // CG deflacionado em H p = f a partir de p = V V^T f; para na tolerância
+    // eta |f| ou numa direção de curvatura não positiva.
+    int deflated_cg(const StiffnessOperator<K>& op, double eta, int maxcg, bool reproducible) {
+        const std::size_t n3 = n3_;
+        const int kv = a_orthonormalize(op);
+
+        // p = V V^T f, r = f - AV V^T f, d = r - V (AV)^T r
+        p_.assign(n3, 0.0);
+        r_ = f_;
+        for (int j = 0; j < kv; ++j) {
+            const double c = column_dot(v_, j, f_);
+            for (std::size_t i = 0; i < n3; ++i) {
+                p_[i] += c * v_[n3 * j + i];
+                r_[i] -= c * av_[n3 * j + i];
+            }
+        }
+        d_ = r_;
+        project(d_, kv);
+        hd_.assign(n3, 0.0);
+        const double tol = eta * std::sqrt(dot(f_, f_, reproducible));
+        double rr = dot(r_, r_, reproducible);
+
+        // Direções guardadas para o Rayleigh-Ritz, depois de V
+        z_.reserve(n3 * (kv + m_));
+        az_.reserve(n3 * (kv + m_));
+        z_.assign(v_.begin(), v_.begin() + n3 * kv);
+        az_.assign(av_.begin(), av_.begin() + n3 * kv);
+        int iterations = 0;
+        while (iterations < maxcg && std::sqrt(rr) > tol) {
+            ++iterations;
+            op.apply(d_.data(), hd_.data(), 1);
+            const double dhd = dot(d_, hd_, reproducible);
+            if (!(dhd > 0.0)) break;
+            if (iterations <= m_) {
+                z_.insert(z_.end(), d_.begin(), d_.end());
+                az_.insert(az_.end(), hd_.begin(), hd_.end());
+            }
+            const double alpha = rr / dhd;
+            for (std::size_t i = 0; i < n3; ++i) {
+                p_[i] += alpha * d_[i];
+                r_[i] -= alpha * hd_[i];
+            }
+            const double rr_new = dot(r_, r_, reproducible);
+            const double beta = rr_new / rr;
+            rr = rr_new;
+            // d = r + beta d - V (AV)^T r
+            for (std::size_t i = 0; i < n3; ++i) d_[i] = r_[i] + beta * d_[i];
+            for (int j = 0; j < kv; ++j) {
+                const double c = column_dot(av_, j, r_);
+                for (std::size_t i = 0; i < n3; ++i) d_[i] -= c * v_[n3 * j + i];
+            }
+        }
+        return iterations;
+    }
+
+    // V = [W, deslocamentos anteriores] A-ortonormal na Hessiana atual,
+    // AV = H V; devolve as colunas mantidas. Entradas nos átomos fixos são
+    // zeradas (poda de rigidez).
+    int a_orthonormalize(const StiffnessOperator<K>& op) {
+        const std::size_t n3 = n3_;
+        basis_.assign(w_.begin(), w_.begin() + n3 * kw_);
+        basis_.insert(basis_.end(), history_.begin(), history_.end());
+        const int kb = static_cast<int>(basis_.size() / n3);
+        if (kb == 0) return 0;
+        for (int j = 0; j < kb; ++j) {
+            for (std::size_t a = 0; a < n3 / 3; ++a) {
+                if (!op.is_free(static_cast<std::uint32_t>(a))) std::fill_n(&basis_[n3 * j + 3 * a], 3, 0.0);
+            }
+        }
+        aw_.assign(n3 * kb, 0.0);
+        op.apply(basis_.data(), aw_.data(), kb);
+        std::vector<double> E(std::size_t(kb) * kb), lambda, U;
+        for (int p = 0; p < kb; ++p) {
+            for (int q = p; q < kb; ++q) {
+                E[p * kb + q] = E[q * kb + p] = 0.5 * (column_dot(basis_, p, aw_, q) + column_dot(basis_, q, aw_, p));
+            }
+        }
+        symmetric_eigen(E, lambda, U, kb);
+        const double top = *std::max_element(lambda.begin(), lambda.end());
+        v_.clear();
+        av_.clear();
+        int kv = 0;
+        for (int j = 0; j < kb; ++j) {
+            if (!(lambda[j] > 1.0e-10 * top)) continue;
+            const double scale = 1.0 / std::sqrt(lambda[j]);
+            v_.resize(n3 * (kv + 1), 0.0);
+            av_.resize(n3 * (kv + 1), 0.0);
+            for (int q = 0; q < kb; ++q) {
+                const double c = U[q * kb + j] * scale;
+                for (std::size_t i = 0; i < n3; ++i) {
+                    v_[n3 * kv + i] += c * basis_[n3 * q + i];
+                    av_[n3 * kv + i] += c * aw_[n3 * q + i];
+                }
+            }
+            ++kv;
+        }
+        return kv;
+    }
+
+    // Novo W: os k vetores de Ritz de menor autovalor em span(Z), com
+    // Z = [V, direções do CG] ortonormalizado por Gram-Schmidt modificado
+    // (AZ acompanha).
+    void rayleigh_ritz() {
+        const std::size_t n3 = n3_;
+        int s = static_cast<int>(z_.size() / n3);
+        int kept = 0;
+        for (int j = 0; j < s; ++j) {
+            double* zj = &z_[n3 * j];
+            double* azj = &az_[n3 * j];
+            const double original = std::sqrt(column_dot(z_, j, z_, j));
+            for (int q = 0; q < kept; ++q) {
+                const double c = column_dot(z_, q, z_, j);
+                for (std::size_t i = 0; i < n3; ++i) {
+                    zj[i] -= c * z_[n3 * q + i];
+                    azj[i] -= c * az_[n3 * q + i];
+                }
+            }
+            const double norm = std::sqrt(column_dot(z_, j, z_, j));
+            if (!(norm > 1.0e-8 * original)) continue;
+            for (std::size_t i = 0; i < n3; ++i) {
+                z_[n3 * kept + i] = zj[i] / norm;
+                az_[n3 * kept + i] = azj[i] / norm;
+            }
+            ++kept;
+        }
+        s = kept;
+        if (s == 0) {
+            kw_ = 0;
+            return;
+        }
+        std::vector<double> G(std::size_t(s) * s), theta, Y;
+        for (int p = 0; p < s; ++p) {
+            for (int q = p; q < s; ++q) {
+                G[p * s + q] = G[q * s + p] = 0.5 * (column_dot(z_, p, az_, q) + column_dot(z_, q, az_, p));
+            }
+        }
+        symmetric_eigen(G, theta, Y, s);
+        const double top = *std::max_element(theta.begin(), theta.end());
+        std::vector<int> order;
+        for (int j = 0; j < s; ++j) {
+            if (theta[j] > 1.0e-10 * top) order.push_back(j);
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return theta[a] < theta[b]; });
+        kw_ = std::min<int>(k_, static_cast<int>(order.size()));
+        w_.assign(n3 * kw_, 0.0);
+        for (int j = 0; j < kw_; ++j) {
+            for (int q = 0; q < s; ++q) {
+                const double c = Y[q * s + order[j]];
+                for (std::size_t i = 0; i < n3; ++i) w_[n3 * j + i] += c * z_[n3 * q + i];
+            }
+        }
+    }
+
+    // Deslocamento desta relaxação (normalizado) entra na base; guarda os h
+    // mais recentes.
+    void remember_displacement(const Network& net) {
+        const std::size_t n3 = n3_;
+        if (h_ <= 0) return;
+        double norm = 0.0;
+        for (std::size_t i = 0; i < n3; ++i) {
+            start_[i] = net.x[i] - start_[i];
+            norm += start_[i] * start_[i];
+        }
+        if (!(norm > 0.0)) return;
+        norm = std::sqrt(norm);
+        for (double& v : start_) v /= norm;
+        if (history_.size() >= n3 * h_) history_.erase(history_.begin(), history_.begin() + n3);
+        history_.insert(history_.end(), start_.begin(), start_.end());
+    }
+
+    // v -= V (AV)^T v
+    void project(std::vector<double>& v, int kv) const {
+        for (int j = 0; j < kv; ++j) {
+            const double c = column_dot(av_, j, v);
+            for (std::size_t i = 0; i < n3_; ++i) v[i] -= c * v_[n3_ * j + i];
+        }
+    }
+
+    double column_dot(const std::vector<double>& A, int j, const std::vector<double>& b) const {
+        double s = 0.0;
+        for (std::size_t i = 0; i < n3_; ++i) s += A[n3_ * j + i] * b[i];
+        return s;
+    }
+    double column_dot(const std::vector<double>& A, int p, const std::vector<double>& B, int q) const {
+        double s = 0.0;
+        for (std::size_t i = 0; i < n3_; ++i) s += A[n3_ * p + i] * B[n3_ * q + i];
+        return s;
+    }
+
+    int k_, m_, h_;
+    std::size_t n3_ = 0;
+    int kw_ = 0;  // colunas de W
+    std::vector<double> f_, ftrial_, x0_, p_, r_, d_, hd_;
+    std::vector<double> w_, aw_, v_, av_, z_, az_, basis_, start_, history_;
+};
+
+}  // namespace spring
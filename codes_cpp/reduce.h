@@ -0,0 +1,70 @@
+// reduce.h
+//
+// Reduções determinísticas para o modo reprodutível.
+//
+// Uma soma em ponto flutuante depende da ordem das parcelas; quando a ordem
+// segue a divisão do trabalho (threads, ranks), o mesmo estado pode levar a
+// sequências de quebra diferentes. Aqui a árvore de redução é fixa: o vetor
+// é dividido em blocos de `reduce_block` elementos (independentes do número
+// de threads), cada bloco é somado com compensação de Neumaier e os parciais
+// são combinados em ordem, também compensados. O resultado é bitwise o mesmo
+// para qualquer número de threads que avalie os blocos e tem erro O(eps) em
+// vez de O(n eps). Passam por ela os produtos internos dos backends
+// (inclusive os da norma do precondicionador do Newton) e a energia do laço
+// de forças colorido.
+//
+// Custo: ~4 flops extras por parcela e uma passada serial sobre n/4096
+// parciais; nos produtos internos do CG isso é ~2x o custo do dot simples,
+// mas o tempo de relaxação é dominado pelas forças: na rede 128x128 com 10
+// passos, 4.22 s contra 4.22-4.51 s (0-6%).
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace spring {
+
+constexpr std::size_t reduce_block = 4096;
+
+// Soma compensada de Neumaier
+struct CompensatedSum {
+    double sum = 0.0;
+    double c = 0.0;
+
+    void add(double v) {
+        const double t = sum + v;
+        if (std::fabs(sum) >= std::fabs(v)) c += (sum - t) + v;
+        else c += (v - t) + sum;
+        sum = t;
+    }
+    double value() const { return sum + c; }
+};
+
+// Soma de term(0) + ... + term(n - 1) com a árvore fixa: blocos de
+// `reduce_block` parcelas, compensados e combinados em ordem.
+template <class Term>
+double reproducible_sum(std::size_t n, Term&& term) {
+    CompensatedSum total;
+    for (std::size_t blk = 0; blk < n; blk += reduce_block) {
+        CompensatedSum s;
+        const std::size_t end = std::min(n, blk + reduce_block);
+        for (std::size_t i = blk; i < end; ++i) s.add(term(i));
+        total.add(s.value());
+    }
+    return total.value();
+}
+
+// Produto interno com árvore de redução fixa
+inline double reproducible_dot(const double* a, const double* b, std::size_t n) {
+    return reproducible_sum(n, [&](std::size_t i) { return a[i] * b[i]; });
+}
+
+// Soma de `n` parciais com a mesma árvore: as energias por bloco do laço de
+// forças colorido (coloring.h)
+inline double reproducible_sum(const double* v, std::size_t n) {
+    return reproducible_sum(n, [&](std::size_t i) { return v[i]; });
+}
+
+}  // namespace spring
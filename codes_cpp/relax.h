@@ -0,0 +1,690 @@
+// relax.h
+//
+// Relaxação (minimização de energia) do motor nativo.
+//
+// `RelaxBackend<K>` é a interface comum dos métodos de relaxação; todos são
+// templates sobre a especialização de kernels K escolhida na inicialização.
+// O backend padrão, `CgRelax`, reproduz o `min_style cg` do LAMMPS
+// (Polak-Ribière com busca linear por backtracking) e os mesmos critérios de
+// parada de `minimize etol ftol maxiter maxeval`. Com
+// `RelaxSettings::reproducible`, os produtos internos usam a árvore de
+// redução fixa e compensada de reduce.h.
+//
+// `FireRelax` é o FIRE (Bitzek et al., 2006) com Euler semi-implícito e
+// massas unitárias, como o `min_style fire` do LAMMPS; `RelaxProfile` acumula
+// chamadas, iterações, avaliações e tempo por backend (ver autotune.h).
+//
+// `NewtonRelax` é Newton-Krylov com região de confiança: a Hessiana exata
+// (com os termos de rotação, StiffnessOperator de linear.h) é aplicada sem
+// montagem, o passo vem do CG truncado de Steihaug precondicionado por blocos
+// de Jacobi por átomo, e a região de confiança (na norma do precondicionador)
+// trata a curvatura negativa de ligações comprimidas. A convergência só é
+// superlinear quando os passos ficam dentro da região de confiança: em
+// redes intactas ou pouco danificadas bastam 4-8 iterações externas até
+// |f| ~ 1e-12, mas cada relaxação custa 2-3x a do CG. Com dano (pontas de
+// trinca, modos flexíveis perto da percolação de rigidez) os passos ficam
+// na fronteira da região, a convergência é linear e as iterações crescem
+// bastante (na diluição 0.67, 7.3 s contra 3.7 s do CG).
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "coloring.h"
+#include "kernels.h"
+#include "linear.h"
+#include "network.h"
+#include "reduce.h"
+
+namespace spring {
+
+// Equivalente a `minimize 1.0e-5 1.0e-7 1000 10000`
+struct RelaxSettings {
+    double etol = 1.0e-5;
+    double ftol = 1.0e-7;
+    int maxiter = 1000;
+    int maxeval = 10000;
+    double dmax = 0.1;  // deslocamento máximo por passo de busca (min_modify dmax)
+    bool reproducible = false;  // reduções de reduce.h (árvore fixa, compensadas)
+    int subdomains = 4;  // subdomínios por lado do Schwarz aditivo (schwarz.h)
+    // Laço de forças com threads sobre as classes de cor (coloring.h), criado
+    // uma vez por execução; null: o laço serial de kernels.h
+    ColoredForces* colored = nullptr;
+
+    // FIRE (min_modify do min_style fire)
+    double dt = 0.1;
+    double dtmax = 0.3;  // E = k (r - r0)^2: modo mais rígido ~ sqrt(12 k)
+    int delaystep = 5;
+    double alpha0 = 0.25;
+};
+
+// Motivo da parada, como o `stopstr` do Min do LAMMPS. Os dois limites
+// (iterações e avaliações) deixam o estado sem convergir; a parada sem
+// descida (busca linear com alpha nulo, região de confiança colapsada) é o
+// fim normal de uma relaxação limitada pelo arredondamento.
+enum class StopReason { energy, force, no_descent, max_iterations, max_evaluations };
+
+inline const char* stop_reason_name(StopReason reason) {
+    switch (reason) {
+        case StopReason::energy: return "energy tolerance";
+        case StopReason::force: return "force tolerance";
+        case StopReason::no_descent: return "linesearch alpha is zero";
+        case StopReason::max_iterations: return "max iterations";
+        case StopReason::max_evaluations: return "max force evaluations";
+    }
+    return "?";
+}
+
+struct RelaxResult {
+    int iterations = 0;
+    int force_evals = 0;
+    double energy = 0.0;
+    double fnorm = 0.0;
+    double wall_force = 0.0;  // reação da parede do topo no estado final
+    int linear_iterations = 0;  // iterações de CG internas (Newton-Krylov)
+    int refactored_cells = 0;   // células refatoradas (schur.h)
+    int local_refreshes = 0;    // regiões do precondicionador recalculadas por dano (ichol.h, schwarz.h)
+    int full_refreshes = 0;     // fatorações completas do precondicionador (ichol.h, schwarz.h)
+    double refresh_seconds = 0.0;
+    StopReason stop = StopReason::max_iterations;  // o laço chegou a maxiter se nada o interrompeu
+    int escalations = 0;  // degraus da escada de recuperação usados (escalation.h)
+
+    bool converged() const { return stop != StopReason::max_iterations && stop != StopReason::max_evaluations; }
+};
+
+// --- Campo de forças ---
+// Avalia energia e forças harmônicas e zera as forças dos átomos fixos
+// (fundo e topo, como `fix setforce 0.0 0.0 0.0` no in.config). Antes de
+// zerar, guarda a reação da parede do topo ao longo do carregamento (a soma
+// das forças das ligações nos átomos do topo, com sinal trocado), que sai de
+// graça de cada avaliação. Os átomos fixos são lidos de atom_type a cada
+// avaliação (um byte por átomo), sem lista própria: o campo é criado a cada
+// relaxação e não aloca.
+template <class K>
+class ForceField {
+public:
+    explicit ForceField(const Network& net, const RelaxSettings& settings = RelaxSettings())
+        : net_(net), colored_(settings.colored) {
+        K::loading::displacement(1.0, dir_);
+        const double norm = std::sqrt(dir_[0] * dir_[0] + dir_[1] * dir_[1] + dir_[2] * dir_[2]);
+        for (double& c : dir_) c /= norm;
+    }
+
+    double compute(const double* x, double* f) const {
+        std::fill(f, f + 3 * static_cast<std::size_t>(net_.num_atoms), 0.0);
+        double energy = colored_ ? colored_->compute<K>(net_, x, f) : network_forces<K>(net_, x, f);
+        wall_ = 0.0;
+        for (std::uint32_t i = 0; i < net_.num_atoms; ++i) {
+            if (net_.atom_type[i] == atom_mobile) continue;
+            if (net_.atom_type[i] == atom_top) wall_ -= f[3 * i] * dir_[0] + f[3 * i + 1] * dir_[1] + f[3 * i + 2] * dir_[2];
+            f[3 * i] = f[3 * i + 1] = f[3 * i + 2] = 0.0;
+        }
+        return energy;
+    }
+
+    // Reação da parede na última chamada de compute()
+    double wall_force() const { return wall_; }
+
+    const Network& network() const { return net_; }
+
+private:
+    const Network& net_;
+    ColoredForces* colored_;
+    double dir_[3];
+    mutable double wall_ = 0.0;
+};
+
+inline double dot(const std::vector<double>& a, const std::vector<double>& b) {
+    double s = 0.0;
+    for (std::size_t i = 0; i < a.size(); ++i) s += a[i] * b[i];
+    return s;
+}
+
+inline double dot(const std::vector<double>& a, const std::vector<double>& b, bool reproducible) {
+    return reproducible ? reproducible_dot(a.data(), b.data(), a.size()) : dot(a, b);
+}
+
+// --- Interface dos backends ---
+template <class K>
+class RelaxBackend {
+public:
+    virtual ~RelaxBackend() = default;
+    virtual const char* name() const = 0;
+    virtual RelaxResult relax(Network& net, const RelaxSettings& settings) = 0;
+    virtual std::size_t workspace_bytes() const { return 0; }
+
+    // Resposta linear em bloco com o operador `op` (atualizado pelo chamador
+    // no estado atual, StiffnessOperator::update): para cada coluna j, impõe
+    // os deslocamentos imposed_j nos átomos fixos e as forças forces_j nos
+    // móveis (qualquer um pode ser nulo). X entra como chute inicial, em
+    // geral a resposta do passo anterior (zeros: do zero), e sai com o
+    // deslocamento total. Todas as colunas compartilham as passadas pelas
+    // ligações (linear.h); os buffers e os solvers ficam no backend.
+    virtual LinearResult linear_response(const StiffnessOperator<K>& op, const double* imposed, const double* forces,
+                                         double* X, int s, const LinearSettings& settings) {
+        const std::size_t n3 = op.size(), total = n3 * static_cast<std::size_t>(s);
+        linear_rhs_.assign(total, 0.0);
+        if (imposed) {
+            op.apply(imposed, linear_rhs_.data(), s, false);
+            for (double& v : linear_rhs_) v = -v;
+        }
+        linear_dx_.resize(total);
+        for (std::size_t i = 0; i < total; ++i) {
+            const bool free = op.is_free(static_cast<std::uint32_t>((i % n3) / 3));
+            if (forces && free) linear_rhs_[i] += forces[i];
+            linear_dx_[i] = free ? X[i] - (imposed ? imposed[i] : 0.0) : 0.0;
+        }
+        LinearResult result = settings.pipelined
+            ? pipelined_solver_.solve(op, linear_rhs_.data(), linear_dx_.data(), s, settings)
+            : block_solver_.solve(op, linear_rhs_.data(), linear_dx_.data(), s, settings);
+        for (std::size_t i = 0; i < total; ++i) X[i] = (imposed ? imposed[i] : 0.0) + linear_dx_[i];
+        return result;
+    }
+
+protected:
+    std::vector<double> linear_rhs_, linear_dx_;
+    BlockCgSolver<K> block_solver_;
+    PipelinedCgSolver<K> pipelined_solver_;
+};
+
+// --- Perfil das relaxações por backend ---
+struct RelaxProfile {
+    struct Entry {
+        std::string name;
+        long long calls = 0, iterations = 0, force_evals = 0;
+        long long local_refreshes = 0, full_refreshes = 0;
+        double seconds = 0.0, refresh_seconds = 0.0;
+    };
+    std::vector<Entry> entries;
+
+    void add(const std::string& name, const RelaxResult& r, double seconds) {
+        auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry& e) { return e.name == name; });
+        if (it == entries.end()) it = entries.insert(entries.end(), Entry{name});
+        ++it->calls;
+        it->iterations += r.iterations;
+        it->force_evals += r.force_evals;
+        it->local_refreshes += r.local_refreshes;
+        it->full_refreshes += r.full_refreshes;
+        it->seconds += seconds;
+        it->refresh_seconds += r.refresh_seconds;
+    }
+
+    void print(std::ostream& out) const {
+        for (const Entry& e : entries) {
+            out << "Info: relax profile " << e.name << ": " << e.calls << " calls, " << e.iterations
+                << " iterations, " << e.force_evals << " force evals, " << e.seconds << " s";
+            if (e.calls > 0) out << " (" << 1.0e3 * e.seconds / e.calls << " ms/call)";
+            if (e.local_refreshes + e.full_refreshes > 0) {
+                out << ", preconditioner " << e.full_refreshes << " full + " << e.local_refreshes
+                    << " region refreshes (" << e.refresh_seconds << " s)";
+            }
+            out << std::endl;
+        }
+    }
+};
+
+// --- Gradiente conjugado não linear (Polak-Ribière) ---
+template <class K>
+class CgRelax : public RelaxBackend<K> {
+public:
+    const char* name() const override { return "cg"; }
+
+    RelaxResult relax(Network& net, const RelaxSettings& settings) override {
+        const std::size_t n3 = 3 * static_cast<std::size_t>(net.num_atoms);
+        ForceField<K> field(net, settings);
+        f_.assign(n3, 0.0);
+        g_.assign(n3, 0.0);
+        h_.assign(n3, 0.0);
+        x0_.assign(n3, 0.0);
+
+        RelaxResult result;
+        double energy = field.compute(net.x.data(), f_.data());
+        result.force_evals = 1;
+        g_ = f_;
+        h_ = f_;
+        double gg = dot(f_, f_, settings.reproducible);
+        const bool preconditioned = precondition(f_, s_);
+        if (preconditioned) {
+            h_ = s_;
+            gg = dot(f_, s_, settings.reproducible);
+        }
+
+        for (int iter = 0; iter < settings.maxiter; ++iter) {
+            result.iterations = iter + 1;
+            const double eprevious = energy;
+
+            if (!line_search(field, net, settings, preconditioned, energy, result.force_evals)) {
+                result.stop = (result.force_evals >= settings.maxeval) ? StopReason::max_evaluations : StopReason::no_descent;
+                break;
+            }
+
+            // Critérios de parada do LAMMPS (Min::iterate)
+            if (std::fabs(energy - eprevious) <
+                settings.etol * 0.5 * (std::fabs(energy) + std::fabs(eprevious) + 1.0e-8)) {
+                result.stop = StopReason::energy;
+                break;
+            }
+            const double ff = dot(f_, f_, settings.reproducible);
+            if (ff < settings.ftol * settings.ftol) {
+                result.stop = StopReason::force;
+                break;
+            }
+            if (result.force_evals >= settings.maxeval) {
+                result.stop = StopReason::max_evaluations;
+                break;
+            }
+
+            // Polak-Ribière com reinício quando h deixa de ser de descida
+            if (!preconditioned) {
+                const double fg = dot(f_, g_, settings.reproducible);
+                const double beta = std::max(0.0, (ff - fg) / gg);
+                gg = ff;
+                g_ = f_;
+                for (std::size_t i = 0; i < n3; ++i) h_[i] = g_[i] + beta * h_[i];
+                if (dot(g_, h_, settings.reproducible) <= 0.0) h_ = g_;
+            } else {
+                // Na métrica de M: s = M^-1 f, beta = f.(s - s_ant) / (f_ant.s_ant)
+                precondition(f_, s_);
+                const double fs = dot(f_, s_, settings.reproducible), gs = dot(g_, s_, settings.reproducible);
+                const double beta = std::max(0.0, (fs - gs) / gg);
+                gg = fs;
+                g_ = f_;
+                for (std::size_t i = 0; i < n3; ++i) h_[i] = s_[i] + beta * h_[i];
+                if (dot(f_, h_, settings.reproducible) <= 0.0) h_ = s_;
+            }
+        }
+
+        result.energy = energy;
+        result.fnorm = std::sqrt(dot(f_, f_, settings.reproducible));
+        result.wall_force = field.wall_force();
+        return result;
+    }
+
+    std::size_t workspace_bytes() const override {
+        return (f_.capacity() + g_.capacity() + h_.capacity() + x0_.capacity() + s_.capacity()) * sizeof(double);
+    }
+
+protected:
+    // Precondicionador das direções: s = M^-1 f. O CG simples não tem
+    // (retorna false e s fica intocado); ver IcRelax em ichol.h.
+    virtual bool precondition(const std::vector<double>& /*f*/, std::vector<double>& /*s*/) { return false; }
+
+private:
+    // Backtracking ao longo de h com refinamento por secante na derivada
+    // direcional. Atualiza net.x, f_ e energy; retorna false se não houver
+    // descida possível (equivalente a "linesearch alpha is zero"). Com
+    // direções precondicionadas (escala de Newton) a secante pode passar de
+    // alpha = 1, até o limite de dmax.
+    bool line_search(const ForceField<K>& field, Network& net, const RelaxSettings& settings, bool preconditioned,
+                     double& energy, int& evals) {
+        const std::size_t n3 = h_.size();
+        const double slope0 = dot(f_, h_, settings.reproducible);
+        if (slope0 <= 0.0) return false;
+
+        double hmax = 0.0;
+        for (double v : h_) hmax = std::max(hmax, std::fabs(v));
+        if (hmax == 0.0) return false;
+        const double alpha_max = std::min(1.0, settings.dmax / hmax);
+        const double alpha_limit = preconditioned ? settings.dmax / hmax : alpha_max;
+
+        x0_ = net.x;
+        const double energy0 = energy;
+        double alpha = alpha_max;
+        while (true) {
+            for (std::size_t i = 0; i < n3; ++i) net.x[i] = x0_[i] + alpha * h_[i];
+            energy = field.compute(net.x.data(), f_.data());
+            ++evals;
+            if (energy <= energy0 - 0.4 * alpha * slope0) break;
+            alpha *= 0.5;
+            if (alpha * slope0 < 1.0e-16 * std::max(1.0, std::fabs(energy0)) || evals >= settings.maxeval) {
+                net.x = x0_;
+                energy = field.compute(net.x.data(), f_.data());
+                ++evals;
+                return false;
+            }
+        }
+
+        // Energia quase quadrática perto do equilíbrio: a secante na
+        // derivada direcional estima o mínimo ao longo de h.
+        const double slope1 = dot(f_, h_, settings.reproducible);
+        if (slope0 - slope1 > 0.0 && evals < settings.maxeval) {
+            const double alpha_s = std::min(alpha * slope0 / (slope0 - slope1), alpha_limit);
+            if (std::fabs(alpha_s - alpha) > 1.0e-3 * alpha) {
+                const double energy_a = energy;
+                for (std::size_t i = 0; i < n3; ++i) net.x[i] = x0_[i] + alpha_s * h_[i];
+                energy = field.compute(net.x.data(), f_.data());
+                ++evals;
+                if (energy > energy_a) {
+                    for (std::size_t i = 0; i < n3; ++i) net.x[i] = x0_[i] + alpha * h_[i];
+                    energy = field.compute(net.x.data(), f_.data());
+                    ++evals;
+                }
+            }
+        }
+        return true;
+    }
+
+    std::vector<double> f_, g_, h_, x0_, s_;
+};
+
+// --- FIRE ---
+template <class K>
+class FireRelax : public RelaxBackend<K> {
+public:
+    const char* name() const override { return "fire"; }
+
+    RelaxResult relax(Network& net, const RelaxSettings& settings) override {
+        const std::size_t n3 = 3 * static_cast<std::size_t>(net.num_atoms);
+        ForceField<K> field(net, settings);
+        f_.assign(n3, 0.0);
+        v_.assign(n3, 0.0);
+
+        RelaxResult result;
+        double energy = field.compute(net.x.data(), f_.data());
+        result.force_evals = 1;
+        double dt = settings.dt, alpha = settings.alpha0;
+        int positive = 0;
+
+        for (int iter = 0; iter < settings.maxiter; ++iter) {
+            result.iterations = iter + 1;
+            const double eprevious = energy;
+
+            const double power = dot(f_, v_, settings.reproducible);
+            if (power > 0.0) {
+                if (++positive > settings.delaystep) {
+                    dt = std::min(dt * 1.1, settings.dtmax);
+                    alpha *= 0.99;
+                }
+            } else {
+                // Passo para trás: meio passo de volta e velocidades zeradas
+                positive = 0;
+                for (std::size_t i = 0; i < n3; ++i) net.x[i] -= 0.5 * dt * v_[i];
+                std::fill(v_.begin(), v_.end(), 0.0);
+                dt *= 0.5;
+                alpha = settings.alpha0;
+            }
+
+            // Euler semi-implícito e mistura FIRE
+            for (std::size_t i = 0; i < n3; ++i) v_[i] += dt * f_[i];
+            const double vv = dot(v_, v_, settings.reproducible), ff = dot(f_, f_, settings.reproducible);
+            const double mix = (ff > 0.0) ? alpha * std::sqrt(vv / ff) : 0.0;
+            double vmax = 0.0;
+            for (std::size_t i = 0; i < n3; ++i) {
+                v_[i] = (1.0 - alpha) * v_[i] + mix * f_[i];
+                vmax = std::max(vmax, std::fabs(v_[i]));
+            }
+            const double scale = (vmax * dt > settings.dmax) ? settings.dmax / (vmax * dt) : 1.0;
+            for (std::size_t i = 0; i < n3; ++i) net.x[i] += scale * dt * v_[i];
+
+            energy = field.compute(net.x.data(), f_.data());
+            ++result.force_evals;
+
+            // Mesmos critérios do CG; o de energia só vale em descida
+            if (positive > 0 && std::fabs(energy - eprevious) <
+                settings.etol * 0.5 * (std::fabs(energy) + std::fabs(eprevious) + 1.0e-8)) {
+                result.stop = StopReason::energy;
+                break;
+            }
+            if (dot(f_, f_, settings.reproducible) < settings.ftol * settings.ftol) {
+                result.stop = StopReason::force;
+                break;
+            }
+            if (result.force_evals >= settings.maxeval) {
+                result.stop = StopReason::max_evaluations;
+                break;
+            }
+        }
+
+        result.energy = energy;
+        result.fnorm = std::sqrt(dot(f_, f_, settings.reproducible));
+        result.wall_force = field.wall_force();
+        return result;
+    }
+
+    std::size_t workspace_bytes() const override { return (f_.capacity() + v_.capacity()) * sizeof(double); }
+
+private:
+    std::vector<double> f_, v_;
+};
+
+// --- Newton-Krylov com região de confiança (Steihaug-Toint) ---
+template <class K>
+class NewtonRelax : public RelaxBackend<K> {
+public:
+    const char* name() const override { return "newton"; }
+
+    RelaxResult relax(Network& net, const RelaxSettings& settings) override {
+        const std::size_t n3 = 3 * static_cast<std::size_t>(net.num_atoms);
+        ForceField<K> field(net, settings);
+        f_.assign(n3, 0.0);
+        ftrial_.assign(n3, 0.0);
+
+        reproducible_ = settings.reproducible;
+
+        RelaxResult result;
+        double energy = field.compute(net.x.data(), f_.data());
+        double wall = field.wall_force();
+        result.force_evals = 1;
+        double ff = dot(f_, f_, settings.reproducible);
+        double radius = -1.0, radius0 = 0.0;
+
+        for (int iter = 0; iter < settings.maxiter; ++iter) {
+            if (ff < settings.ftol * settings.ftol) {
+                result.stop = StopReason::force;
+                break;
+            }
+            result.iterations = iter + 1;
+
+            // Modelo quadrático no estado atual e passo de Steihaug
+            StiffnessOperator<K> op(net);
+            factor_preconditioner(op);
+            const double fnorm = std::sqrt(ff);
+            if (radius < 0.0) {
+                // Passo de Jacobi completo, na norma do precondicionador
+                precondition(f_, y_);
+                radius = radius0 = std::sqrt(std::max(dot(f_, y_, settings.reproducible), 0.0));
+            }
+            const double eta = std::min(0.5, fnorm);
+            const double predicted = steihaug(op, settings, radius, eta, result.linear_iterations);
+
+            x0_ = net.x;
+            for (std::size_t i = 0; i < n3; ++i) net.x[i] += p_[i];
+            const double trial = field.compute(net.x.data(), ftrial_.data());
+            ++result.force_evals;
+
+            // Razão entre redução real e prevista; no fim da convergência a
+            // diferença de energias some no arredondamento e o passo é aceito.
+            const double actual = energy - trial;
+            const double noise = 1.0e-14 * (std::fabs(energy) + 1.0);
+            const double rho = (predicted > noise) ? actual / predicted : (actual >= -noise ? 1.0 : -1.0);
+            const double pnorm = m_norm(p_);
+            if (rho < 0.25) radius = 0.25 * pnorm;
+            else if (rho > 0.75 && pnorm > 0.99 * radius) radius *= 2.0;
+
+            if (rho > 1.0e-4) {
+                const double eprevious = energy;
+                energy = trial;
+                wall = field.wall_force();
+                f_.swap(ftrial_);
+                ff = dot(f_, f_, settings.reproducible);
+                if (std::fabs(energy - eprevious) <
+                    settings.etol * 0.5 * (std::fabs(energy) + std::fabs(eprevious) + 1.0e-8)) {
+                    result.stop = StopReason::energy;
+                    break;
+                }
+            } else {
+                net.x = x0_;
+                if (radius < 1.0e-12 * radius0) {
+                    result.stop = StopReason::no_descent;
+                    break;
+                }
+            }
+            if (result.force_evals >= settings.maxeval) {
+                result.stop = StopReason::max_evaluations;
+                break;
+            }
+        }
+
+        result.energy = energy;
+        result.fnorm = std::sqrt(ff);
+        result.wall_force = wall;
+        return result;
+    }
+
+    std::size_t workspace_bytes() const override {
+        return (f_.capacity() + ftrial_.capacity() + x0_.capacity() + p_.capacity() + hp_.capacity() + r_.capacity() +
+                y_.capacity() + d_.capacity() + hd_.capacity() + chol_.capacity()) * sizeof(double);
+    }
+
+private:
+    // Steihaug: CG precondicionado em H p = f a partir de p = 0, parando na
+    // tolerância eta |f|, na fronteira |p|_M = radius ou numa direção de
+    // curvatura não positiva (que é seguida até a fronteira). Devolve a
+    // redução prevista pelo modelo, -(g.p + p.Hp / 2) com g = -f.
+    double steihaug(const StiffnessOperator<K>& op, const RelaxSettings& settings, double radius, double eta,
+                    int& iterations) {
+        const std::size_t n3 = f_.size();
+        p_.assign(n3, 0.0);
+        hp_.assign(n3, 0.0);
+        r_ = f_;  // resíduo f - H p
+        precondition(r_, y_);
+        d_ = y_;
+        hd_.assign(n3, 0.0);
+        double ry = dot(r_, y_, settings.reproducible);
+        const double tol = eta * std::sqrt(dot(r_, r_, settings.reproducible));
+        const int maxcg = static_cast<int>(std::min<std::size_t>(n3, 1000));
+
+        for (int j = 0; j < maxcg && ry > 0.0; ++j) {
+            ++iterations;
+            op.apply(d_.data(), hd_.data(), 1);
+            const double dhd = dot(d_, hd_, settings.reproducible);
+            if (dhd <= 0.0) {
+                advance(to_boundary(radius), n3);
+                break;
+            }
+            const double alpha = ry / dhd;
+            // Passo além da fronteira: para nela
+            if (m_norm_after(alpha) >= radius) {
+                advance(to_boundary(radius), n3);
+                break;
+            }
+            advance(alpha, n3);
+            for (std::size_t i = 0; i < n3; ++i) r_[i] -= alpha * hd_[i];
+            if (std::sqrt(dot(r_, r_, settings.reproducible)) <= tol) break;
+            precondition(r_, y_);
+            const double ry_new = dot(r_, y_, settings.reproducible);
+            const double beta = ry_new / ry;
+            ry = ry_new;
+            for (std::size_t i = 0; i < n3; ++i) d_[i] = y_[i] + beta * d_[i];
+        }
+        return dot(f_, p_, settings.reproducible) - 0.5 * dot(p_, hp_, settings.reproducible);
+    }
+
+    void advance(double tau, std::size_t n3) {
+        for (std::size_t i = 0; i < n3; ++i) {
+            p_[i] += tau * d_[i];
+            hp_[i] += tau * hd_[i];
+        }
+    }
+
+    // tau >= 0 com |p + tau d|_M = radius
+    double to_boundary(double radius) const {
+        const double a = m_dot(d_, d_), b = 2.0 * m_dot(p_, d_), c = m_dot(p_, p_) - radius * radius;
+        if (a <= 0.0) return 0.0;
+        return (-b + std::sqrt(std::max(b * b - 4.0 * a * c, 0.0))) / (2.0 * a);
+    }
+
+    double m_norm_after(double alpha) const {
+        return std::sqrt(std::max(m_dot(p_, p_) + 2.0 * alpha * m_dot(p_, d_) + alpha * alpha * m_dot(d_, d_), 0.0));
+    }
+    double m_norm(const std::vector<double>& v) const { return std::sqrt(std::max(m_dot(v, v), 0.0)); }
+
+    // Precondicionador: M = L L^T por átomo, com L o Cholesky do bloco
+    // diagonal da Hessiana (6 entradas: l00 l10 l20 l11 l21 l22). Blocos não
+    // positivos (ligações comprimidas) usam a diagonal de Gershgorin.
+    void factor_preconditioner(const StiffnessOperator<K>& op) {
+        op.diagonal_blocks(diag_);
+        const std::size_t n = diag_.size() / 6;
+        chol_.assign(6 * n, 0.0);
+        for (std::size_t i = 0; i < n; ++i) {
+            const double* a = &diag_[6 * i];
+            double* l = &chol_[6 * i];
+            const double scale = std::fabs(a[0]) + std::fabs(a[3]) + std::fabs(a[5]);
+            if (scale == 0.0) {
+                l[0] = l[3] = l[5] = 1.0;
+                continue;
+            }
+            const double tiny = 1.0e-10 * scale;
+            bool ok = a[0] > tiny;
+            if (ok) {
+                l[0] = std::sqrt(a[0]);
+                l[1] = a[1] / l[0];
+                const double p1 = a[3] - l[1] * l[1];
+                ok = p1 > tiny;
+                if (ok) l[3] = std::sqrt(p1);
+            }
+            if (ok && K::dimension == 3) {
+                l[2] = a[2] / l[0];
+                l[4] = (a[4] - l[2] * l[1]) / l[3];
+                const double p2 = a[5] - l[2] * l[2] - l[4] * l[4];
+                ok = p2 > tiny;
+                if (ok) l[5] = std::sqrt(p2);
+            } else if (ok) {
+                l[2] = l[4] = 0.0;
+                l[5] = 1.0;
+            }
+            if (!ok) {
+                l[1] = l[2] = l[4] = 0.0;
+                l[0] = std::sqrt(std::max(std::fabs(a[0]) + std::fabs(a[1]) + std::fabs(a[2]), tiny));
+                l[3] = std::sqrt(std::max(std::fabs(a[1]) + std::fabs(a[3]) + std::fabs(a[4]), tiny));
+                l[5] = (K::dimension == 3) ? std::sqrt(std::max(std::fabs(a[2]) + std::fabs(a[4]) + std::fabs(a[5]), tiny)) : 1.0;
+            }
+        }
+    }
+
+    // y = M^{-1} r
+    void precondition(const std::vector<double>& r, std::vector<double>& y) const {
+        y.resize(r.size());
+        for (std::size_t i = 0; i < r.size() / 3; ++i) {
+            const double* l = &chol_[6 * i];
+            const double* v = &r[3 * i];
+            const double z0 = v[0] / l[0];
+            const double z1 = (v[1] - l[1] * z0) / l[3];
+            const double z2 = (v[2] - l[2] * z0 - l[4] * z1) / l[5];
+            double* out = &y[3 * i];
+            out[2] = z2 / l[5];
+            out[1] = (z1 - l[4] * out[2]) / l[3];
+            out[0] = (z0 - l[1] * out[1] - l[2] * out[2]) / l[0];
+        }
+    }
+
+    // u^T M v, uma parcela por átomo (árvore fixa de reduce.h no modo
+    // reprodutível)
+    double m_dot(const std::vector<double>& u, const std::vector<double>& v) const {
+        auto term = [&](std::size_t i) {
+            const double* l = &chol_[6 * i];
+            const double* a = &u[3 * i];
+            const double* b = &v[3 * i];
+            // (L^T u) . (L^T v)
+            const double ua0 = l[0] * a[0] + l[1] * a[1] + l[2] * a[2], ub0 = l[0] * b[0] + l[1] * b[1] + l[2] * b[2];
+            const double ua1 = l[3] * a[1] + l[4] * a[2], ub1 = l[3] * b[1] + l[4] * b[2];
+            const double ua2 = l[5] * a[2], ub2 = l[5] * b[2];
+            return ua0 * ub0 + ua1 * ub1 + ua2 * ub2;
+        };
+        const std::size_t n = u.size() / 3;
+        if (reproducible_) return reproducible_sum(n, term);
+        double sum = 0.0;
+        for (std::size_t i = 0; i < n; ++i) sum += term(i);
+        return sum;
+    }
+
+    std::vector<double> f_, ftrial_, x0_, p_, hp_, r_, y_, d_, hd_, diag_, chol_;
+    bool reproducible_ = false;
+};
+
+}  // namespace spring
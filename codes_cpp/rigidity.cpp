@@ -0,0 +1,406 @@
+// rigidity.cpp
+
+#include "rigidity.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace spring {
+
+PebbleGame::PebbleGame(const Network& net) : num_atoms_(net.num_atoms), num_bonds_(net.num_bonds) {
+    if (net.dimension != 2) throw std::runtime_error("Erro: a análise de rigidez é só para redes 2D");
+
+    std::vector<std::uint32_t> fixed;
+    for (std::uint32_t i = 0; i < net.num_atoms; ++i) {
+        if (net.atom_type[i] == atom_bottom || net.atom_type[i] == atom_top) fixed.push_back(i);
+    }
+    if (fixed.size() < 2) throw std::runtime_error("Erro: a análise de rigidez exige ao menos 2 átomos fixos");
+    anchor_a_ = fixed[0];
+    anchor_b_ = fixed[1];
+
+    // Arestas: ligações ativas e, depois, as virtuais que tornam o chão rígido
+    const std::size_t num_virtual = 2 * fixed.size() - 3;
+    const std::size_t num_edges = std::size_t(num_bonds_) + num_virtual;
+    ea_.assign(num_edges, none);
+    eb_.assign(num_edges, none);
+    state_.assign(num_edges, edge_absent);
+    for (std::uint32_t b = 0; b < num_bonds_; ++b) {
+        std::uint32_t a1, a2;
+        if (net.alive.test(b) && net.endpoints(b, a1, a2)) {
+            ea_[b] = a1;
+            eb_[b] = a2;
+        }
+    }
+    std::size_t e = num_bonds_;
+    ea_[e] = anchor_a_;
+    eb_[e++] = anchor_b_;
+    for (std::size_t i = 2; i < fixed.size(); ++i) {
+        ea_[e] = fixed[i];
+        eb_[e++] = anchor_a_;
+        ea_[e] = fixed[i];
+        eb_[e++] = anchor_b_;
+    }
+
+    // CSR de incidência (para a busca reversa e a poda)
+    offset_.assign(std::size_t(num_atoms_) + 1, 0);
+    for (std::size_t k = 0; k < num_edges; ++k) {
+        if (ea_[k] == none) continue;
+        ++offset_[ea_[k] + 1];
+        ++offset_[eb_[k] + 1];
+    }
+    std::partial_sum(offset_.begin(), offset_.end(), offset_.begin());
+    incident_.resize(offset_.back());
+    std::vector<std::uint32_t> fill(offset_.begin(), offset_.end() - 1);
+    for (std::size_t k = 0; k < num_edges; ++k) {
+        if (ea_[k] == none) continue;
+        incident_[fill[ea_[k]]++] = static_cast<std::uint32_t>(k);
+        incident_[fill[eb_[k]]++] = static_cast<std::uint32_t>(k);
+    }
+
+    out_.assign(2 * std::size_t(num_atoms_), none);
+    seen_.assign(num_atoms_, 0);
+    parent_.assign(num_atoms_, none);
+    reach_seen_.assign(num_atoms_, 0);
+
+    build();
+}
+
+// Construção: o chão primeiro (as arestas virtuais ficam todas na base e as
+// redundantes contadas são ligações reais), depois as ligações na ordem da
+// rede. Uma busca que falha percorre uma região rígida inteira; para não
+// repeti-la a cada redundante, as regiões já encontradas são rotuladas,
+// crescem por extensões de Henneberg (átomo ligado a dois da região) e se
+// fundem quando compartilham dois átomos, e ligação com as duas pontas na
+// mesma região é redundante sem busca. Uma ligação cuja ponta tem no máximo
+// uma ligação até aqui é independente (Henneberg I) e é coberta por um pebble
+// dessa ponta, também sem busca: qualquer orientação de um grafo esparso
+// serve ao jogo. Os rótulos só valem aqui, enquanto a rigidez só aumenta.
+// Na rede triangular 256 x 256 a construção cai de ~20 s para ~10 ms.
+void PebbleGame::build() {
+    std::vector<std::uint32_t> label_of(num_atoms_, 0), degree(num_atoms_, 0);
+    std::vector<std::uint32_t> root(1, 0), shared(1, 0);
+    auto find = [&](std::uint32_t r) {
+        while (root[r] != r) r = root[r] = root[root[r]];
+        return r;
+    };
+    auto region = [&](std::uint32_t v) { return find(label_of[v]); };
+
+    // Junta v à região de dois vizinhos (já inseridos) e propaga
+    auto grow = [&](std::uint32_t start) {
+        queue_.assign(1, start);
+        for (std::size_t q = 0; q < queue_.size(); ++q) {
+            const std::uint32_t v = queue_[q];
+            if (region(v) != 0) continue;
+            std::uint32_t joined = 0;
+            for (std::uint32_t k = offset_[v]; k < offset_[v + 1] && joined == 0; ++k) {
+                const std::uint32_t e = incident_[k];
+                const std::uint32_t r = region(other(e, v));
+                if (state_[e] == edge_absent || r == 0) continue;
+                for (std::uint32_t m = k + 1; m < offset_[v + 1]; ++m) {
+                    const std::uint32_t e2 = incident_[m];
+                    if (state_[e2] != edge_absent && other(e2, v) != other(e, v) && region(other(e2, v)) == r) {
+                        joined = r;
+                        break;
+                    }
+                }
+            }
+            if (joined == 0) continue;
+            label_of[v] = joined;
+            for (std::uint32_t k = offset_[v]; k < offset_[v + 1]; ++k) {
+                const std::uint32_t e = incident_[k];
+                if (state_[e] != edge_absent && region(other(e, v)) == 0) queue_.push_back(other(e, v));
+            }
+        }
+    };
+
+    // Fecho de {a, b} pelas arestas cobertas; com no máximo 3 pebbles livres
+    // ele tem 2n - 3 arestas independentes, logo é rígido.
+    auto label = [&](std::uint32_t a, std::uint32_t b) {
+        const std::uint32_t stamp = next_stamp();
+        trail_.clear();
+        for (std::uint32_t s : {a, b}) {
+            if (seen_[s] != stamp) {
+                seen_[s] = stamp;
+                trail_.push_back(s);
+            }
+        }
+        int free = 0;
+        for (std::size_t q = 0; q < trail_.size(); ++q) {
+            const std::uint32_t w = trail_[q];
+            free += pebbles(w);
+            for (int s = 0; s < 2; ++s) {
+                const std::uint32_t e = out_[2 * w + s];
+                if (e != none && seen_[other(e, w)] != stamp) {
+                    seen_[other(e, w)] = stamp;
+                    trail_.push_back(other(e, w));
+                }
+            }
+        }
+        if (free > 3) return;
+        const std::uint32_t fresh = static_cast<std::uint32_t>(root.size());
+        root.push_back(fresh);
+        shared.push_back(0);
+        for (std::uint32_t w : trail_) {
+            const std::uint32_t r = region(w);
+            if (r != 0 && r != find(fresh) && ++shared[r] == 2) root[r] = find(fresh);
+        }
+        for (std::uint32_t w : trail_) {
+            shared[find(label_of[w])] = 0;
+            label_of[w] = fresh;
+        }
+    };
+
+    for (std::size_t k = num_bonds_; k < ea_.size(); ++k) {
+        if (!insert(static_cast<std::uint32_t>(k))) throw std::runtime_error("Erro: chão não rígido no pebble game");
+    }
+    root.push_back(1);
+    shared.push_back(0);
+    for (std::size_t k = num_bonds_; k < ea_.size(); ++k) {
+        label_of[ea_[k]] = label_of[eb_[k]] = 1;
+        ++degree[ea_[k]];
+        ++degree[eb_[k]];
+    }
+
+    for (std::size_t k = 0; k < num_bonds_; ++k) {
+        if (ea_[k] == none) continue;
+        const std::uint32_t a = ea_[k], b = eb_[k];
+        if (region(a) != 0 && region(a) == region(b)) {
+            state_[k] = edge_redundant;
+        } else if (degree[b] <= 1) {
+            cover(b, static_cast<std::uint32_t>(k));
+        } else if (degree[a] <= 1) {
+            cover(a, static_cast<std::uint32_t>(k));
+        } else if (!insert(static_cast<std::uint32_t>(k))) {
+            state_[k] = edge_redundant;
+            label(a, b);
+        }
+        redundant_ += (state_[k] == edge_redundant);
+        ++degree[a];
+        ++degree[b];
+        grow(a);
+        grow(b);
+    }
+}
+
+std::uint32_t PebbleGame::next_stamp() {
+    if (++stamp_ == 0) {
+        std::fill(seen_.begin(), seen_.end(), 0);
+        stamp_ = 1;
+    }
+    return stamp_;
+}
+
+// Busca em profundidade ao longo das arestas cobertas por v; ao achar um
+// pebble livre fora de lock1/lock2, inverte o caminho e o traz para v.
+bool PebbleGame::find_pebble(std::uint32_t v, std::uint32_t lock1, std::uint32_t lock2) {
+    const std::uint32_t stamp = next_stamp();
+    stack_.clear();
+    stack_.push_back(v);
+    seen_[v] = stamp;
+    parent_[v] = none;
+    std::size_t next = 0;
+    while (next < stack_.size()) {
+        const std::uint32_t w = stack_[next++];
+        for (int s = 0; s < 2; ++s) {
+            const std::uint32_t e = out_[2 * w + s];
+            if (e == none) continue;
+            const std::uint32_t u = other(e, w);
+            if (seen_[u] == stamp) continue;
+            seen_[u] = stamp;
+            parent_[u] = e;
+            if (u != lock1 && u != lock2 && pebbles(u) > 0) {
+                // Inverte: cada aresta passa a ser coberta pela ponta seguinte
+                std::uint32_t head = u;
+                while (head != v) {
+                    const std::uint32_t edge = parent_[head];
+                    const std::uint32_t tail = other(edge, head);
+                    std::uint32_t* slot = (out_[2 * tail] == edge) ? &out_[2 * tail] : &out_[2 * tail + 1];
+                    *slot = none;
+                    std::uint32_t* free_slot = (out_[2 * head] == none) ? &out_[2 * head] : &out_[2 * head + 1];
+                    *free_slot = edge;
+                    head = tail;
+                }
+                return true;
+            }
+            stack_.push_back(u);
+        }
+    }
+    return false;
+}
+
+// Junta 4 pebbles nas pontas; se conseguir, a aresta é independente e é
+// coberta por um pebble da primeira ponta.
+bool PebbleGame::insert(std::uint32_t e) {
+    const std::uint32_t a = ea_[e], b = eb_[e];
+    while (pebbles(a) < 2) {
+        if (!find_pebble(a, a, b)) return false;
+    }
+    while (pebbles(b) < 2) {
+        if (!find_pebble(b, a, b)) return false;
+    }
+    cover(a, e);
+    return true;
+}
+
+void PebbleGame::cover(std::uint32_t v, std::uint32_t e) {
+    out_[(out_[2 * v] == none) ? 2 * v : 2 * v + 1] = e;
+    state_[e] = edge_independent;
+}
+
+void PebbleGame::remove_bond(std::uint32_t b) {
+    if (b >= num_bonds_ || state_[b] == edge_absent) return;
+    if (state_[b] == edge_redundant) {
+        state_[b] = edge_absent;
+        --redundant_;
+        return;
+    }
+    const std::uint32_t tail = covers(ea_[b], b) ? ea_[b] : eb_[b];
+    out_[(out_[2 * tail] == b) ? 2 * tail : 2 * tail + 1] = none;
+    state_[b] = edge_absent;
+    promote_from(tail);
+}
+
+// O pebble devolvido em t só pode ser alcançado por átomos que chegam a t
+// pelas arestas cobertas; a primeira redundante incidente a um deles junta 4
+// pebbles e vira independente (o posto cai no máximo de um).
+void PebbleGame::promote_from(std::uint32_t t) {
+    if (++reach_stamp_ == 0) {
+        std::fill(reach_seen_.begin(), reach_seen_.end(), 0);
+        reach_stamp_ = 1;
+    }
+    const std::uint32_t stamp = reach_stamp_;
+    queue_.clear();
+    queue_.push_back(t);
+    reach_seen_[t] = stamp;
+    for (std::size_t q = 0; q < queue_.size(); ++q) {
+        const std::uint32_t x = queue_[q];
+        for (std::uint32_t k = offset_[x]; k < offset_[x + 1]; ++k) {
+            const std::uint32_t e = incident_[k];
+            if (state_[e] == edge_redundant) {
+                if (insert(e)) {
+                    --redundant_;
+                    return;
+                }
+                continue;
+            }
+            if (state_[e] != edge_independent) continue;
+            const std::uint32_t y = other(e, x);
+            if (reach_seen_[y] != stamp && covers(y, e)) {
+                reach_seen_[y] = stamp;
+                queue_.push_back(y);
+            }
+        }
+    }
+}
+
+// Com 3 pebbles presos nas âncoras, um átomo é rígido com o chão se não
+// alcança pebble livre; uma busca que falha marca como rígido tudo o que
+// visitou, e átomos já rotulados encerram a busca.
+void PebbleGame::ground_cluster(std::vector<std::uint8_t>& rigid) {
+    const std::uint32_t A = anchor_a_, B = anchor_b_;
+    while (pebbles(A) < 2 && find_pebble(A, A, B)) {}
+    while (pebbles(A) + pebbles(B) < 3 && find_pebble(B, A, B)) {}
+
+    enum : std::uint8_t { unknown = 0, is_rigid = 1, is_floppy = 2 };
+    rigid.assign(num_atoms_, unknown);
+    rigid[A] = rigid[B] = is_rigid;
+    for (std::uint32_t w = 0; w < num_atoms_; ++w) {
+        if (rigid[w] != unknown) continue;
+        if (pebbles(w) > 0) {
+            rigid[w] = is_floppy;
+            continue;
+        }
+        const std::uint32_t stamp = next_stamp();
+        stack_.assign(1, w);
+        trail_.assign(1, w);
+        seen_[w] = stamp;
+        parent_[w] = none;
+        std::uint32_t found = none;
+        while (!stack_.empty() && found == none) {
+            const std::uint32_t x = stack_.back();
+            stack_.pop_back();
+            for (int s = 0; s < 2; ++s) {
+                const std::uint32_t e = out_[2 * x + s];
+                if (e == none) continue;
+                const std::uint32_t u = other(e, x);
+                if (seen_[u] == stamp || rigid[u] == is_rigid) continue;
+                seen_[u] = stamp;
+                parent_[u] = x;
+                if (rigid[u] == is_floppy || pebbles(u) > 0) {
+                    found = u;
+                    break;
+                }
+                stack_.push_back(u);
+                trail_.push_back(u);
+            }
+        }
+        if (found == none) {
+            for (std::uint32_t x : trail_) rigid[x] = is_rigid;
+        } else {
+            for (std::uint32_t x = found; x != none; x = parent_[x]) rigid[x] = is_floppy;
+        }
+    }
+    for (std::uint8_t& r : rigid) r = (r == is_rigid);
+}
+
+RigidityReport PebbleGame::prune_floppy(Network& net) {
+    RigidityReport report;
+    std::vector<std::uint8_t> rigid;
+    ground_cluster(rigid);
+
+    std::uint64_t pebbles_left = 0;
+    std::vector<std::uint32_t> floppy;
+    for (std::uint32_t i = 0; i < num_atoms_; ++i) {
+        if (net.atom_type[i] != atom_floppy) pebbles_left += pebbles(i);
+        if (rigid[i]) {
+            ++report.rigid_atoms;
+        } else if (net.atom_type[i] == atom_mobile) {
+            net.atom_type[i] = atom_floppy;
+            floppy.push_back(i);
+        }
+    }
+    report.floppy_modes = pebbles_left > 3 ? pebbles_left - 3 : 0;
+    report.floppy_atoms = static_cast<std::uint32_t>(floppy.size());
+
+    // Desativa as ligações dos novos átomos flexíveis; componentes conexas
+    // entre eles por union-find
+    std::vector<std::uint32_t> root;
+    if (!floppy.empty()) {
+        root.resize(num_atoms_);
+        std::iota(root.begin(), root.end(), 0u);
+    }
+    auto find = [&](std::uint32_t v) {
+        while (root[v] != v) v = root[v] = root[root[v]];
+        return v;
+    };
+    for (std::uint32_t v : floppy) {
+        for (std::uint32_t k = offset_[v]; k < offset_[v + 1]; ++k) {
+            const std::uint32_t e = incident_[k];
+            if (e >= num_bonds_) continue;
+            if (state_[e] == edge_absent) continue;
+            const std::uint32_t u = other(e, v);
+            if (net.atom_type[u] == atom_floppy) root[find(u)] = find(v);
+            remove_bond(e);
+            net.break_bond(e);
+            ++report.removed_bonds;
+        }
+    }
+    for (std::uint32_t v : floppy) report.floppy_clusters += (find(v) == v);
+    report.redundant_bonds = redundant_;
+    return report;
+}
+
+std::uint64_t PebbleGame::free_pebbles() const {
+    std::uint64_t total = 0;
+    for (std::uint32_t v = 0; v < num_atoms_; ++v) total += pebbles(v);
+    return total;
+}
+
+std::size_t PebbleGame::bytes() const {
+    return (ea_.capacity() + eb_.capacity() + out_.capacity() + offset_.capacity() + incident_.capacity() +
+            seen_.capacity() + parent_.capacity() + reach_seen_.capacity()) * sizeof(std::uint32_t) +
+           state_.capacity();
+}
+
+}  // namespace spring
@@ -0,0 +1,97 @@
+// rigidity.h
+//
+// Análise de rigidez incremental (pebble game 2D, Jacobs & Hendrickson 1997).
+//
+// Redes de forças centrais perdem rigidez localmente muito antes de se
+// desconectarem; regiões flexíveis (floppy) formam um quase núcleo da
+// Hessiana e tornam o CG lento. O pebble game conta graus de liberdade
+// combinatoriamente: cada átomo tem 2 pebbles, cada ligação independente
+// consome um, e uma ligação é redundante (região superdeterminada) quando
+// suas pontas não conseguem juntar 4 pebbles.
+//
+// O chão é um corpo rígido: os átomos fixos (fundo e topo, ambos com
+// deslocamento imposto) são unidos por 2 n_fixos - 3 ligações virtuais,
+// inseridas antes das reais. Assim sobram 3 pebbles globais e todo átomo que
+// ainda alcança um pebble livre com esses 3 presos no chão é flexível em
+// relação às paredes: no equilíbrio, nenhuma ligação que o toca carrega carga.
+//
+// O jogo é construído uma vez por realização; cada quebra é uma remoção
+// incremental (uma ligação independente removida devolve um pebble à sua
+// cauda, e no máximo uma redundante que alcança esse pebble vira
+// independente). Como a rigidez só diminui sob quebras, átomos flexíveis
+// continuam flexíveis: `prune_floppy` os fixa de vez (atom_floppy) e
+// desativa suas ligações, que saem das forças e da varredura.
+//
+// A análise é genérica: na rede triangular regular, linhas retas de ligações
+// são não genéricas (uma corda reta tracionada carrega carga embora seja
+// flexível pela contagem), por isso a poda é opcional (--rigidity).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "network.h"
+
+namespace spring {
+
+struct RigidityReport {
+    std::uint32_t rigid_atoms = 0;      // no cluster rígido do chão
+    std::uint32_t floppy_atoms = 0;     // fixados nesta chamada
+    std::uint32_t floppy_clusters = 0;  // componentes conexas entre eles
+    std::uint32_t removed_bonds = 0;    // ligações desativadas nesta chamada
+    std::uint32_t redundant_bonds = 0;  // ligações redundantes no jogo
+    std::uint64_t floppy_modes = 0;     // pebbles livres além dos 3 globais
+};
+
+class PebbleGame {
+public:
+    explicit PebbleGame(const Network& net);
+
+    // Remove uma ligação (quebrada ou podada) do jogo
+    void remove_bond(std::uint32_t b);
+
+    // rigid[i] = 1 para os átomos rígidos em relação ao chão
+    void ground_cluster(std::vector<std::uint8_t>& rigid);
+
+    // Fixa os átomos móveis fora do cluster do chão e desativa as ligações
+    // que os tocam.
+    RigidityReport prune_floppy(Network& net);
+
+    std::uint32_t redundant_bonds() const { return redundant_; }
+    std::uint64_t free_pebbles() const;
+    std::size_t bytes() const;
+
+private:
+    static constexpr std::uint32_t none = 0xFFFFFFFFu;
+    enum EdgeState : std::uint8_t { edge_absent = 0, edge_independent = 1, edge_redundant = 2 };
+
+    std::uint32_t other(std::uint32_t e, std::uint32_t v) const { return ea_[e] == v ? eb_[e] : ea_[e]; }
+    int pebbles(std::uint32_t v) const { return (out_[2 * v] == none) + (out_[2 * v + 1] == none); }
+    bool covers(std::uint32_t v, std::uint32_t e) const { return out_[2 * v] == e || out_[2 * v + 1] == e; }
+    std::uint32_t next_stamp();
+
+    void build();
+    bool find_pebble(std::uint32_t v, std::uint32_t lock1, std::uint32_t lock2);
+    bool insert(std::uint32_t e);
+    void cover(std::uint32_t v, std::uint32_t e);
+    void promote_from(std::uint32_t t);
+
+    std::uint32_t num_atoms_ = 0;
+    std::uint32_t num_bonds_ = 0;  // arestas [0, num_bonds_) são ligações; o resto, virtuais
+    std::uint32_t anchor_a_ = none, anchor_b_ = none;
+    std::vector<std::uint32_t> ea_, eb_;
+    std::vector<std::uint8_t> state_;
+    std::vector<std::uint32_t> out_;  // 2 por átomo: arestas cobertas pelos seus pebbles
+    std::vector<std::uint32_t> offset_, incident_;  // CSR de todas as arestas
+    std::uint32_t redundant_ = 0;
+
+    // Buscas (pebbles) e busca reversa das promoções, com marcas próprias
+    std::vector<std::uint32_t> seen_, parent_, stack_, trail_;
+    std::uint32_t stamp_ = 0;
+    std::vector<std::uint32_t> reach_seen_, queue_;
+    std::uint32_t reach_stamp_ = 0;
+};
+
+}  // namespace spring
@@ -0,0 +1,128 @@
+// runaway.cpp
+
+#include "runaway.h"
+
+#include <algorithm>
+
+namespace spring {
+
+const char* runaway_trigger_name(RunawayTrigger trigger) {
+    switch (trigger) {
+        case RunawayTrigger::none: return "none";
+        case RunawayTrigger::force_drop: return "wall force drop";
+        case RunawayTrigger::growth: return "geometric growth";
+        case RunawayTrigger::spanning: return "spanning crack";
+    }
+    return "?";
+}
+
+RunawayDetector::RunawayDetector(const Network& net, const RunawaySettings& settings)
+    : settings_(settings), x_ref_(net.x) {}
+
+void RunawayDetector::begin_step(int step) {
+    history_.clear();
+    step_force_ = -1.0;
+    current_ = RunawayEvent();
+    current_.step = step;
+}
+
+std::uint32_t RunawayDetector::find(std::uint32_t i) {
+    while (parent_[i] != i) i = parent_[i] = parent_[parent_[i]];
+    return i;
+}
+
+bool RunawayDetector::connected(const Network& net) {
+    parent_.resize(net.num_atoms);
+    for (std::uint32_t i = 0; i < net.num_atoms; ++i) parent_[i] = i;
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        const std::uint32_t r1 = find(a1), r2 = find(a2);
+        if (r1 != r2) parent_[r1] = r2;
+    }
+    top_root_.assign(net.num_atoms, 0);
+    for (std::uint32_t i = 0; i < net.num_atoms; ++i) {
+        if (net.atom_type[i] == atom_top) top_root_[find(i)] = 1;
+    }
+    for (std::uint32_t i = 0; i < net.num_atoms; ++i) {
+        if (net.atom_type[i] == atom_bottom && top_root_[find(i)]) return true;
+    }
+    return false;
+}
+
+bool RunawayDetector::place_stress_free(Network& net, const double* top_displacement) {
+    if (std::find(net.atom_type.begin(), net.atom_type.end(), atom_floppy) != net.atom_type.end()) {
+        placeable_ = false;
+        return false;
+    }
+    if (connected(net)) return false;
+    backup_ = net.x;
+    for (std::uint32_t i = 0; i < net.num_atoms; ++i) {
+        const bool top = top_root_[find(i)] != 0;
+        for (int c = 0; c < 3; ++c) net.x[3 * i + c] = x_ref_[3 * i + c] + (top ? top_displacement[c] : 0.0);
+    }
+    return true;
+}
+
+void RunawayDetector::reject_placement(Network& net) {
+    net.x = backup_;
+    placeable_ = false;
+}
+
+void RunawayDetector::observe(const Network& net, double wall_force, int broken, bool placed) {
+    history_.push_back(broken);
+    if (placed) ++current_.placements;
+    else ++current_.relaxations;
+    current_.size += broken;
+    if (!placed) peak_ = std::max(peak_, wall_force);
+    if (step_force_ < 0.0) step_force_ = wall_force;
+    if (broken == 0) return;
+
+    if (!failed_ && !connected(net)) {
+        failed_ = true;
+        current_.spanning = true;
+    }
+    if (current_.trigger != RunawayTrigger::none) return;
+    RunawayTrigger trigger = failed_ ? RunawayTrigger::spanning : RunawayTrigger::none;
+    const double threshold = settings_.force_fraction * peak_;
+    if (trigger == RunawayTrigger::none && peak_ > 0.0 && step_force_ >= threshold && wall_force < threshold) {
+        trigger = RunawayTrigger::force_drop;
+    }
+    const int n = static_cast<int>(history_.size()), g = settings_.growth_iterations;
+    if (trigger == RunawayTrigger::none && n > g) {
+        long long offspring = 0, parents = 0;
+        for (int k = n - g; k < n; ++k) {
+            offspring += history_[k];
+            parents += history_[k - 1];
+        }
+        if (offspring >= settings_.min_broken && offspring >= settings_.growth * parents) trigger = RunawayTrigger::growth;
+    }
+    if (trigger != RunawayTrigger::none) {
+        current_.trigger = trigger;
+        current_.trigger_at = current_.size;
+    }
+}
+
+const RunawayEvent* RunawayDetector::end_step() {
+    if (current_.trigger == RunawayTrigger::none) return nullptr;
+    events_.push_back(current_);
+    current_ = RunawayEvent();
+    return &events_.back();
+}
+
+std::size_t RunawayDetector::bytes() const {
+    return (x_ref_.capacity() + backup_.capacity()) * sizeof(double) + parent_.capacity() * sizeof(std::uint32_t) +
+           top_root_.capacity() + history_.capacity() * sizeof(int);
+}
+
+void RunawayDetector::print(std::ostream& out) const {
+    out << "Info: avalanches catastróficas: " << events_.size() << " passos disparados (pico da reação " << peak_ << ")"
+        << std::endl;
+    for (const RunawayEvent& e : events_) {
+        out << "Info:   passo " << e.step << ": " << runaway_trigger_name(e.trigger) << ", tamanho " << e.size << " ("
+            << e.trigger_at << " até o disparo); " << e.relaxations << " relaxações, " << e.placements
+            << " colocações sem tensão" << (e.spanning ? "; trinca atravessando" : "") << std::endl;
+    }
+}
+
+}  // namespace spring
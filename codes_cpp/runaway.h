@@ -0,0 +1,117 @@
+// runaway.h
+//
+// Curto-circuito da avalanche catastrófica (sistemas frágeis, L_matrix = 0).
+//
+// Sem matriz, a avalanche final atravessa dezenas de relaxações completas de
+// uma rede que está se desfazendo, cada uma mais lenta que a anterior à
+// medida que os fragmentos ficam soltos. `RunawayDetector` observa o loop da
+// avalanche e registra um evento (dispara) quando, numa iteração com quebras:
+//
+// - a reação da parede cai, durante o passo, abaixo de `force_fraction` do
+//   pico da execução;
+// - as quebras crescem geometricamente: a razão de ramificação estimada nas
+//   últimas `growth_iterations` iterações (quebras delas sobre as das
+//   iterações anteriores a cada uma) é pelo menos `growth`, com ao menos
+//   `min_broken` quebras nessa janela. Avalanches comuns decaem (7, 3, 1:
+//   razão 0.4); a catastrófica se mantém ou cresce; ou
+// - uma trinca atravessa a amostra: nenhuma componente conexa das ligações
+//   vivas toca as duas paredes.
+//
+// O disparo não muda as relaxações: toda quebra vem da varredura de uma
+// relaxação completa (com a escada de escalation.h), e o tamanho registrado
+// do evento é exato. Relaxações baratas não servem aqui: as quebras de um
+// estado relaxado pela metade podem ser espúrias, e uma varredura barata sem
+// quebras ainda pediria a relaxação completa para encerrar a avalanche. A
+// economia vem da trinca atravessando, que encerra a avalanche no passo em
+// que aparece e torna os passos seguintes triviais.
+//
+// Com a trinca atravessando, o equilíbrio é exato e não precisa de
+// relaxação: cada componente ligada ao topo é a configuração de referência
+// transladada pelo deslocamento acumulado do topo, as demais ficam na
+// referência, e todas as ligações voltam ao comprimento de repouso. Isso vale
+// para o resto da execução. A colocação é conferida pelo |f| contra o ftol
+// das relaxações; se a referência não estiver em repouso, ou se houver
+// átomos fixados pela rigidez (atom_floppy), as relaxações seguem normais.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "network.h"
+
+namespace spring {
+
+struct RunawaySettings {
+    double force_fraction = 0.5;
+    double growth = 1.2;
+    int growth_iterations = 3;
+    int min_broken = 20;
+};
+
+enum class RunawayTrigger { none, force_drop, growth, spanning };
+
+const char* runaway_trigger_name(RunawayTrigger trigger);
+
+// Um passo em que o detector disparou
+struct RunawayEvent {
+    int step = 0;
+    RunawayTrigger trigger = RunawayTrigger::none;
+    long long size = 0;     // ligações quebradas no passo
+    long long trigger_at = 0;  // quebradas até o disparo
+    int relaxations = 0, placements = 0;
+    bool spanning = false;
+};
+
+class RunawayDetector {
+public:
+    // Guarda as posições atuais como referência (3 doubles por átomo)
+    RunawayDetector(const Network& net, const RunawaySettings& settings);
+
+    void begin_step(int step);
+
+    // Trinca atravessando: a próxima relaxação pode ser substituída por
+    // place_stress_free
+    bool failed() const { return failed_ && placeable_; }
+
+    // Coloca a rede no equilíbrio sem tensão da trinca atravessando, com o
+    // topo deslocado de `top_displacement` desde a referência. Retorna false
+    // (sem mexer na rede) se houver átomos atom_floppy.
+    bool place_stress_free(Network& net, const double* top_displacement);
+    // A colocação deixou forças: volta às posições anteriores e desliga a
+    // colocação pelo resto da execução
+    void reject_placement(Network& net);
+
+    // Depois da varredura de cada iteração: reação da parede da relaxação e
+    // quebras aplicadas
+    void observe(const Network& net, double wall_force, int broken, bool placed);
+
+    // Fecha o passo; o evento, se o detector disparou nele
+    const RunawayEvent* end_step();
+
+    const std::vector<RunawayEvent>& events() const { return events_; }
+    double peak_force() const { return peak_; }
+    std::size_t bytes() const;
+
+    void print(std::ostream& out) const;
+
+private:
+    // Une as componentes das ligações vivas; true se alguma toca as duas paredes
+    bool connected(const Network& net);
+    std::uint32_t find(std::uint32_t i);
+
+    RunawaySettings settings_;
+    std::vector<double> x_ref_, backup_;
+    std::vector<std::uint32_t> parent_;
+    std::vector<std::uint8_t> top_root_;
+    std::vector<int> history_;  // quebras por iteração do passo
+    double peak_ = 0.0;
+    double step_force_ = -1.0;  // reação da primeira relaxação do passo
+    bool failed_ = false, placeable_ = true;
+    RunawayEvent current_;
+    std::vector<RunawayEvent> events_;
+};
+
+}  // namespace spring
@@ -0,0 +1,456 @@
+// schur.cpp
+
+#include "schur.h"
+
+#include <stdexcept>
+
+namespace spring {
+
+namespace {
+
+const int kIdx[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+
+}  // namespace
+
+SkeletonSchur::SkeletonSchur(const Network& net, int dimension, int threads) : dim_(dimension), threads_(threads) {
+    const std::uint32_t n = net.num_atoms;
+    role_.assign(n, role_fixed);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || net.breakable(b) || !net.endpoints(b, a1, a2)) continue;
+        if (net.atom_type[a1] == atom_mobile) role_[a1] = role_skeleton;
+        if (net.atom_type[a2] == atom_mobile) role_[a2] = role_skeleton;
+    }
+    local_.assign(n, none);
+    for (std::uint32_t i = 0; i < n; ++i) {
+        if (role_[i] == role_skeleton) {
+            local_[i] = static_cast<std::uint32_t>(skeleton_.size());
+            skeleton_.push_back(i);
+        } else if (net.atom_type[i] == atom_mobile) {
+            role_[i] = role_interior;
+        }
+    }
+    if (skeleton_.empty()) {
+        throw std::runtime_error("Erro: --relax schur exige ligações inquebráveis (L_matrix > 0 ou --layout)");
+    }
+
+    // Vizinhança (CSR) pelas ligações ativas
+    std::vector<std::uint32_t> offset(n + 1, 0), neighbors;
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        ++offset[a1 + 1];
+        ++offset[a2 + 1];
+    }
+    for (std::uint32_t i = 0; i < n; ++i) offset[i + 1] += offset[i];
+    neighbors.resize(offset[n]);
+    std::vector<std::uint32_t> fill(offset.begin(), offset.end() - 1);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        neighbors[fill[a1]++] = a2;
+        neighbors[fill[a2]++] = a1;
+    }
+    std::vector<std::uint32_t> degree(n, 0);
+    for (std::uint32_t v = 0; v < n; ++v) {
+        for (std::uint32_t e = offset[v]; e < offset[v + 1]; ++e) degree[v] += (role_[neighbors[e]] == role_interior);
+    }
+    auto by_degree = [&](std::uint32_t a, std::uint32_t b) { return degree[a] < degree[b]; };
+
+    // Células: componentes do interior. Dentro de cada uma, Cuthill-McKee
+    // reverso a partir de um átomo de grau mínimo.
+    cell_of_.assign(n, none);
+    std::vector<std::uint32_t> component, order, next;
+    for (std::uint32_t seed = 0; seed < n; ++seed) {
+        if (role_[seed] != role_interior || cell_of_[seed] != none) continue;
+        const std::uint32_t c = static_cast<std::uint32_t>(cells_.size());
+        component.assign(1, seed);
+        cell_of_[seed] = c;
+        for (std::size_t h = 0; h < component.size(); ++h) {
+            const std::uint32_t v = component[h];
+            for (std::uint32_t e = offset[v]; e < offset[v + 1]; ++e) {
+                const std::uint32_t w = neighbors[e];
+                if (role_[w] == role_interior && cell_of_[w] == none) {
+                    cell_of_[w] = c;
+                    component.push_back(w);
+                }
+            }
+        }
+        const std::uint32_t start = *std::min_element(component.begin(), component.end(), by_degree);
+        order.assign(1, start);
+        local_[start] = 0;
+        for (std::size_t h = 0; h < order.size(); ++h) {
+            const std::uint32_t v = order[h];
+            next.clear();
+            for (std::uint32_t e = offset[v]; e < offset[v + 1]; ++e) {
+                const std::uint32_t w = neighbors[e];
+                if (role_[w] == role_interior && local_[w] == none) {
+                    local_[w] = 0;
+                    next.push_back(w);
+                }
+            }
+            std::sort(next.begin(), next.end(), by_degree);
+            order.insert(order.end(), next.begin(), next.end());
+        }
+        std::reverse(order.begin(), order.end());
+
+        Cell cell;
+        cell.interior = order;
+        for (std::uint32_t i = 0; i < order.size(); ++i) local_[order[i]] = i;
+        for (std::uint32_t v : order) {
+            for (std::uint32_t e = offset[v]; e < offset[v + 1]; ++e) {
+                if (role_[neighbors[e]] == role_skeleton) cell.border.push_back(local_[neighbors[e]]);
+            }
+        }
+        std::sort(cell.border.begin(), cell.border.end());
+        cell.border.erase(std::unique(cell.border.begin(), cell.border.end()), cell.border.end());
+
+        // Perfil: cada linha começa na primeira coluna de um vizinho anterior
+        const std::size_t dofs = dim_ * order.size();
+        cell.chol.first.resize(dofs);
+        cell.chol.row_start.assign(dofs + 1, 0);
+        for (std::uint32_t i = 0; i < order.size(); ++i) {
+            std::uint32_t lo = i;
+            for (std::uint32_t e = offset[order[i]]; e < offset[order[i] + 1]; ++e) {
+                const std::uint32_t w = neighbors[e];
+                if (role_[w] == role_interior) lo = std::min(lo, local_[w]);
+            }
+            for (int p = 0; p < dim_; ++p) {
+                const std::size_t row = dim_ * std::size_t(i) + p;
+                cell.chol.first[row] = static_cast<std::uint32_t>(dim_ * lo);
+                cell.chol.row_start[row + 1] = cell.chol.row_start[row] + (row - cell.chol.first[row] + 1);
+            }
+        }
+        cells_.push_back(std::move(cell));
+    }
+
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        if (role_[a1] == role_interior) cells_[cell_of_[a1]].bonds.push_back(b);
+        else if (role_[a2] == role_interior) cells_[cell_of_[a2]].bonds.push_back(b);
+        else if (role_[a1] == role_skeleton || role_[a2] == role_skeleton) skeleton_bonds_.push_back(b);
+    }
+
+    std::size_t widest = 0;
+    for (const Cell& cell : cells_) widest = std::max(widest, cell.border.size());
+    border_u_.reserve(dim_ * widest);
+    dirty_.reserve(cells_.size());
+    marked_.reserve(cells_.size());
+    blocks_.resize(std::max(1, threads_));
+}
+
+const std::vector<std::uint32_t>& SkeletonSchur::changed_cells(const Network& net, bool all, bool& skeleton_changed) {
+    std::vector<std::uint32_t>& dirty = dirty_;
+    dirty.clear();
+    const std::size_t words = (net.num_bonds + 63) / 64;
+    const std::uint64_t* alive = net.alive.words();
+    if (all || alive_.empty()) {
+        alive_.assign(alive, alive + words);
+        dirty.resize(cells_.size());
+        for (std::uint32_t c = 0; c < dirty.size(); ++c) dirty[c] = c;
+        skeleton_changed = true;
+        return dirty;
+    }
+    std::vector<std::uint8_t>& marked = marked_;
+    marked.assign(cells_.size(), 0);
+    for (std::size_t w = 0; w < words; ++w) {
+        std::uint64_t diff = alive_[w] ^ alive[w];
+        alive_[w] = alive[w];
+        while (diff) {
+            const std::uint32_t b = static_cast<std::uint32_t>(64 * w + __builtin_ctzll(diff));
+            diff &= diff - 1;
+            std::uint32_t a1, a2;
+            if (!net.endpoints(b, a1, a2)) continue;
+            const std::uint32_t owner = (role_[a1] == role_interior) ? a1 : (role_[a2] == role_interior) ? a2 : none;
+            if (owner == none) {
+                skeleton_changed = true;
+            } else if (!marked[cell_of_[owner]]) {
+                marked[cell_of_[owner]] = 1;
+                dirty.push_back(cell_of_[owner]);
+            }
+        }
+    }
+    return dirty;
+}
+
+void SkeletonSchur::factor_cell(Cell& cell, const std::vector<BondStiffness>& blocks) {
+    const std::size_t n = dim_ * cell.interior.size();
+    const std::size_t m = dim_ * cell.border.size();
+    cell.chol.l.assign(cell.chol.row_start[n], 0.0);
+    cell.coupling.clear();
+    cell.schur.assign(m * m, 0.0);
+    cell.work.assign(n, 0.0);
+    auto border_of = [&](std::uint32_t atom) {
+        return static_cast<std::uint32_t>(std::lower_bound(cell.border.begin(), cell.border.end(), local_[atom]) -
+                                          cell.border.begin());
+    };
+    // K em (P, Q) com P >= Q, só o triângulo inferior
+    auto add = [&](std::uint32_t P, std::uint32_t Q, const double* k, double sign) {
+        for (int p = 0; p < dim_; ++p) {
+            for (int q = 0; q < dim_; ++q) {
+                const std::size_t row = dim_ * std::size_t(P) + p, col = dim_ * std::size_t(Q) + q;
+                if (row >= col) cell.chol.at(row, col) += sign * k[kIdx[p][q]];
+            }
+        }
+    };
+
+    for (const BondStiffness& blk : blocks) {
+        std::uint32_t a = blk.a, b = blk.b;
+        if (role_[a] != role_interior) std::swap(a, b);
+        add(local_[a], local_[a], blk.k, 1.0);
+        if (role_[b] == role_interior) {
+            add(local_[b], local_[b], blk.k, 1.0);
+            add(std::max(local_[a], local_[b]), std::min(local_[a], local_[b]), blk.k, -1.0);
+        } else if (role_[b] == role_skeleton) {
+            Coupling c{local_[a], border_of(b), {}};
+            std::copy(blk.k, blk.k + 6, c.k);
+            cell.coupling.push_back(c);
+            for (int p = 0; p < dim_; ++p) {
+                for (int q = 0; q < dim_; ++q) cell.schur[(dim_ * c.border + p) * m + dim_ * c.border + q] += blk.k[kIdx[p][q]];
+            }
+        }
+    }
+    std::sort(cell.coupling.begin(), cell.coupling.end(),
+              [](const Coupling& x, const Coupling& y) { return x.border < y.border; });
+
+    cell.chol.factor();
+
+    // S_c -= K_Sc K_cc^-1 K_cS, uma coluna da borda por vez (em cell.work)
+    std::vector<double>& z = cell.work;
+    std::size_t begin = 0;
+    for (std::uint32_t j = 0; j < cell.border.size(); ++j) {
+        std::size_t end = begin;
+        while (end < cell.coupling.size() && cell.coupling[end].border == j) ++end;
+        for (int q = 0; q < dim_; ++q) {
+            std::fill(z.begin(), z.end(), 0.0);
+            for (std::size_t c = begin; c < end; ++c) {
+                const Coupling& cp = cell.coupling[c];
+                for (int p = 0; p < dim_; ++p) z[dim_ * cp.atom + p] -= cp.k[kIdx[p][q]];
+            }
+            cell.chol.solve(z.data());
+            const std::size_t col = dim_ * j + q;
+            for (const Coupling& cp : cell.coupling) {
+                for (int p = 0; p < dim_; ++p) {
+                    double s = 0.0;
+                    for (int r = 0; r < dim_; ++r) s += cp.k[kIdx[p][r]] * z[dim_ * cp.atom + r];
+                    cell.schur[(dim_ * cp.border + p) * m + col] += s;
+                }
+            }
+        }
+        begin = end;
+    }
+}
+
+// Blocos diagonais de S por átomo do esqueleto, invertidos (singulares:
+// inverso da diagonal positiva)
+void SkeletonSchur::factor_preconditioner() {
+    const std::size_t ns = skeleton_.size();
+    std::vector<double>& block = diagonal_;
+    block.assign(9 * ns, 0.0);
+    for (const Cell& cell : cells_) {
+        const std::size_t m = dim_ * cell.border.size();
+        for (std::size_t j = 0; j < cell.border.size(); ++j) {
+            for (int p = 0; p < dim_; ++p) {
+                for (int q = 0; q < dim_; ++q) {
+                    block[9 * cell.border[j] + 3 * p + q] += cell.schur[(dim_ * j + p) * m + dim_ * j + q];
+                }
+            }
+        }
+    }
+    for (const BondStiffness& blk : skeleton_blocks_) {
+        for (std::uint32_t atom : {blk.a, blk.b}) {
+            if (role_[atom] != role_skeleton) continue;
+            for (int p = 0; p < dim_; ++p) {
+                for (int q = 0; q < dim_; ++q) block[9 * local_[atom] + 3 * p + q] += blk.k[kIdx[p][q]];
+            }
+        }
+    }
+
+    inverse_.assign(9 * ns, 0.0);
+    for (std::size_t s = 0; s < ns; ++s) {
+        const double* a = &block[9 * s];
+        double* inv = &inverse_[9 * s];
+        double scale = 0.0;
+        for (int p = 0; p < dim_; ++p) scale = std::max(scale, std::fabs(a[4 * p]));
+        double det = 0.0;
+        if (dim_ == 2) {
+            det = a[0] * a[4] - a[1] * a[3];
+            if (det > 1.0e-10 * scale * scale) {
+                inv[0] = a[4] / det;
+                inv[1] = -a[1] / det;
+                inv[3] = -a[3] / det;
+                inv[4] = a[0] / det;
+                continue;
+            }
+        } else {
+            const double c00 = a[4] * a[8] - a[5] * a[7], c01 = a[5] * a[6] - a[3] * a[8], c02 = a[3] * a[7] - a[4] * a[6];
+            det = a[0] * c00 + a[1] * c01 + a[2] * c02;
+            if (det > 1.0e-10 * scale * scale * scale) {
+                inv[0] = c00 / det;
+                inv[3] = c01 / det;
+                inv[6] = c02 / det;
+                inv[1] = (a[2] * a[7] - a[1] * a[8]) / det;
+                inv[4] = (a[0] * a[8] - a[2] * a[6]) / det;
+                inv[7] = (a[1] * a[6] - a[0] * a[7]) / det;
+                inv[2] = (a[1] * a[5] - a[2] * a[4]) / det;
+                inv[5] = (a[2] * a[3] - a[0] * a[5]) / det;
+                inv[8] = (a[0] * a[4] - a[1] * a[3]) / det;
+                continue;
+            }
+        }
+        for (int p = 0; p < dim_; ++p) inv[4 * p] = (a[4 * p] > 0.0) ? 1.0 / a[4 * p] : 0.0;
+    }
+}
+
+// y = S u no esqueleto
+void SkeletonSchur::apply_skeleton(const std::vector<double>& u, std::vector<double>& y) {
+    std::fill(y.begin(), y.end(), 0.0);
+    std::vector<double>& ub = border_u_;
+    for (const Cell& cell : cells_) {
+        const std::size_t m = dim_ * cell.border.size();
+        ub.resize(m);
+        for (std::size_t j = 0; j < cell.border.size(); ++j) {
+            for (int p = 0; p < dim_; ++p) ub[dim_ * j + p] = u[dim_ * std::size_t(cell.border[j]) + p];
+        }
+        for (std::size_t a = 0; a < m; ++a) {
+            const double* row = &cell.schur[a * m];
+            double s = 0.0;
+            for (std::size_t b = 0; b < m; ++b) s += row[b] * ub[b];
+            y[dim_ * std::size_t(cell.border[a / dim_]) + a % dim_] += s;
+        }
+    }
+    for (const BondStiffness& blk : skeleton_blocks_) {
+        const bool sa = role_[blk.a] == role_skeleton, sb = role_[blk.b] == role_skeleton;
+        double du[3] = {0.0, 0.0, 0.0};
+        for (int p = 0; p < dim_; ++p) {
+            du[p] = (sa ? u[dim_ * std::size_t(local_[blk.a]) + p] : 0.0) - (sb ? u[dim_ * std::size_t(local_[blk.b]) + p] : 0.0);
+        }
+        for (int p = 0; p < dim_; ++p) {
+            double ku = 0.0;
+            for (int q = 0; q < dim_; ++q) ku += blk.k[kIdx[p][q]] * du[q];
+            if (sa) y[dim_ * std::size_t(local_[blk.a]) + p] += ku;
+            if (sb) y[dim_ * std::size_t(local_[blk.b]) + p] -= ku;
+        }
+    }
+}
+
+int SkeletonSchur::solve(const double* f, double* p, double tol, int maxiter) {
+    const std::size_t ns = dim_ * skeleton_.size();
+
+    // Interior: z_c = K_cc^-1 f_c
+    parallel_for(cells_.size(), threads_, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t c = begin; c < end; ++c) {
+            Cell& cell = cells_[c];
+            for (std::size_t i = 0; i < cell.interior.size(); ++i) {
+                for (int q = 0; q < dim_; ++q) cell.work[dim_ * i + q] = f[3 * std::size_t(cell.interior[i]) + q];
+            }
+            cell.chol.solve(cell.work.data());
+        }
+    });
+
+    // g = f_S - sum_c K_Sc z_c, com K_Sc = -K_b
+    g_.assign(ns, 0.0);
+    for (std::size_t s = 0; s < skeleton_.size(); ++s) {
+        for (int q = 0; q < dim_; ++q) g_[dim_ * s + q] = f[3 * std::size_t(skeleton_[s]) + q];
+    }
+    for (const Cell& cell : cells_) {
+        for (const Coupling& cp : cell.coupling) {
+            const std::size_t s = dim_ * std::size_t(cell.border[cp.border]);
+            for (int q = 0; q < dim_; ++q) {
+                for (int r = 0; r < dim_; ++r) g_[s + q] += cp.k[kIdx[q][r]] * cell.work[dim_ * cp.atom + r];
+            }
+        }
+    }
+
+    // CG com Jacobi em blocos em S u = g
+    u_.assign(ns, 0.0);
+    r_ = g_;
+    z_.resize(ns);
+    q_.resize(ns);
+    auto precondition = [&]() {
+        for (std::size_t s = 0; s < skeleton_.size(); ++s) {
+            const double* inv = &inverse_[9 * s];
+            for (int a = 0; a < dim_; ++a) {
+                double v = 0.0;
+                for (int b = 0; b < dim_; ++b) v += inv[3 * a + b] * r_[dim_ * s + b];
+                z_[dim_ * s + a] = v;
+            }
+        }
+    };
+    auto dot_ns = [&](const std::vector<double>& a, const std::vector<double>& b) {
+        double s = 0.0;
+        for (std::size_t i = 0; i < ns; ++i) s += a[i] * b[i];
+        return s;
+    };
+    const double target = tol * std::sqrt(dot_ns(g_, g_));
+    int iterations = 0;
+    precondition();
+    d_ = z_;
+    double rz = dot_ns(r_, z_);
+    while (iterations < maxiter && std::sqrt(dot_ns(r_, r_)) > target && rz > 0.0) {
+        ++iterations;
+        apply_skeleton(d_, q_);
+        const double dq = dot_ns(d_, q_);
+        if (!(dq > 0.0)) break;
+        const double alpha = rz / dq;
+        for (std::size_t i = 0; i < ns; ++i) {
+            u_[i] += alpha * d_[i];
+            r_[i] -= alpha * q_[i];
+        }
+        precondition();
+        const double rz_new = dot_ns(r_, z_);
+        const double beta = rz_new / rz;
+        rz = rz_new;
+        for (std::size_t i = 0; i < ns; ++i) d_[i] = z_[i] + beta * d_[i];
+    }
+
+    // Interior: u_c = K_cc^-1 (f_c - K_cS u_S)
+    std::fill(p, p + 3 * role_.size(), 0.0);
+    for (std::size_t s = 0; s < skeleton_.size(); ++s) {
+        for (int q = 0; q < dim_; ++q) p[3 * std::size_t(skeleton_[s]) + q] = u_[dim_ * s + q];
+    }
+    parallel_for(cells_.size(), threads_, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t c = begin; c < end; ++c) {
+            Cell& cell = cells_[c];
+            for (std::size_t i = 0; i < cell.interior.size(); ++i) {
+                for (int q = 0; q < dim_; ++q) cell.work[dim_ * i + q] = f[3 * std::size_t(cell.interior[i]) + q];
+            }
+            for (const Coupling& cp : cell.coupling) {
+                const std::size_t s = dim_ * std::size_t(cell.border[cp.border]);
+                for (int q = 0; q < dim_; ++q) {
+                    for (int r = 0; r < dim_; ++r) cell.work[dim_ * cp.atom + q] += cp.k[kIdx[q][r]] * u_[s + r];
+                }
+            }
+            cell.chol.solve(cell.work.data());
+            for (std::size_t i = 0; i < cell.interior.size(); ++i) {
+                for (int q = 0; q < dim_; ++q) p[3 * std::size_t(cell.interior[i]) + q] = cell.work[dim_ * i + q];
+            }
+        }
+    });
+    return iterations;
+}
+
+std::uint32_t SkeletonSchur::largest_cell() const {
+    std::size_t largest = 0;
+    for (const Cell& cell : cells_) largest = std::max(largest, cell.interior.size());
+    return static_cast<std::uint32_t>(largest);
+}
+
+std::size_t SkeletonSchur::bytes() const {
+    std::size_t total = role_.capacity() + (cell_of_.capacity() + local_.capacity() + skeleton_.capacity() +
+                                           skeleton_bonds_.capacity()) * sizeof(std::uint32_t) +
+                        skeleton_blocks_.capacity() * sizeof(BondStiffness) + alive_.capacity() * sizeof(std::uint64_t) +
+                        (inverse_.capacity() + g_.capacity() + u_.capacity() + r_.capacity() + z_.capacity() +
+                         d_.capacity() + q_.capacity() + diagonal_.capacity() + border_u_.capacity()) * sizeof(double) +
+                        dirty_.capacity() * sizeof(std::uint32_t) + marked_.capacity();
+    for (const auto& blocks : blocks_) total += blocks.capacity() * sizeof(BondStiffness);
+    for (const Cell& cell : cells_) {
+        total += (cell.interior.capacity() + cell.border.capacity() + cell.bonds.capacity()) * sizeof(std::uint32_t) +
+                 cell.chol.bytes() + cell.coupling.capacity() * sizeof(Coupling) +
+                 (cell.schur.capacity() + cell.work.capacity()) * sizeof(double);
+    }
+    return total;
+}
+
+}  // namespace spring
@@ -0,0 +1,250 @@
+// schur.h
+//
+// Subestruturação pelo esqueleto da matriz inquebrável (complemento de Schur).
+//
+// Com L_matrix > 0 (ou um layout com ligações inquebráveis), as ligações
+// inquebráveis dividem a rede em células e o dano fica dentro delas. Os
+// átomos móveis que tocam uma ligação inquebrável formam o esqueleto S; os
+// demais se separam, pelas ligações ativas, em componentes conexas, as
+// células. Numerando o interior de cada célula c antes do esqueleto,
+//   [ K_cc  K_cS ] [u_c]   [f_c]
+//   [ K_Sc  K_SS ] [u_S] = [f_S],
+// o interior é eliminado célula a célula: cada K_cc tem sua fatoração de
+// Cholesky em perfil (ordem de Cuthill-McKee reversa dentro da célula) e sua
+// contribuição densa S_c = K_SS(c) - K_Sc K_cc^-1 K_cS ao complemento de
+// Schur. O sistema reduzido S u_S = f_S - sum_c K_Sc K_cc^-1 f_c é resolvido
+// por CG com Jacobi em blocos por átomo (os blocos diagonais de S são
+// exatos), e o interior sai por substituição, célula a célula.
+//
+// As fatorações ficam em cache: `update` refatora, em paralelo e uma tarefa
+// por célula, só as células com ligações que deixaram de estar ativas desde
+// a última fatoração (quebras, poda de rigidez). Uma avalanche custa então o
+// número de células que ela toca. A matriz fatorada é a Hessiana no momento
+// da fatoração com o termo de tensão truncado em zero,
+//   K_b = 2k [ max(0, 1 - r0/r) I + (r0/r) n n^T ],
+// sempre semidefinida; pivôs desprezíveis (fragmentos soltos dentro de uma
+// célula) são descartados.
+//
+// `SchurRelax` usa o solver como Newton modificado: p = K~^-1 f com a
+// Hessiana congelada e busca linear de Armijo na energia. Com deformações
+// pequenas K~ ≈ H e bastam poucas iterações; quando a convergência se arrasta
+// (geometria longe da fatoração), todas as células são refatoradas, no
+// máximo uma vez por relaxação.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "kernels.h"
+#include "network.h"
+#include "parallel.h"
+#include "relax.h"
+
+namespace spring {
+
+class SkeletonSchur {
+public:
+    SkeletonSchur(const Network& net, int dimension, int threads);
+
+    // Refatora as células cujas ligações mudaram (ou todas) com a geometria
+    // atual. Retorna quantas células foram refatoradas.
+    template <class K>
+    std::uint32_t update(const Network& net, bool all);
+
+    // p = K~^-1 f (passo 3 por átomo; zero nos átomos fixos). Retorna as
+    // iterações do CG no esqueleto.
+    int solve(const double* f, double* p, double tol, int maxiter);
+
+    std::uint32_t num_cells() const { return static_cast<std::uint32_t>(cells_.size()); }
+    std::uint32_t skeleton_atoms() const { return static_cast<std::uint32_t>(skeleton_.size()); }
+    std::uint32_t largest_cell() const;
+    std::size_t bytes() const;
+
+private:
+    static constexpr std::uint32_t none = 0xFFFFFFFFu;
+    enum Role : std::uint8_t { role_fixed = 0, role_skeleton = 1, role_interior = 2 };
+
+    // Bloco K_cS = -K_b entre um átomo do interior e um da borda (locais)
+    struct Coupling {
+        std::uint32_t atom, border;
+        double k[6];
+    };
+
+    struct Cell {
+        std::vector<std::uint32_t> interior;  // átomos, na ordem de eliminação
+        std::vector<std::uint32_t> border;    // índices no esqueleto, ordenados
+        std::vector<std::uint32_t> bonds;     // ligações com ponta no interior
+        EnvelopeCholesky chol;  // K_cc
+        std::vector<Coupling> coupling;  // ordenados por borda
+        std::vector<double> schur;       // S_c denso, (dim |border|)^2
+        std::vector<double> work;
+    };
+
+    const std::vector<std::uint32_t>& changed_cells(const Network& net, bool all, bool& skeleton_changed);
+    void factor_cell(Cell& cell, const std::vector<BondStiffness>& blocks);
+    void factor_preconditioner();
+    void apply_skeleton(const std::vector<double>& u, std::vector<double>& y);
+
+    int dim_ = 2;
+    int threads_ = 1;
+    std::vector<std::uint8_t> role_;
+    std::vector<std::uint32_t> cell_of_, local_;  // célula e posição local (interior ou esqueleto)
+    std::vector<std::uint32_t> skeleton_;         // átomos do esqueleto
+    std::vector<Cell> cells_;
+    std::vector<std::uint32_t> skeleton_bonds_;   // ligações sem ponta em interior
+    std::vector<BondStiffness> skeleton_blocks_;
+    std::vector<std::uint64_t> alive_;            // ligações ativas na última fatoração
+    std::vector<double> inverse_;                 // blocos diagonais de S invertidos (9 por átomo)
+    std::vector<double> g_, u_, r_, z_, d_, q_;   // CG no esqueleto
+    // Áreas de trabalho reaproveitadas entre chamadas
+    std::vector<std::uint32_t> dirty_;
+    std::vector<std::uint8_t> marked_;
+    std::vector<std::vector<BondStiffness>> blocks_;  // uma por thread
+    std::vector<double> diagonal_, border_u_;
+};
+
+template <class K>
+std::uint32_t SkeletonSchur::update(const Network& net, bool all) {
+    bool skeleton_changed = false;
+    const std::vector<std::uint32_t>& dirty = changed_cells(net, all, skeleton_changed);
+    if (all || skeleton_changed) {
+        skeleton_blocks_.clear();
+        BondStiffness s;
+        for (std::uint32_t b : skeleton_bonds_) {
+            if (bond_stiffness<K>(net, b, s)) skeleton_blocks_.push_back(s);
+        }
+    }
+    parallel_for(dirty.size(), threads_, [&](std::size_t begin, std::size_t end, int tid) {
+        std::vector<BondStiffness>& blocks = blocks_[tid];
+        BondStiffness s;
+        for (std::size_t i = begin; i < end; ++i) {
+            Cell& cell = cells_[dirty[i]];
+            blocks.clear();
+            for (std::uint32_t b : cell.bonds) {
+                if (bond_stiffness<K>(net, b, s)) blocks.push_back(s);
+            }
+            factor_cell(cell, blocks);
+        }
+    });
+    if (!dirty.empty() || skeleton_changed) factor_preconditioner();
+    return static_cast<std::uint32_t>(dirty.size());
+}
+
+// --- Newton modificado com a Hessiana subestruturada em cache ---
+template <class K>
+class SchurRelax : public RelaxBackend<K> {
+public:
+    const char* name() const override { return "schur"; }
+
+    RelaxResult relax(Network& net, const RelaxSettings& settings) override {
+        RelaxResult result;
+        if (!schur_) {
+            auto start = std::chrono::high_resolution_clock::now();
+            schur_ = std::make_unique<SkeletonSchur>(net, K::dimension, default_threads());
+            result.refactored_cells = schur_->update<K>(net, true);
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            std::cout << "Info: schur: " << schur_->num_cells() << " células (maior com " << schur_->largest_cell()
+                      << " átomos), " << schur_->skeleton_atoms() << " átomos no esqueleto; fatoração "
+                      << elapsed.count() << " s, " << schur_->bytes() / (1024.0 * 1024.0) << " MiB" << std::endl;
+        } else {
+            result.refactored_cells = schur_->update<K>(net, false);
+        }
+
+        const std::size_t n3 = 3 * static_cast<std::size_t>(net.num_atoms);
+        ForceField<K> field(net, settings);
+        f_.assign(n3, 0.0);
+        ftrial_.assign(n3, 0.0);
+        p_.assign(n3, 0.0);
+        double energy = field.compute(net.x.data(), f_.data());
+        double wall = field.wall_force();
+        result.force_evals = 1;
+        double ff = dot(f_, f_, settings.reproducible);
+        bool refreshed = false;
+
+        for (int iter = 0; iter < settings.maxiter; ++iter) {
+            if (ff < settings.ftol * settings.ftol) {
+                result.stop = StopReason::force;
+                break;
+            }
+            result.iterations = iter + 1;
+
+            const double fnorm = std::sqrt(ff);
+            result.linear_iterations += schur_->solve(f_.data(), p_.data(), std::min(0.5, fnorm), 1000);
+            double slope = dot(f_, p_, settings.reproducible);
+            if (!(slope > 0.0)) {
+                p_ = f_;
+                slope = ff;
+            }
+
+            // Armijo por bisseção; no fim da convergência a diferença de
+            // energias some no arredondamento e vale a queda de |f|.
+            x0_ = net.x;
+            const double noise = 1.0e-14 * (std::fabs(energy) + 1.0);
+            double alpha = 1.0, trial = energy, fftrial = ff;
+            bool accepted = false;
+            for (int ls = 0; ls < 30 && result.force_evals < settings.maxeval; ++ls) {
+                for (std::size_t i = 0; i < n3; ++i) net.x[i] = x0_[i] + alpha * p_[i];
+                trial = field.compute(net.x.data(), ftrial_.data());
+                ++result.force_evals;
+                fftrial = dot(ftrial_, ftrial_, settings.reproducible);
+                if (trial <= energy - 1.0e-4 * alpha * slope || (trial <= energy + noise && fftrial < ff)) {
+                    accepted = true;
+                    break;
+                }
+                alpha *= 0.5;
+            }
+            if (!accepted) {
+                net.x = x0_;
+                if (refreshed) {
+                    result.stop = (result.force_evals >= settings.maxeval) ? StopReason::max_evaluations : StopReason::no_descent;
+                    break;
+                }
+                result.refactored_cells += schur_->update<K>(net, true);
+                refreshed = true;
+                continue;
+            }
+
+            const double eprevious = energy, ffprevious = ff;
+            energy = trial;
+            wall = field.wall_force();
+            f_.swap(ftrial_);
+            ff = fftrial;
+            if (std::fabs(energy - eprevious) < settings.etol * 0.5 * (std::fabs(energy) + std::fabs(eprevious) + 1.0e-8)) {
+                result.stop = StopReason::energy;
+                break;
+            }
+            // Convergência lenta: a geometria se afastou da fatoração
+            if (!refreshed && ff > 0.25 * ffprevious) {
+                result.refactored_cells += schur_->update<K>(net, true);
+                refreshed = true;
+            }
+            if (result.force_evals >= settings.maxeval) {
+                result.stop = StopReason::max_evaluations;
+                break;
+            }
+        }
+
+        result.energy = energy;
+        result.fnorm = std::sqrt(ff);
+        result.wall_force = wall;
+        return result;
+    }
+
+    std::size_t workspace_bytes() const override {
+        return (schur_ ? schur_->bytes() : 0) +
+               (f_.capacity() + ftrial_.capacity() + p_.capacity() + x0_.capacity()) * sizeof(double);
+    }
+
+private:
+    std::unique_ptr<SkeletonSchur> schur_;
+    std::vector<double> f_, ftrial_, p_, x0_;
+};
+
+}  // namespace spring
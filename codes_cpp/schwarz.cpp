@@ -0,0 +1,339 @@
+// schwarz.cpp
+
+#include "schwarz.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace spring {
+
+namespace {
+
+const int kIdx[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+
+}  // namespace
+
+SchwarzPreconditioner::SchwarzPreconditioner(const Network& net, int dimension, int per_side, int overlap, int threads)
+    : dim_(dimension), threads_(threads), modes_(dimension + dimension * (dimension - 1) / 2) {
+    if (per_side < 1) throw std::runtime_error("Erro: --subdomains deve ser pelo menos 1");
+    const std::uint32_t n = net.num_atoms;
+
+    // Ligações ativas por átomo (CSR)
+    std::vector<std::size_t> offset(n + 1, 0);
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.alive.test(b) || !net.endpoints(b, a1, a2) || a1 == a2) continue;
+        ++offset[a1 + 1];
+        ++offset[a2 + 1];
+    }
+    for (std::uint32_t i = 0; i < n; ++i) offset[i + 1] += offset[i];
+    std::vector<std::uint32_t> neighbors(offset[n]), bond_of(offset[n]);
+    {
+        std::vector<std::size_t> fill(offset.begin(), offset.end() - 1);
+        for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+            std::uint32_t a1, a2;
+            if (!net.alive.test(b) || !net.endpoints(b, a1, a2) || a1 == a2) continue;
+            bond_of[fill[a1]] = b;
+            neighbors[fill[a1]++] = a2;
+            bond_of[fill[a2]] = b;
+            neighbors[fill[a2]++] = a1;
+        }
+    }
+    auto mobile = [&](std::uint32_t a) { return net.atom_type[a] == atom_mobile; };
+
+    // Dono de cada átomo móvel: o quadrado que contém sua posição inicial
+    int cells[3] = {1, 1, 1};
+    double width[3] = {1.0, 1.0, 1.0};
+    std::size_t count = 1;
+    for (int d = 0; d < dim_; ++d) {
+        cells[d] = per_side;
+        width[d] = (net.box.hi[d] - net.box.lo[d]) / per_side;
+        count *= per_side;
+    }
+    owner_.assign(n, none);
+    rel_.assign(3 * std::size_t(n), 0.0);
+    std::vector<std::vector<std::uint32_t>> owned(count);
+    for (std::uint32_t a = 0; a < n; ++a) {
+        if (!mobile(a)) continue;
+        std::uint32_t t = 0;
+        int c[3] = {0, 0, 0};
+        for (int d = dim_ - 1; d >= 0; --d) {
+            c[d] = (width[d] > 0.0) ? static_cast<int>((net.x[3 * a + d] - net.box.lo[d]) / width[d]) : 0;
+            c[d] = std::min(std::max(c[d], 0), cells[d] - 1);
+            t = t * cells[d] + c[d];
+        }
+        const double side = *std::max_element(width, width + dim_);
+        for (int d = 0; d < dim_; ++d) {
+            rel_[3 * a + d] = (net.x[3 * a + d] - net.box.lo[d] - (c[d] + 0.5) * width[d]) / side;
+        }
+        owner_[a] = t;
+        owned[t].push_back(a);
+    }
+
+    // Subdomínios: o quadrado mais `overlap` camadas de vizinhos móveis
+    subdomains_.resize(count);
+    std::vector<std::uint32_t> stamp(n, none), local(n, none), degree(n, 0);
+    std::vector<std::uint32_t> members, frontier, next, order;
+    std::vector<std::vector<std::uint32_t>> member_of(n);
+    for (std::uint32_t t = 0; t < count; ++t) {
+        members = owned[t];
+        for (std::uint32_t a : members) stamp[a] = t;
+        frontier = members;
+        for (int layer = 0; layer < overlap; ++layer) {
+            next.clear();
+            for (std::uint32_t v : frontier) {
+                for (std::size_t e = offset[v]; e < offset[v + 1]; ++e) {
+                    const std::uint32_t w = neighbors[e];
+                    if (mobile(w) && stamp[w] != t) {
+                        stamp[w] = t;
+                        next.push_back(w);
+                    }
+                }
+            }
+            members.insert(members.end(), next.begin(), next.end());
+            frontier.swap(next);
+        }
+        for (std::uint32_t v : members) {
+            degree[v] = 0;
+            for (std::size_t e = offset[v]; e < offset[v + 1]; ++e) degree[v] += (stamp[neighbors[e]] == t);
+            member_of[v].push_back(t);
+        }
+        auto by_degree = [&](std::uint32_t a, std::uint32_t b) { return degree[a] < degree[b]; };
+
+        // Cuthill-McKee reverso por componente, a partir do grau mínimo
+        std::sort(members.begin(), members.end(), by_degree);
+        order.clear();
+        for (std::uint32_t seed : members) {
+            if (local[seed] != none) continue;
+            const std::size_t start = order.size();
+            order.push_back(seed);
+            local[seed] = 0;
+            for (std::size_t h = start; h < order.size(); ++h) {
+                const std::uint32_t v = order[h];
+                next.clear();
+                for (std::size_t e = offset[v]; e < offset[v + 1]; ++e) {
+                    const std::uint32_t w = neighbors[e];
+                    if (stamp[w] == t && local[w] == none) {
+                        local[w] = 0;
+                        next.push_back(w);
+                    }
+                }
+                std::sort(next.begin(), next.end(), by_degree);
+                order.insert(order.end(), next.begin(), next.end());
+            }
+        }
+        std::reverse(order.begin(), order.end());
+
+        Subdomain& sub = subdomains_[t];
+        sub.atoms = order;
+        for (std::uint32_t i = 0; i < order.size(); ++i) local[order[i]] = i;
+        const std::size_t dofs = dim_ * order.size();
+        sub.chol.first.resize(dofs);
+        sub.chol.row_start.assign(dofs + 1, 0);
+        for (std::uint32_t i = 0; i < order.size(); ++i) {
+            const std::uint32_t v = order[i];
+            std::uint32_t lo = i;
+            for (std::size_t e = offset[v]; e < offset[v + 1]; ++e) {
+                const std::uint32_t w = neighbors[e];
+                if (stamp[w] == t) {
+                    lo = std::min(lo, local[w]);
+                    if (w < v) continue;  // ligação interna: registrada uma vez
+                }
+                sub.bonds.push_back(LocalBond{bond_of[e], i, stamp[w] == t ? local[w] : none});
+            }
+            for (int p = 0; p < dim_; ++p) {
+                const std::size_t row = dim_ * std::size_t(i) + p;
+                sub.chol.first[row] = static_cast<std::uint32_t>(dim_ * lo);
+                sub.chol.row_start[row + 1] = sub.chol.row_start[row] + (row - sub.chol.first[row] + 1);
+            }
+        }
+        for (std::uint32_t v : order) local[v] = none;
+    }
+
+    member_start_.assign(n + 1, 0);
+    for (std::uint32_t a = 0; a < n; ++a) {
+        member_start_[a + 1] = member_start_[a] + member_of[a].size();
+        member_.insert(member_.end(), member_of[a].begin(), member_of[a].end());
+    }
+
+    // A0 densa: perfil cheio
+    const std::size_t nc = count * modes_;
+    coarse_.first.assign(nc, 0);
+    coarse_.row_start.assign(nc + 1, 0);
+    for (std::size_t i = 0; i < nc; ++i) coarse_.row_start[i + 1] = coarse_.row_start[i] + i + 1;
+    coarse_.l.assign(coarse_.row_start[nc], 0.0);
+    coarse_rhs_.assign(nc, 0.0);
+}
+
+std::vector<std::uint32_t> SchwarzPreconditioner::changed_subdomains(const Network& net, bool all) {
+    std::vector<std::uint32_t> dirty;
+    const std::size_t words = (net.num_bonds + 63) / 64;
+    const std::uint64_t* alive = net.alive.words();
+    if (all || alive_.empty()) {
+        alive_.assign(alive, alive + words);
+        dirty.resize(subdomains_.size());
+        for (std::uint32_t t = 0; t < dirty.size(); ++t) dirty[t] = t;
+        return dirty;
+    }
+    std::vector<std::uint8_t> marked(subdomains_.size(), 0);
+    for (std::size_t w = 0; w < words; ++w) {
+        std::uint64_t diff = alive_[w] ^ alive[w];
+        alive_[w] = alive[w];
+        while (diff) {
+            const std::uint32_t b = static_cast<std::uint32_t>(64 * w + __builtin_ctzll(diff));
+            diff &= diff - 1;
+            std::uint32_t a1, a2;
+            if (!net.endpoints(b, a1, a2)) continue;
+            for (std::uint32_t a : {a1, a2}) {
+                for (std::size_t m = member_start_[a]; m < member_start_[a + 1]; ++m) {
+                    if (!marked[member_[m]]) {
+                        marked[member_[m]] = 1;
+                        dirty.push_back(member_[m]);
+                    }
+                }
+            }
+        }
+    }
+    return dirty;
+}
+
+void SchwarzPreconditioner::factor_subdomain(const Network& net, Subdomain& sub,
+                                             const std::vector<BondStiffness>& blocks) {
+    const std::size_t n = dim_ * sub.atoms.size();
+    sub.chol.l.assign(sub.chol.row_start[n], 0.0);
+    sub.work.assign(n, 0.0);
+    auto add = [&](std::uint32_t P, std::uint32_t Q, const double* k, double sign) {
+        for (int p = 0; p < dim_; ++p) {
+            for (int q = 0; q < dim_; ++q) {
+                const std::size_t row = dim_ * std::size_t(P) + p, col = dim_ * std::size_t(Q) + q;
+                if (row >= col) sub.chol.at(row, col) += sign * k[kIdx[p][q]];
+            }
+        }
+    };
+    // Átomos que deixaram de ser móveis (poda de rigidez) ficam de fora,
+    // como os externos; suas linhas zeradas são descartadas na fatoração
+    auto inside = [&](std::uint32_t l) { return l != none && net.atom_type[sub.atoms[l]] == atom_mobile; };
+    for (const BondStiffness& blk : blocks) {
+        const bool ia = inside(blk.a), ib = inside(blk.b);
+        if (ia) add(blk.a, blk.a, blk.k, 1.0);
+        if (ib) add(blk.b, blk.b, blk.k, 1.0);
+        if (ia && ib) add(std::max(blk.a, blk.b), std::min(blk.a, blk.b), blk.k, -1.0);
+    }
+    sub.chol.factor();
+}
+
+void SchwarzPreconditioner::coarse_vectors(std::uint32_t atom, double v[6][3]) const {
+    for (int m = 0; m < modes_; ++m) v[m][0] = v[m][1] = v[m][2] = 0.0;
+    for (int d = 0; d < dim_; ++d) v[d][d] = 1.0;
+    const double* x = &rel_[3 * std::size_t(atom)];
+    int m = dim_;
+    for (int p = 0; p < dim_; ++p) {
+        for (int q = p + 1; q < dim_; ++q, ++m) {
+            v[m][p] = -x[q];
+            v[m][q] = x[p];
+        }
+    }
+}
+
+// A0 += G^T K_b G, com G levando os coeficientes grossos dos donos das
+// pontas ao alongamento relativo da ligação
+void SchwarzPreconditioner::add_coarse(const Network& net, const BondStiffness& blk) {
+    std::uint32_t owner[2];
+    double v[2][6][3], kv[2][6][3];
+    int ends = 0;
+    for (std::uint32_t atom : {blk.a, blk.b}) {
+        if (net.atom_type[atom] != atom_mobile || owner_[atom] == none) continue;
+        owner[ends] = owner_[atom];
+        coarse_vectors(atom, v[ends]);
+        const double sign = (atom == blk.a) ? 1.0 : -1.0;
+        for (int m = 0; m < modes_; ++m) {
+            for (int p = 0; p < 3; ++p) v[ends][m][p] *= sign;
+            for (int p = 0; p < dim_; ++p) {
+                double s = 0.0;
+                for (int q = 0; q < dim_; ++q) s += blk.k[kIdx[p][q]] * v[ends][m][q];
+                kv[ends][m][p] = s;
+            }
+        }
+        ++ends;
+    }
+    for (int e = 0; e < ends; ++e) {
+        for (int f = 0; f < ends; ++f) {
+            for (int m = 0; m < modes_; ++m) {
+                const std::size_t row = std::size_t(owner[e]) * modes_ + m;
+                for (int k = 0; k < modes_; ++k) {
+                    const std::size_t col = std::size_t(owner[f]) * modes_ + k;
+                    if (col > row) continue;
+                    double s = 0.0;
+                    for (int p = 0; p < dim_; ++p) s += v[e][m][p] * kv[f][k][p];
+                    coarse_.at(row, col) += s;
+                }
+            }
+        }
+    }
+}
+
+void SchwarzPreconditioner::apply(const Network& net, const double* r, double* z) const {
+    auto gather = [&](std::uint32_t atom, int p) { return net.atom_type[atom] == atom_mobile ? r[3 * atom + p] : 0.0; };
+    parallel_for(subdomains_.size(), threads_, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t t = begin; t < end; ++t) {
+            const Subdomain& sub = subdomains_[t];
+            for (std::size_t i = 0; i < sub.atoms.size(); ++i) {
+                for (int p = 0; p < dim_; ++p) sub.work[dim_ * i + p] = gather(sub.atoms[i], p);
+            }
+            sub.chol.solve(sub.work.data());
+        }
+    });
+    std::fill(z, z + 3 * static_cast<std::size_t>(net.num_atoms), 0.0);
+    for (const Subdomain& sub : subdomains_) {
+        for (std::size_t i = 0; i < sub.atoms.size(); ++i) {
+            for (int p = 0; p < dim_; ++p) z[3 * sub.atoms[i] + p] += sub.work[dim_ * i + p];
+        }
+    }
+
+    // Nível grosso: z += Z A0^-1 Z^T r
+    std::fill(coarse_rhs_.begin(), coarse_rhs_.end(), 0.0);
+    double v[6][3];
+    for (std::uint32_t a = 0; a < net.num_atoms; ++a) {
+        if (owner_[a] == none || net.atom_type[a] != atom_mobile) continue;
+        coarse_vectors(a, v);
+        for (int m = 0; m < modes_; ++m) {
+            double s = 0.0;
+            for (int p = 0; p < dim_; ++p) s += v[m][p] * r[3 * a + p];
+            coarse_rhs_[std::size_t(owner_[a]) * modes_ + m] += s;
+        }
+    }
+    coarse_.solve(coarse_rhs_.data());
+    for (std::uint32_t a = 0; a < net.num_atoms; ++a) {
+        if (net.atom_type[a] != atom_mobile) {
+            z[3 * a] = z[3 * a + 1] = z[3 * a + 2] = 0.0;
+            continue;
+        }
+        if (owner_[a] == none) continue;
+        coarse_vectors(a, v);
+        for (int m = 0; m < modes_; ++m) {
+            const double c = coarse_rhs_[std::size_t(owner_[a]) * modes_ + m];
+            for (int p = 0; p < dim_; ++p) z[3 * a + p] += c * v[m][p];
+        }
+    }
+}
+
+std::uint32_t SchwarzPreconditioner::largest_subdomain() const {
+    std::size_t largest = 0;
+    for (const Subdomain& sub : subdomains_) largest = std::max(largest, sub.atoms.size());
+    return static_cast<std::uint32_t>(largest);
+}
+
+std::size_t SchwarzPreconditioner::bytes() const {
+    std::size_t total = (owner_.capacity() + member_.capacity()) * sizeof(std::uint32_t) +
+                        member_start_.capacity() * sizeof(std::size_t) +
+                        (rel_.capacity() + coarse_rhs_.capacity()) * sizeof(double) +
+                        alive_.capacity() * sizeof(std::uint64_t) + coarse_.bytes();
+    for (const Subdomain& sub : subdomains_) {
+        total += sub.atoms.capacity() * sizeof(std::uint32_t) + sub.bonds.capacity() * sizeof(LocalBond) +
+                 sub.chol.bytes() + sub.work.capacity() * sizeof(double);
+    }
+    return total;
+}
+
+}  // namespace spring
@@ -0,0 +1,176 @@
+// schwarz.h
+//
+// Precondicionador de Schwarz aditivo com sobreposição e espaço grosso.
+//
+// A rede é dividida em S x S subdomínios pela posição inicial dos átomos (o
+// papel que os ranks teriam numa execução distribuída). Cada subdomínio é o
+// seu quadrado mais `overlap` camadas de vizinhos pelas ligações ativas; a
+// Hessiana (termo de tensão truncado em zero, como em schur.h) restrita a ele,
+// com os átomos de fora fixos, tem fatoração de Cholesky em perfil (ordem de
+// Cuthill-McKee reversa). O nível grosso dá o acoplamento global: por
+// subdomínio, as translações e rotações rígidas dos átomos do seu quadrado
+// (Nicolaides), com A0 = Z^T K Z densa e fatorada. O precondicionador é
+//   M^-1 = sum_i R_i^T K_i^-1 R_i + Z A0^-1 Z^T,
+// simétrico, e os solves locais rodam em paralelo, um por subdomínio.
+//
+// Sem o nível grosso, o número de iterações cresce com o número de
+// subdomínios (a informação anda um subdomínio por iteração); com ele, fica
+// aproximadamente constante. Depois de quebras, só os subdomínios que contêm
+// uma ponta de ligação que mudou são refatorados; A0 é remontada (uma
+// passada pelas ligações).
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "kernels.h"
+#include "linear.h"
+#include "network.h"
+#include "parallel.h"
+#include "relax.h"
+
+namespace spring {
+
+class SchwarzPreconditioner {
+public:
+    SchwarzPreconditioner(const Network& net, int dimension, int per_side, int overlap, int threads);
+
+    // Refatora os subdomínios cujas ligações mudaram (ou todos) e o nível
+    // grosso. Retorna quantos subdomínios foram refatorados.
+    template <class K>
+    std::uint32_t update(const Network& net, bool all);
+
+    // z = M^-1 r (passo 3 por átomo; zero nos átomos hoje fixos)
+    void apply(const Network& net, const double* r, double* z) const;
+
+    std::uint32_t num_subdomains() const { return static_cast<std::uint32_t>(subdomains_.size()); }
+    std::uint32_t largest_subdomain() const;
+    std::size_t coarse_size() const { return coarse_.size(); }
+    std::size_t bytes() const;
+
+private:
+    static constexpr std::uint32_t none = 0xFFFFFFFFu;
+
+    // Ligação com ponta no subdomínio, com as pontas em índices locais
+    struct LocalBond {
+        std::uint32_t bond, a, b;
+    };
+
+    struct Subdomain {
+        std::vector<std::uint32_t> atoms;  // ordem de eliminação
+        std::vector<LocalBond> bonds;
+        EnvelopeCholesky chol;
+        mutable std::vector<double> work;
+    };
+
+    std::vector<std::uint32_t> changed_subdomains(const Network& net, bool all);
+    // `blocks` com as pontas em índices locais (none: fora do subdomínio)
+    void factor_subdomain(const Network& net, Subdomain& sub, const std::vector<BondStiffness>& blocks);
+    void add_coarse(const Network& net, const BondStiffness& blk);
+    // Vetores grossos do subdomínio dono de `atom` nesse átomo: v[m][c]
+    void coarse_vectors(std::uint32_t atom, double v[6][3]) const;
+
+    int dim_ = 2;
+    int threads_ = 1;
+    int modes_ = 3;  // vetores grossos por subdomínio
+    std::vector<Subdomain> subdomains_;
+    std::vector<std::uint32_t> owner_;                  // subdomínio dono de cada átomo
+    std::vector<double> rel_;                           // posição relativa ao centro do dono / lado
+    std::vector<std::size_t> member_start_;             // subdomínios que contêm cada átomo (CSR)
+    std::vector<std::uint32_t> member_;
+    std::vector<std::uint64_t> alive_;                  // ligações ativas na última fatoração
+    EnvelopeCholesky coarse_;                           // A0 densa (perfil cheio)
+    mutable std::vector<double> coarse_rhs_;
+};
+
+template <class K>
+std::uint32_t SchwarzPreconditioner::update(const Network& net, bool all) {
+    const std::vector<std::uint32_t> dirty = changed_subdomains(net, all);
+    if (dirty.empty()) return 0;
+    parallel_for(dirty.size(), threads_, [&](std::size_t begin, std::size_t end, int) {
+        std::vector<BondStiffness> blocks;
+        BondStiffness s;
+        for (std::size_t i = begin; i < end; ++i) {
+            Subdomain& sub = subdomains_[dirty[i]];
+            blocks.clear();
+            for (const LocalBond& lb : sub.bonds) {
+                if (!bond_stiffness<K>(net, lb.bond, s)) continue;
+                s.a = lb.a;  // pontas em índices locais
+                s.b = lb.b;
+                blocks.push_back(s);
+            }
+            factor_subdomain(net, sub, blocks);
+        }
+    });
+
+    std::fill(coarse_.l.begin(), coarse_.l.end(), 0.0);
+    BondStiffness s;
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        if (bond_stiffness<K>(net, b, s)) add_coarse(net, s);
+    }
+    coarse_.factor();
+    return static_cast<std::uint32_t>(dirty.size());
+}
+
+// --- CG não linear precondicionado por Schwarz aditivo ---
+template <class K>
+class SchwarzRelax : public CgRelax<K> {
+public:
+    explicit SchwarzRelax(int overlap = 2) : overlap_(overlap) {}
+
+    const char* name() const override { return "schwarz"; }
+
+    RelaxResult relax(Network& net, const RelaxSettings& settings) override {
+        RelaxResult result;
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!schwarz_) {
+            schwarz_ = std::make_unique<SchwarzPreconditioner>(net, K::dimension, settings.subdomains, overlap_,
+                                                               default_threads());
+            schwarz_->update<K>(net, true);
+            result.full_refreshes = 1;
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            std::cout << "Info: schwarz: " << schwarz_->num_subdomains() << " subdomínios (maior com "
+                      << schwarz_->largest_subdomain() << " átomos, sobreposição " << overlap_
+                      << "), espaço grosso " << schwarz_->coarse_size() << "; fatoração " << elapsed.count()
+                      << " s, " << schwarz_->bytes() / (1024.0 * 1024.0) << " MiB" << std::endl;
+        } else {
+            result.local_refreshes = static_cast<int>(schwarz_->update<K>(net, false));
+        }
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        result.refresh_seconds = elapsed.count();
+
+        net_ = &net;
+        const RelaxResult cg = CgRelax<K>::relax(net, settings);
+        net_ = nullptr;
+        result.iterations = cg.iterations;
+        result.force_evals = cg.force_evals;
+        result.energy = cg.energy;
+        result.fnorm = cg.fnorm;
+        result.wall_force = cg.wall_force;
+        result.stop = cg.stop;
+        return result;
+    }
+
+    std::size_t workspace_bytes() const override {
+        return CgRelax<K>::workspace_bytes() + (schwarz_ ? schwarz_->bytes() : 0);
+    }
+
+protected:
+    bool precondition(const std::vector<double>& f, std::vector<double>& s) override {
+        s.resize(f.size());
+        schwarz_->apply(*net_, f.data(), s.data());
+        return true;
+    }
+
+private:
+    int overlap_;
+    std::unique_ptr<SchwarzPreconditioner> schwarz_;
+    const Network* net_ = nullptr;
+};
+
+}  // namespace spring
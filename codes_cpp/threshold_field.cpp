@@ -0,0 +1,186 @@
+// threshold_field.cpp
+
+#include "threshold_field.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace spring {
+
+namespace {
+
+std::size_t next_pow2(std::size_t n) {
+    std::size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+}  // namespace
+
+double ThresholdDistribution::quantile(double u) const {
+    u = std::min(std::max(u, 1.0e-12), 1.0 - 1.0e-12);
+    if (kind == weibull) return b * std::pow(-std::log(1.0 - u), 1.0 / a);
+    return a + (b - a) * u;
+}
+
+ThresholdDistribution ThresholdDistribution::parse(const std::string& text) {
+    ThresholdDistribution dist;
+    std::istringstream in(text);
+    std::string kind, a, b;
+    std::getline(in, kind, ',');
+    std::getline(in, a, ',');
+    std::getline(in, b, ',');
+    if (kind == "uniform") {
+        dist.kind = uniform;
+    } else if (kind == "weibull") {
+        dist.kind = weibull;
+        dist.a = 2.0;
+        dist.b = 0.5;
+    } else {
+        throw std::runtime_error("Erro: distribuição de limiares desconhecida: " + text);
+    }
+    if (!a.empty()) dist.a = std::stod(a);
+    if (!b.empty()) dist.b = std::stod(b);
+    return dist;
+}
+
+std::vector<std::complex<double>> make_twiddles(std::size_t n) {
+    std::vector<std::complex<double>> tw(n / 2);
+    for (std::size_t k = 0; k < n / 2; ++k) tw[k] = std::polar(1.0, -2.0 * M_PI * double(k) / double(n));
+    return tw;
+}
+
+void fft_radix2(std::complex<double>* data, std::size_t n, const std::complex<double>* twiddles, bool inverse) {
+    // Bit reversal
+    for (std::size_t i = 1, j = 0; i < n; ++i) {
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i], data[j]);
+    }
+    // Butterflies
+    for (std::size_t len = 2; len <= n; len <<= 1) {
+        const std::size_t half = len / 2, step = n / len;
+        for (std::size_t start = 0; start < n; start += len) {
+            for (std::size_t k = 0; k < half; ++k) {
+                std::complex<double> w = twiddles[k * step];
+                if (inverse) w = std::conj(w);
+                const std::complex<double> t = w * data[start + k + half];
+                data[start + k + half] = data[start + k] - t;
+                data[start + k] += t;
+            }
+        }
+    }
+    if (inverse) {
+        const double scale = 1.0 / double(n);
+        for (std::size_t i = 0; i < n; ++i) data[i] *= scale;
+    }
+}
+
+GaussianFieldGenerator::GaussianFieldGenerator(const Box& box, double correlation_length, double cell) {
+    if (!(correlation_length > 0.0) || !(cell > 0.0)) {
+        throw std::runtime_error("Erro: comprimento de correlação e espaçamento da grade devem ser positivos");
+    }
+    // x: a grade cobre exatamente um período; y: altura + margem contra o wrap
+    const double width = box.period[0];
+    const double height = box.period[1] + 4.0 * correlation_length;
+    nx_ = next_pow2(static_cast<std::size_t>(std::ceil(width / cell)));
+    ny_ = next_pow2(static_cast<std::size_t>(std::ceil(height / cell)) + 2);
+    x0_ = box.lo[0];
+    y0_ = box.lo[1];
+    hx_ = width / double(nx_);
+    hy_ = cell;
+
+    // Espectro da covariância gaussiana, normalizado para variância unitária
+    const double xi2 = correlation_length * correlation_length;
+    filter_.assign(nx_ * ny_, 0.0);
+    double total = 0.0;
+    for (std::size_t q = 0; q < ny_; ++q) {
+        const double my = (q < ny_ / 2) ? double(q) : double(q) - double(ny_);
+        const double ky = 2.0 * M_PI * my / (double(ny_) * hy_);
+        for (std::size_t p = 0; p < nx_; ++p) {
+            const double mx = (p < nx_ / 2) ? double(p) : double(p) - double(nx_);
+            const double kx = 2.0 * M_PI * mx / (double(nx_) * hx_);
+            const double s = std::exp(-0.5 * (kx * kx + ky * ky) * xi2);
+            filter_[q * nx_ + p] = s;
+            total += s;
+        }
+    }
+    const double n = double(nx_ * ny_);
+    for (double& h : filter_) h = std::sqrt(h * n * n / total);
+
+    twiddles_x_ = make_twiddles(nx_);
+    twiddles_y_ = make_twiddles(ny_);
+    work_.resize(nx_ * ny_);
+    column_.resize(ny_);
+}
+
+void GaussianFieldGenerator::synthesize(std::mt19937_64& rng) {
+    std::normal_distribution<double> normal(0.0, 1.0);
+    for (std::size_t k = 0; k < work_.size(); ++k) {
+        const double re = normal(rng);
+        const double im = normal(rng);
+        work_[k] = std::complex<double>(re, im) * filter_[k];
+    }
+    // FFT inversa 2D: linhas (contíguas) e depois colunas via buffer
+    for (std::size_t q = 0; q < ny_; ++q) fft_radix2(&work_[q * nx_], nx_, twiddles_x_.data(), true);
+    for (std::size_t p = 0; p < nx_; ++p) {
+        for (std::size_t q = 0; q < ny_; ++q) column_[q] = work_[q * nx_ + p];
+        fft_radix2(column_.data(), ny_, twiddles_y_.data(), true);
+        for (std::size_t q = 0; q < ny_; ++q) work_[q * nx_ + p] = column_[q];
+    }
+    field_.resize(work_.size());
+    spare_.resize(work_.size());
+    for (std::size_t k = 0; k < work_.size(); ++k) {
+        field_[k] = work_[k].real();
+        spare_[k] = work_[k].imag();
+    }
+}
+
+const std::vector<double>& GaussianFieldGenerator::next(std::mt19937_64& rng) {
+    if (has_spare_) {
+        field_.swap(spare_);
+        has_spare_ = false;
+    } else {
+        synthesize(rng);
+        has_spare_ = true;
+    }
+    return field_;
+}
+
+double GaussianFieldGenerator::sample(double x, double y) const {
+    double u = (x - x0_) / hx_;
+    u -= double(nx_) * std::floor(u / double(nx_));
+    double v = std::min(std::max((y - y0_) / hy_, 0.0), double(ny_ - 1) - 1.0e-9);
+    const std::size_t p0 = std::min(static_cast<std::size_t>(u), nx_ - 1);
+    const std::size_t q0 = static_cast<std::size_t>(v);
+    const std::size_t p1 = (p0 + 1) % nx_, q1 = std::min(q0 + 1, ny_ - 1);
+    const double fu = u - double(p0), fv = v - double(q0);
+    const double* f = field_.data();
+    return (1.0 - fv) * ((1.0 - fu) * f[q0 * nx_ + p0] + fu * f[q0 * nx_ + p1]) +
+           fv * ((1.0 - fu) * f[q1 * nx_ + p0] + fu * f[q1 * nx_ + p1]);
+}
+
+void apply_threshold_field(Network& net, const GaussianFieldGenerator& field, const ThresholdDistribution& dist) {
+    const double period = net.box.period[0];
+    for (std::uint32_t b = 0; b < net.num_bonds; ++b) {
+        std::uint32_t a1, a2;
+        if (!net.breakable(b) || !net.alive.test(b) || !net.endpoints(b, a1, a2)) continue;
+        // Ponto médio pela imagem mínima em x
+        double dx = net.x[3 * a2] - net.x[3 * a1];
+        if (net.periodic[0]) dx -= period * std::nearbyint(dx / period);
+        const double mx = net.x[3 * a1] + 0.5 * dx;
+        const double my = 0.5 * (net.x[3 * a1 + 1] + net.x[3 * a2 + 1]);
+        const double g = field.sample(mx, my);
+        const double u = 0.5 * std::erfc(-g / std::sqrt(2.0));
+        // Limiar relativo ao comprimento de repouso da própria ligação (redes
+        // fora da rede triangular têm rest_len por ligação)
+        const double rest = net.rest_len.empty() ? net.r0 : double(net.rest_len[b]);
+        const double len = rest * (1.0 + dist.quantile(u));
+        net.break_len_sq[b] = static_cast<float>(len * len);
+    }
+}
+
+}  // namespace spring
@@ -0,0 +1,78 @@
+// threshold_field.h
+//
+// Limiares de quebra espacialmente correlacionados.
+//
+// Um campo gaussiano de média nula e variância unitária, com covariância
+// C(r) = exp(-r^2 / (2 xi^2)), é gerado por FFT numa grade que cobre a rede
+// (periódica em x, com margem em y para que o topo e o fundo não se
+// correlacionem pelo wrap da FFT). O ruído branco é sorteado diretamente no
+// espaço de Fourier e filtrado por sqrt(S(k)); como o filtro é real e par, as
+// partes real e imaginária da FFT inversa são dois campos independentes, de
+// modo que cada FFT serve duas realizações.
+//
+// O valor do campo no ponto médio de cada ligação quebrável é levado à
+// distribuição de limiares por transformação de quantis: u = Phi(g) e
+// strain = F^-1(u), com comprimento de quebra l0 * (1 + strain).
+
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "network.h"
+
+namespace spring {
+
+// Distribuição marginal dos limiares (em deformação de quebra)
+struct ThresholdDistribution {
+    enum Kind { uniform, weibull };
+    Kind kind = uniform;
+    double a = 0.0;  // uniform: mínimo; weibull: forma m
+    double b = 1.0;  // uniform: máximo; weibull: escala
+
+    double quantile(double u) const;
+
+    // "uniform,0,1" ou "weibull,m,escala"
+    static ThresholdDistribution parse(const std::string& text);
+};
+
+// FFT complexa radix-2 in-place (n potência de 2); inverse inclui o 1/n.
+// twiddles[k] = exp(-2 pi i k / n), k < n/2 (ver make_twiddles).
+std::vector<std::complex<double>> make_twiddles(std::size_t n);
+void fft_radix2(std::complex<double>* data, std::size_t n, const std::complex<double>* twiddles, bool inverse);
+
+class GaussianFieldGenerator {
+public:
+    // Grade que cobre a caixa da rede; `cell` é o espaçamento desejado.
+    GaussianFieldGenerator(const Box& box, double correlation_length, double cell);
+
+    // Amostra um novo campo (grade nx * ny, linha a linha em y).
+    const std::vector<double>& next(std::mt19937_64& rng);
+
+    // Interpolação bilinear, periódica em x.
+    double sample(double x, double y) const;
+
+    std::size_t nx() const { return nx_; }
+    std::size_t ny() const { return ny_; }
+
+private:
+    void synthesize(std::mt19937_64& rng);
+
+    std::size_t nx_ = 0, ny_ = 0;
+    double x0_ = 0.0, y0_ = 0.0, hx_ = 1.0, hy_ = 1.0;
+    std::vector<double> filter_;               // sqrt(S(k)), normalizado
+    std::vector<std::complex<double>> twiddles_x_, twiddles_y_;
+    std::vector<std::complex<double>> work_, column_;
+    std::vector<double> field_, spare_;
+    bool has_spare_ = false;
+};
+
+// Substitui os limiares das ligações quebráveis pelos valores do campo nos
+// pontos médios. Ligações inquebráveis (limiar infinito) não mudam.
+void apply_threshold_field(Network& net, const GaussianFieldGenerator& field,
+                           const ThresholdDistribution& dist);
+
+}  // namespace spring